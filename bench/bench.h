@@ -0,0 +1,80 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Shared helpers for the benchmark programs. Each benchmark prints a human
+// readable table by default; with --perf it prints one "metric value" line per
+// measurement instead, normalized by a calibration loop so that results from
+// different machines can be compared against bench/perf_baseline.txt.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define BENCH_CALIBRATION_ROUNDS 5
+#define BENCH_CALIBRATION_SIZE 65536
+
+// Process CPU time rather than wall time, so time spent descheduled on a busy
+// CI machine does not count against the code under test
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Fixed mixed workload (byte loads, branches, stores and integer math, the
+// same mix as the parser and renderer hot loops). Returns the best time in
+// nanoseconds over a few rounds; metrics are reported in units of this time.
+static inline double bench_calibrate(void) {
+    static uint8_t buffer[BENCH_CALIBRATION_SIZE];
+    static uint32_t cells[BENCH_CALIBRATION_SIZE / 4];
+    volatile uint32_t sink = 0;
+    double best = 0;
+
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t)(i * 131 + 7);
+    }
+
+    for (int round = 0; round < BENCH_CALIBRATION_ROUNDS; round++) {
+        double start = bench_now_ns();
+        uint32_t hash = 2166136261u;
+        for (int pass = 0; pass < 16; pass++) {
+            for (size_t i = 0; i < sizeof(buffer); i++) {
+                uint8_t byte = buffer[i];
+                if (byte < 0x20 || byte == 0x7F) {
+                    hash ^= byte;
+                } else {
+                    hash = (hash ^ byte) * 16777619u;
+                }
+                cells[i & (BENCH_CALIBRATION_SIZE / 4 - 1)] = hash;
+            }
+            memmove(buffer, buffer + 1, sizeof(buffer) - 1);
+        }
+        sink += hash + cells[hash & (BENCH_CALIBRATION_SIZE / 4 - 1)];
+        double elapsed = bench_now_ns() - start;
+        if (round == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    (void)sink;
+    return best;
+}
+
+static inline bool bench_perf_mode(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Print a metric in perf mode: nanoseconds per unit of work, normalized by
+// the calibration time and scaled so typical values are readable
+static inline void bench_perf_metric(const char *name, double ns_per_op, double calibration_ns) {
+    printf("%s %.4f\n", name, ns_per_op / calibration_ns * 1e6);
+}
+
+#endif // BENCH_H
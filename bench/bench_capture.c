@@ -0,0 +1,111 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "vte/vte_screen.h"
+#include "vte/vte_capture.h"
+#include "bench.h"
+#include "bench_streams.h"
+
+// Capture benchmark: export a panel with HISTORY_LINES lines of scrollback
+// plus its screen in each format, written to /dev/null the way a capture
+// command writes to a file or socket. The history is filled with rows of a
+// recorded-style session so lines carry realistic text and style runs.
+//
+// Usage: bench_capture [--perf]
+
+#define HISTORY_LINES 100000
+#define SCREEN_COLUMNS 120
+#define SCREEN_ROWS 40
+#define ROUNDS 3
+
+static const struct {
+    const char *name;
+    vte_capture_format_t format;
+} formats[] = {
+    { "text", VTE_CAPTURE_TEXT },
+    { "ansi", VTE_CAPTURE_ANSI },
+    { "html", VTE_CAPTURE_HTML },
+};
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+
+    vte_screen_t *screen = vte_screen_new(SCREEN_COLUMNS, SCREEN_ROWS);
+    if (!screen || !vte_screen_set_scrollback(screen, HISTORY_LINES)) {
+        fprintf(stderr, "bench_capture: cannot create screen\n");
+        return 1;
+    }
+
+    // A recorded-style session fills the first part of the history (prompts,
+    // SGR-colored and UTF-8 output), then those lines are cycled until the
+    // history is full
+    bench_stream_t stream = bench_stream_build(BENCH_STREAM_SESSION, 1024 * 1024,
+                                               SCREEN_COLUMNS, SCREEN_ROWS);
+    vte_screen_feed(screen, stream.data, stream.len);
+    bench_stream_free(&stream);
+
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    size_t recorded = vte_scrollback_count(&panel->scrollback);
+    for (size_t i = 0; recorded > 0 && vte_scrollback_count(&panel->scrollback) < HISTORY_LINES; i++) {
+        terminal_cell_t row[SCREEN_COLUMNS];
+        int len = vte_scrollback_line(&panel->scrollback, i % recorded, row, SCREEN_COLUMNS);
+        for (int x = len; x < SCREEN_COLUMNS; x++) {
+            row[x] = vte_screen_row(screen, 0)[SCREEN_COLUMNS - 1];
+        }
+        vte_scrollback_push(&panel->scrollback, row, SCREEN_COLUMNS);
+    }
+    int lines = HISTORY_LINES + SCREEN_ROWS;
+
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        perror("bench_capture: /dev/null");
+        return 1;
+    }
+
+    if (!perf) {
+        printf("capture benchmark: %dx%d screen, %d lines of scrollback, best of %d\n\n",
+               SCREEN_COLUMNS, SCREEN_ROWS, HISTORY_LINES, ROUNDS);
+        printf("%-6s %10s %10s %12s\n", "format", "ms", "ns/line", "output MB");
+    }
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        double best = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            double start = bench_now_ns();
+            if (!vte_capture_fd(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, formats[f].format, fd)) {
+                fprintf(stderr, "bench_capture: write failed\n");
+                return 1;
+            }
+            double elapsed = bench_now_ns() - start;
+            if (round == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+
+        if (perf) {
+            char name[64];
+            snprintf(name, sizeof(name), "capture.%s", formats[f].name);
+            bench_perf_metric(name, best / lines, calibration);
+        } else {
+            size_t size = 0;
+            free(vte_capture_string(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, formats[f].format, &size));
+            printf("%-6s %10.2f %10.1f %12.1f\n", formats[f].name, best / 1e6, best / lines, size / 1e6);
+        }
+    }
+
+    if (!perf) {
+        size_t referenced, stored;
+        vte_scrollback_memory(&panel->scrollback, &referenced, &stored);
+        printf("\nscrollback: %.1f MB of cells, %.1f MB stored\n", referenced / 1e6, stored / 1e6);
+    }
+
+    close(fd);
+    vte_screen_free(screen);
+    return 0;
+}
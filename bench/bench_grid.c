@@ -0,0 +1,223 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vte/vte_screen.h"
+#include "vte/vte_grid.h"
+#include "bench.h"
+#include "bench_streams.h"
+
+// Grid layout benchmark: the same operations on a cell grid stored as rows
+// of terminal_cell_t (aos), as codepoint and style planes (soa) and as rows
+// that are compact or full as their content needs (adaptive). The grid holds
+// the screen a recorded-style session leaves behind.
+//
+//   store   copy a screen row in (the cost of keeping a soa copy)
+//   load    copy a row out to cells, as a renderer reads it
+//   diff    compare every row against a previous frame, one row in 8 changed
+//   search  look for text that is not there in every row
+//   blank   check rows of spaces that only end in a character
+//   scroll  scroll the whole grid up one line
+//
+// Usage: bench_grid [--perf]
+
+#define SCREEN_COLUMNS 200
+#define SCREEN_ROWS 60
+#define PASSES 2000
+#define ROUNDS 3
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    double (*run)(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink);
+    double units;  // Per pass
+} grid_case_t;
+
+static double run_store(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int y = 0; y < SCREEN_ROWS; y++) {
+            vte_grid_store_row(grid, y, vte_screen_row(screen, y));
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+    *sink += grid->rows;
+    return elapsed;
+}
+
+static double run_load(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    terminal_cell_t row[SCREEN_COLUMNS];
+    for (int y = 0; y < SCREEN_ROWS; y++) {
+        vte_grid_store_row(grid, y, vte_screen_row(screen, y));
+    }
+
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int y = 0; y < SCREEN_ROWS; y++) {
+            vte_grid_load_row(grid, y, row);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+    *sink += row[0].codepoint;
+    return elapsed;
+}
+
+static double run_diff(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    vte_grid_t previous;
+    if (!vte_grid_init(&previous, grid->layout, SCREEN_COLUMNS, SCREEN_ROWS)) {
+        return 0;
+    }
+    for (int y = 0; y < SCREEN_ROWS; y++) {
+        vte_grid_store_row(grid, y, vte_screen_row(screen, y));
+        vte_grid_store_row(&previous, y, vte_screen_row(screen, y));
+    }
+    for (int y = 0; y < SCREEN_ROWS; y += 8) {
+        terminal_cell_t cell = { '#', VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+        vte_grid_set(grid, SCREEN_COLUMNS - 1, y, &cell);
+    }
+
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int y = 0; y < SCREEN_ROWS; y++) {
+            *sink += vte_grid_rows_equal(grid, y, &previous, y);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+    vte_grid_free(&previous);
+    return elapsed;
+}
+
+static double run_search(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    static const uint32_t needle[] = { 'q', 'z', 'x', 'j' };
+    for (int y = 0; y < SCREEN_ROWS; y++) {
+        vte_grid_store_row(grid, y, vte_screen_row(screen, y));
+    }
+
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int y = 0; y < SCREEN_ROWS; y++) {
+            *sink += (size_t)(vte_grid_find(grid, y, 0, needle, 4) + 1);
+        }
+    }
+    return bench_now_ns() - start;
+}
+
+static double run_blank(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    (void)screen;
+    for (int y = 0; y < SCREEN_ROWS; y++) {
+        vte_grid_fill(grid, y, 0, SCREEN_COLUMNS, ' ', 0);
+        vte_grid_fill(grid, y, SCREEN_COLUMNS - 1, SCREEN_COLUMNS, '$', 0);
+    }
+
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int y = 0; y < SCREEN_ROWS; y++) {
+            *sink += vte_grid_row_blank(grid, y);
+        }
+    }
+    return bench_now_ns() - start;
+}
+
+static double run_scroll(vte_grid_t *grid, const vte_screen_t *screen, size_t *sink) {
+    for (int y = 0; y < SCREEN_ROWS; y++) {
+        vte_grid_store_row(grid, y, vte_screen_row(screen, y));
+    }
+
+    double start = bench_now_ns();
+    for (int pass = 0; pass < PASSES * SCREEN_ROWS; pass++) {
+        vte_grid_scroll(grid, 0, SCREEN_ROWS - 1, 1);
+    }
+    double elapsed = bench_now_ns() - start;
+    *sink += vte_grid_row_blank(grid, 0);
+    return elapsed;
+}
+
+static const grid_case_t cases[] = {
+    { "store",  "row",  run_store,  SCREEN_ROWS },
+    { "load",   "row",  run_load,   SCREEN_ROWS },
+    { "diff",   "row",  run_diff,   SCREEN_ROWS },
+    { "search", "cell", run_search, SCREEN_ROWS * SCREEN_COLUMNS },
+    { "blank",  "row",  run_blank,  SCREEN_ROWS },
+    { "scroll", "line", run_scroll, SCREEN_ROWS },
+};
+
+static const char *layout_names[] = { "aos", "soa", "adaptive" };
+#define LAYOUTS 3
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+    size_t sink = 0;
+
+    vte_screen_t *screen = vte_screen_new(SCREEN_COLUMNS, SCREEN_ROWS);
+    if (!screen) {
+        fprintf(stderr, "bench_grid: cannot create screen\n");
+        return 1;
+    }
+    bench_stream_t stream = bench_stream_build(BENCH_STREAM_SESSION, 256 * 1024,
+                                               SCREEN_COLUMNS, SCREEN_ROWS);
+    vte_screen_feed(screen, stream.data, stream.len);
+    bench_stream_free(&stream);
+
+    if (!perf) {
+        printf("grid layout benchmark: %dx%d grid, %d passes per case, best of %d\n\n",
+               SCREEN_COLUMNS, SCREEN_ROWS, PASSES, ROUNDS);
+        printf("%-8s %10s %10s %10s %8s\n", "case", "aos ns", "soa ns", "adapt ns", "per");
+    }
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        double per_unit[LAYOUTS];
+        for (int layout = 0; layout < LAYOUTS; layout++) {
+            double best = 0;
+            for (int round = 0; round < ROUNDS; round++) {
+                vte_grid_t grid;
+                if (!vte_grid_init(&grid, layout, SCREEN_COLUMNS, SCREEN_ROWS)) {
+                    fprintf(stderr, "bench_grid: cannot create grid\n");
+                    return 1;
+                }
+                double elapsed = cases[c].run(&grid, screen, &sink);
+                vte_grid_free(&grid);
+                if (round == 0 || elapsed < best) {
+                    best = elapsed;
+                }
+            }
+            per_unit[layout] = best / (PASSES * cases[c].units);
+
+            if (perf) {
+                char name[64];
+                snprintf(name, sizeof(name), "grid.%s.%s", cases[c].name, layout_names[layout]);
+                bench_perf_metric(name, per_unit[layout], calibration);
+            }
+        }
+        if (!perf) {
+            printf("%-8s %10.2f %10.2f %10.2f %8s\n", cases[c].name, per_unit[VTE_GRID_AOS],
+                   per_unit[VTE_GRID_SOA], per_unit[VTE_GRID_ADAPTIVE], cases[c].unit);
+        }
+    }
+
+    // What holding the screen costs in each layout
+    if (!perf) {
+        printf("%-8s", "bytes");
+        for (int layout = 0; layout < LAYOUTS; layout++) {
+            vte_grid_t grid;
+            if (!vte_grid_init(&grid, layout, SCREEN_COLUMNS, SCREEN_ROWS)) {
+                fprintf(stderr, "bench_grid: cannot create grid\n");
+                return 1;
+            }
+            for (int y = 0; y < SCREEN_ROWS; y++) {
+                vte_grid_store_row(&grid, y, vte_screen_row(screen, y));
+            }
+            printf(" %10zu", vte_grid_memory(&grid));
+            vte_grid_free(&grid);
+        }
+        printf(" %8s\n", "grid");
+    }
+
+    vte_screen_free(screen);
+    if (sink == 0) {
+        fprintf(stderr, "bench_grid: nothing measured\n");
+    }
+    return 0;
+}
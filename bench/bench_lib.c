@@ -0,0 +1,100 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vte/vte_screen.h"
+#include "bench.h"
+#include "bench_streams.h"
+
+// Library benchmark: throughput of libtoadvte as an embedder uses it, linked
+// against the static library only (no ncurses). "feed" pushes each synthetic
+// stream through vte_screen_feed() in large writes; "extract" also pulls every
+// row back out as text and style runs after each write, as a log-to-text or
+// log-to-HTML converter would.
+//
+// Usage: bench_lib [--perf]
+
+#define STREAM_BYTES (1024 * 1024)
+#define SCREEN_COLUMNS 200
+#define SCREEN_ROWS 60
+#define FEED_SIZE 65536
+#define EXTRACT_SIZE 4096
+#define ROUNDS 3
+
+static size_t extract_screen(const vte_screen_t *screen) {
+    static char text[SCREEN_COLUMNS * 4 + 1];
+    static vte_style_run_t runs[SCREEN_COLUMNS];
+    size_t total = 0;
+    for (int y = 0; y < vte_screen_rows(screen); y++) {
+        total += vte_screen_row_text(screen, y, text, sizeof(text));
+        total += vte_screen_row_runs(screen, y, runs, SCREEN_COLUMNS);
+    }
+    return total;
+}
+
+static double run_stream(const bench_stream_t *stream, bool extract, size_t *sink) {
+    vte_screen_t *screen = vte_screen_new(SCREEN_COLUMNS, SCREEN_ROWS);
+    if (!screen) {
+        fprintf(stderr, "bench_lib: vte_screen_new failed\n");
+        exit(1);
+    }
+
+    size_t step = extract ? EXTRACT_SIZE : FEED_SIZE;
+    double start = bench_now_ns();
+    for (size_t off = 0; off < stream->len; off += step) {
+        size_t len = stream->len - off < step ? stream->len - off : step;
+        vte_screen_feed(screen, stream->data + off, len);
+        if (extract) {
+            *sink += extract_screen(screen);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+
+    vte_screen_free(screen);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+    size_t sink = 0;
+
+    if (!perf) {
+        printf("library benchmark: %dx%d screen, %d MiB per stream, best of %d\n\n",
+               SCREEN_COLUMNS, SCREEN_ROWS, STREAM_BYTES >> 20, ROUNDS);
+        printf("%-10s %-8s %10s %10s\n", "stream", "mode", "MB/s", "ns/byte");
+    }
+
+    for (int kind = 0; kind < BENCH_STREAM_COUNT; kind++) {
+        bench_stream_t stream = bench_stream_build(kind, STREAM_BYTES, SCREEN_COLUMNS, SCREEN_ROWS);
+
+        for (int extract = 0; extract <= 1; extract++) {
+            double best = 0;
+            for (int round = 0; round < ROUNDS; round++) {
+                double elapsed = run_stream(&stream, extract, &sink);
+                if (round == 0 || elapsed < best) {
+                    best = elapsed;
+                }
+            }
+
+            const char *mode = extract ? "extract" : "feed";
+            double ns_per_byte = best / stream.len;
+            if (perf) {
+                char name[64];
+                snprintf(name, sizeof(name), "lib.%s.%s", mode, stream.name);
+                bench_perf_metric(name, ns_per_byte, calibration);
+            } else {
+                printf("%-10s %-8s %10.1f %10.2f\n", stream.name, mode,
+                       stream.len / best * 1e3, ns_per_byte);
+            }
+        }
+        bench_stream_free(&stream);
+    }
+
+    if (sink == 0) {
+        fprintf(stderr, "bench_lib: nothing extracted\n");
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toad.h"
+#include "bench.h"
+#include "bench_streams.h"
+
+// Parser benchmark: feeds synthetic streams through vte_parser_feed() with
+// the terminal perform implementation, in BUFFER_SIZE chunks like
+// the pty reads of the main loop, and reports throughput per stream.
+//
+// Usage: bench_parser [--perf]
+
+#define STREAM_BYTES (1024 * 1024)
+#define PANEL_COLUMNS 200
+#define PANEL_ROWS 60
+#define ROUNDS 3
+
+static double parse_stream(const bench_stream_t *stream) {
+    terminal_panel_t panel;
+    memset(&panel, 0, sizeof(panel));
+    panel.width = PANEL_COLUMNS + 2;
+    panel.height = PANEL_ROWS + 2;
+    init_panel_screen(&panel);
+
+    double start = bench_now_ns();
+    for (size_t off = 0; off < stream->len; off += BUFFER_SIZE) {
+        size_t len = stream->len - off < BUFFER_SIZE ? stream->len - off : BUFFER_SIZE;
+        vte_parser_feed(&panel, (const char *)stream->data + off, len);
+    }
+    double elapsed = bench_now_ns() - start;
+
+    free_panel_screen(&panel);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+
+    if (!perf) {
+        printf("parser benchmark: %dx%d panel, %d MiB per stream, best of %d\n\n",
+               PANEL_COLUMNS, PANEL_ROWS, STREAM_BYTES >> 20, ROUNDS);
+        printf("%-10s %10s %10s\n", "stream", "MB/s", "ns/byte");
+    }
+
+    for (int kind = 0; kind < BENCH_STREAM_COUNT; kind++) {
+        bench_stream_t stream = bench_stream_build(kind, STREAM_BYTES, PANEL_COLUMNS, PANEL_ROWS);
+
+        double best = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            double elapsed = parse_stream(&stream);
+            if (round == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+
+        double ns_per_byte = best / stream.len;
+        if (perf) {
+            char name[64];
+            snprintf(name, sizeof(name), "parser.%s", stream.name);
+            bench_perf_metric(name, ns_per_byte, calibration);
+        } else {
+            printf("%-10s %10.1f %10.2f\n", stream.name, stream.len / best * 1e3, ns_per_byte);
+        }
+        bench_stream_free(&stream);
+    }
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toad.h"
+#include "bench.h"
+#include "bench_term.h"
+
+// Render benchmark: drives draw_panel() and doupdate() through render_frame()
+// against a virtual terminal created with newterm() on a temporary file, and
+// reports frames per second and bytes sent to the host terminal per frame.
+//
+// Usage: bench_render [--perf] [frames] [columns] [rows]
+
+#define DEFAULT_FRAMES 300
+#define PERF_FRAMES 100
+#define PERF_ROUNDS 3
+#define DEFAULT_COLUMNS 200
+#define DEFAULT_ROWS 60
+
+typedef struct {
+    const char *name;
+    void (*fill)(terminal_panel_t *panel);               // Initial screen content
+    void (*update)(terminal_panel_t *panel, int frame);  // Change applied before each frame
+} render_scenario_t;
+
+typedef struct {
+    const char *name;
+    bool (*frame)(void);
+} render_backend_t;
+
+// Renderer backends under test; new backends get an entry here
+static const render_backend_t backends[] = {
+    { "draw_panel", render_frame },
+};
+
+static void feed(terminal_panel_t *panel, const char *data) {
+    vte_parser_feed(panel, data, strlen(data));
+}
+
+// Sparse: a shell prompt with a few lines of output, one keystroke per frame
+static void sparse_fill(terminal_panel_t *panel) {
+    feed(panel, "\033[32muser@toad\033[0m:\033[34m~\033[0m$ ls\r\n"
+                "Makefile  README.md  src  tests\r\n"
+                "\033[32muser@toad\033[0m:\033[34m~\033[0m$ ");
+}
+
+static void sparse_update(terminal_panel_t *panel, int frame) {
+    feed(panel, (frame % 2) ? "\b \b" : "x");
+}
+
+// Dense: every cell holds text, one full line scrolls in per frame
+static void dense_line(terminal_panel_t *panel, int seed) {
+    char line[512];
+    int len = panel->screen_width < (int)sizeof(line) - 3 ? panel->screen_width : (int)sizeof(line) - 3;
+    for (int i = 0; i < len; i++) {
+        line[i] = 'A' + (i + seed) % 58;
+        if (line[i] > 'Z' && line[i] < 'a') {
+            line[i] = ' ';
+        }
+    }
+    line[len] = '\0';
+    feed(panel, line);
+    feed(panel, "\r\n");
+}
+
+static void dense_fill(terminal_panel_t *panel) {
+    for (int y = 0; y < panel->screen_height; y++) {
+        dense_line(panel, y);
+    }
+}
+
+static void dense_update(terminal_panel_t *panel, int frame) {
+    dense_line(panel, frame);
+}
+
+// Colored: ls --color / compiler diagnostics style SGR runs
+static void colored_line(terminal_panel_t *panel, int seed) {
+    char buf[64];
+    int col = 0;
+    while (col + 12 < panel->screen_width) {
+        int color = 31 + (seed + col) % 7;
+        snprintf(buf, sizeof(buf), "\033[%d;%dmitem-%04d\033[0m  ",
+                 (seed + col) % 3 == 0 ? 1 : 22, color, (seed * 7 + col) % 10000);
+        feed(panel, buf);
+        col += 11;
+    }
+    feed(panel, "\r\n");
+}
+
+static void colored_fill(terminal_panel_t *panel) {
+    for (int y = 0; y < panel->screen_height; y++) {
+        colored_line(panel, y);
+    }
+}
+
+static void colored_update(terminal_panel_t *panel, int frame) {
+    colored_line(panel, frame);
+}
+
+// Box drawing: htop / mc style frames in the DEC special graphics set
+static void boxdraw_fill(terminal_panel_t *panel) {
+    char buf[64];
+    int box_w = 20, box_h = 5;
+    for (int by = 0; by + box_h <= panel->screen_height; by += box_h) {
+        for (int bx = 0; bx + box_w <= panel->screen_width; bx += box_w) {
+            for (int y = 0; y < box_h; y++) {
+                snprintf(buf, sizeof(buf), "\033[%d;%dH\033(0", by + y + 1, bx + 1);
+                feed(panel, buf);
+                for (int x = 0; x < box_w; x++) {
+                    char ch = 'q';
+                    if (y == 0) {
+                        ch = (x == 0) ? 'l' : (x == box_w - 1) ? 'k' : 'q';
+                    } else if (y == box_h - 1) {
+                        ch = (x == 0) ? 'm' : (x == box_w - 1) ? 'j' : 'q';
+                    } else {
+                        ch = (x == 0 || x == box_w - 1) ? 'x' : ' ';
+                    }
+                    char cell[2] = { ch, '\0' };
+                    feed(panel, cell);
+                }
+                feed(panel, "\033(B");
+            }
+        }
+    }
+}
+
+static void boxdraw_update(terminal_panel_t *panel, int frame) {
+    char buf[64];
+    int boxes_x = panel->screen_width / 20;
+    int boxes_y = panel->screen_height / 5;
+    if (boxes_x == 0 || boxes_y == 0) {
+        return;
+    }
+    int box = frame % (boxes_x * boxes_y);
+    snprintf(buf, sizeof(buf), "\033[%d;%dH\033[33mCPU %5.1f%%\033[0m",
+             (box / boxes_x) * 5 + 3, (box % boxes_x) * 20 + 3, (frame * 37 % 1000) / 10.0);
+    feed(panel, buf);
+}
+
+// Wide characters: CJK text and emoji
+static void wide_line(terminal_panel_t *panel, int seed) {
+    static const char *words[] = { "漢字", "テスト", "한국어", "🐸", "✨", "端末", "🖥️" };
+    int col = 0;
+    while (col + 8 < panel->screen_width) {
+        feed(panel, words[(seed + col) % 7]);
+        feed(panel, " ");
+        col += 4;
+    }
+    feed(panel, "\r\n");
+}
+
+static void wide_fill(terminal_panel_t *panel) {
+    for (int y = 0; y < panel->screen_height; y++) {
+        wide_line(panel, y);
+    }
+}
+
+static void wide_update(terminal_panel_t *panel, int frame) {
+    wide_line(panel, frame);
+}
+
+// Repaint: a top-like tool rewriting the whole screen each frame, only its
+// clock line changing
+static void repaint_update(terminal_panel_t *panel, int frame) {
+    char clock[64];
+    snprintf(clock, sizeof(clock), "\033[H\033[2Jtop - 10:%02d:%02d up 3 days\r\n",
+             frame / 60 % 60, frame % 60);
+    feed(panel, clock);
+    for (int y = 1; y < panel->screen_height - 1; y++) {
+        dense_line(panel, y);
+    }
+}
+
+// Cursor: a full-screen program moving its cursor without printing
+static void cursor_update(terminal_panel_t *panel, int frame) {
+    char move[32];
+    snprintf(move, sizeof(move), "\033[%d;%dH", 1 + frame % panel->screen_height,
+             1 + (frame * 7) % panel->screen_width);
+    feed(panel, move);
+}
+
+// Drag: the overlay moves one cell per frame, back and forth, the way
+// move_panel() moves it; the "full" case is the old redraw of everything
+static void drag_update(terminal_panel_t *panel, int frame) {
+    int index = panel - mux.panels;
+    if (mux.panel_types[index] != PANEL_TYPE_OVERLAY) {
+        return;
+    }
+    int x = panel->start_x + ((frame / 8) % 2 ? -1 : 1);
+    mark_region_exposed(panel->start_x, panel->start_y, panel->width + 1, panel->height + 1);
+    mvwin(panel->win, panel->start_y, x);
+    panel->start_x = x;
+    mark_panel_chrome_dirty(index);
+}
+
+static const render_scenario_t scenarios[] = {
+    { "sparse",  sparse_fill,  sparse_update },
+    { "dense",   dense_fill,   dense_update },
+    { "colored", colored_fill, colored_update },
+    { "boxdraw", boxdraw_fill, boxdraw_update },
+    { "wide",    wide_fill,    wide_update },
+    { "repaint", dense_fill,   repaint_update },
+    { "cursor",  dense_fill,   cursor_update },
+    { "drag",    dense_fill,   drag_update },
+};
+
+// Time `frames` frames of one scenario; returns nanoseconds spent rendering
+static double measure_frames(const render_backend_t *backend, const render_scenario_t *scenario,
+                             bool full_redraw, int frames, long *bytes_out) {
+    bench_term_setup_layout(true);
+    for (int i = 0; i < mux.panel_count; i++) {
+        scenario->fill(&mux.panels[i]);
+        mux.panels[i].cells_damaged = false;
+    }
+
+    // Settle the first frame so the host screen matches the panels
+    mark_all_panels_dirty();
+    mark_status_dirty();
+    backend->frame();
+    bench_term_reset_output();
+
+    double elapsed = 0;
+    long bytes = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        for (int i = 0; i < mux.panel_count; i++) {
+            // Damage tracking as in parse_output()
+            scenario->update(&mux.panels[i], frame);
+            if (mux.panels[i].cells_damaged) {
+                mux.panels[i].cells_damaged = false;
+                mark_panel_dirty(i);
+            } else {
+                mark_cursor_dirty(i);
+            }
+        }
+        if (full_redraw) {
+            mark_all_panels_dirty();
+        }
+
+        double start = bench_now_ns();
+        backend->frame();
+        elapsed += bench_now_ns() - start;
+
+        bytes += bench_term_output_bytes();
+        bench_term_reset_output();
+    }
+
+    bench_term_teardown_layout();
+    *bytes_out = bytes;
+    return elapsed;
+}
+
+static void run_case(const render_backend_t *backend, const render_scenario_t *scenario,
+                     bool full_redraw, int frames, bool perf, double calibration) {
+    // Perf mode keeps the best of a few rounds to damp scheduler noise
+    int rounds = perf ? PERF_ROUNDS : 1;
+    double elapsed = 0;
+    long bytes = 0;
+    for (int round = 0; round < rounds; round++) {
+        long round_bytes = 0;
+        double round_elapsed = measure_frames(backend, scenario, full_redraw, frames, &round_bytes);
+        if (round == 0 || round_elapsed < elapsed) {
+            elapsed = round_elapsed;
+            bytes = round_bytes;
+        }
+    }
+
+    if (perf) {
+        char name[96];
+        snprintf(name, sizeof(name), "render.%s.%s.%s", backend->name, scenario->name,
+                 full_redraw ? "full" : "damage");
+        bench_perf_metric(name, elapsed / frames, calibration);
+    } else {
+        printf("%-12s %-9s %-7s %10.1f %12.1f %14.0f\n", backend->name, scenario->name,
+               full_redraw ? "full" : "damage", frames / elapsed * 1e9,
+               elapsed / 1e3 / frames, (double)bytes / frames);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    int positional[3] = { perf ? PERF_FRAMES : DEFAULT_FRAMES, DEFAULT_COLUMNS, DEFAULT_ROWS };
+    int count = 0;
+    for (int i = 1; i < argc && count < 3; i++) {
+        if (strcmp(argv[i], "--perf") != 0) {
+            positional[count++] = atoi(argv[i]);
+        }
+    }
+    int frames = positional[0], columns = positional[1], rows = positional[2];
+    if (frames <= 0 || columns < 40 || rows < 20) {
+        fprintf(stderr, "usage: %s [--perf] [frames] [columns >= 40] [rows >= 20]\n", argv[0]);
+        return 1;
+    }
+
+    double calibration = bench_calibrate();
+    if (!bench_term_open(columns, rows)) {
+        return 1;
+    }
+
+    if (!perf) {
+        printf("render benchmark: %dx%d host, %d frames per case\n\n",
+               mux.screen_width, mux.screen_height, frames);
+        printf("%-12s %-9s %-7s %10s %12s %14s\n", "backend", "scenario", "redraw",
+               "fps", "us/frame", "bytes/frame");
+    }
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+            run_case(&backends[b], &scenarios[s], false, frames, perf, calibration);
+            run_case(&backends[b], &scenarios[s], true, frames, perf, calibration);
+        }
+    }
+
+    bench_term_close();
+    return 0;
+}
@@ -0,0 +1,322 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+#include "toad.h"
+#include "bench.h"
+#include "bench_term.h"
+#include "bench_streams.h"
+
+// End-to-end replay benchmark: a recorded-style session is delivered to the
+// main panel in BUFFER_SIZE reads, and every read is followed by a frame, the
+// same parse -> mark dirty -> render_frame() cycle as the main loop.
+//
+// The reactor cases move the same session through real ptys instead: 8, 32
+// or 128 busy programs each write a BUFFER_SIZE chunk to their pty, then the
+// event loop backend drains all of them. Only the time spent in
+// reactor_wait() counts, so the cases compare what each backend costs per
+// byte of pty output, without parsing.
+//
+// The rewind case parses the session through the main panel's input ring,
+// recorded as toad records it, then rebuilds every REWIND_STRIDE-th frame
+// still recorded, newest first. A seek replays up to TOAD_REWIND_INTERVAL
+// bytes from the keyframe before its frame; the mean and worst seek are
+// reported.
+//
+// Usage: bench_replay [--perf]
+
+#define STREAM_BYTES (512 * 1024)
+#define ROUNDS 3
+#define HOST_COLUMNS 200
+#define HOST_ROWS 60
+#define REACTOR_BYTES (2 * 1024 * 1024)
+#define REWIND_STRIDE 8
+
+static const int reactor_panels[] = { 8, 32, 128 };
+static long reactor_bytes;
+static int reactor_ended;
+
+static double replay(const bench_stream_t *stream, bool with_overlay, long *bytes_out, int *frames_out) {
+    bench_term_setup_layout(with_overlay);
+    mux.active_panel = 0;
+    mark_all_panels_dirty();
+    mark_status_dirty();
+    render_frame();
+    bench_term_reset_output();
+
+    terminal_panel_t *panel = &mux.panels[0];
+    long bytes = 0;
+    int frames = 0;
+
+    double start = bench_now_ns();
+    for (size_t off = 0; off < stream->len; off += BUFFER_SIZE) {
+        size_t len = stream->len - off < BUFFER_SIZE ? stream->len - off : BUFFER_SIZE;
+        vte_parser_feed(panel, (const char *)stream->data + off, len);
+        if (panel->cells_damaged) {
+            panel->cells_damaged = false;
+            mark_panel_dirty(0);
+        } else {
+            mark_cursor_dirty(0);
+        }
+        if (render_frame()) {
+            frames++;
+        }
+        bytes += bench_term_output_bytes();
+        bench_term_reset_output();
+    }
+    double elapsed = bench_now_ns() - start;
+
+    bench_term_teardown_layout();
+    *bytes_out = bytes;
+    *frames_out = frames;
+    return elapsed;
+}
+
+// Returns the total seek time; *seeks_out and *worst_out get the seek count
+// and the slowest seek
+static double replay_rewind(const bench_stream_t *stream, int *seeks_out, double *worst_out) {
+    bench_term_setup_layout(false);
+    terminal_panel_t *panel = &mux.panels[0];
+    for (size_t off = 0; off < stream->len; off += BUFFER_SIZE) {
+        size_t len = stream->len - off < BUFFER_SIZE ? stream->len - off : BUFFER_SIZE;
+        struct iovec iov[2];
+        int count = vte_input_space(&panel->input, len, iov);
+        size_t stored = 0;
+        for (int i = 0; i < count; i++) {
+            memcpy(iov[i].iov_base, stream->data + off + stored, iov[i].iov_len);
+            stored += iov[i].iov_len;
+        }
+        vte_input_commit(&panel->input, stored);
+        vte_input_parse(&panel->input, panel);
+    }
+
+    const vte_recording_t *recording = &panel->recording;
+    terminal_panel_t view;
+    memset(&view, 0, sizeof(view));
+    double elapsed = 0, worst = 0;
+    int seeks = 0;
+    for (uint64_t frame = recording->frame_end;
+         frame >= vte_recording_first_frame(recording) + REWIND_STRIDE; ) {
+        frame -= REWIND_STRIDE;
+        double start = bench_now_ns();
+        vte_recording_seek(recording, frame, &view);
+        double seek = bench_now_ns() - start;
+        elapsed += seek;
+        worst = seek > worst ? seek : worst;
+        seeks++;
+    }
+    vte_recording_view_free(&view);
+
+    bench_term_teardown_layout();
+    *seeks_out = seeks;
+    *worst_out = worst;
+    return elapsed;
+}
+
+// Every pty reads into the same scratch buffer; the bytes are only counted
+static char reactor_scratch[BUFFER_SIZE];
+
+static int scratch_space(int fd, struct iovec *iov) {
+    (void)fd;
+    iov[0].iov_base = reactor_scratch;
+    iov[0].iov_len = sizeof(reactor_scratch);
+    return 1;
+}
+
+static void count_output(int fd, ssize_t len, uint8_t status) {
+    (void)fd;
+    (void)status;
+    if (len > 0) {
+        reactor_bytes += len;
+    } else {
+        reactor_ended++;
+    }
+}
+
+// Returns the reactor time, or a negative value when the ptys cannot be set up
+static double replay_reactor(reactor_backend_t backend, int panels, const bench_stream_t *stream,
+                             long *bytes_out, int *waits_out) {
+    int masters[128], slaves[128];
+    int opened = 0;
+    double elapsed = -1;
+
+    if (!reactor_init(backend, scratch_space, count_output) || reactor_backend() != backend) {
+        reactor_shutdown();
+        return -1;
+    }
+    for (; opened < panels; opened++) {
+        if (openpty(&masters[opened], &slaves[opened], NULL, NULL, NULL) != 0) {
+            goto done;
+        }
+        // Raw, so the output arrives as written
+        struct termios tio;
+        tcgetattr(slaves[opened], &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slaves[opened], TCSANOW, &tio);
+        fcntl(masters[opened], F_SETFL, fcntl(masters[opened], F_GETFL) | O_NONBLOCK);
+        fcntl(slaves[opened], F_SETFL, fcntl(slaves[opened], F_GETFL) | O_NONBLOCK);
+        if (!reactor_add_stream(masters[opened], false)) {
+            opened++;
+            goto done;
+        }
+    }
+
+    reactor_bytes = 0;
+    reactor_ended = 0;
+    long expected = 0;
+    int waits = 0;
+    elapsed = 0;
+    size_t off = 0;
+    for (long sent = 0; sent < REACTOR_BYTES; sent += (long)panels * BUFFER_SIZE) {
+        for (int i = 0; i < panels; i++) {
+            if (off + BUFFER_SIZE > stream->len) {
+                off = 0;
+            }
+            ssize_t n = write(slaves[i], stream->data + off, BUFFER_SIZE);
+            expected += n > 0 ? n : 0;
+            off += BUFFER_SIZE;
+        }
+        while (reactor_bytes < expected && reactor_ended == 0) {
+            fd_set read_fds, write_fds;
+            FD_ZERO(&read_fds);
+            FD_ZERO(&write_fds);
+            double start = bench_now_ns();
+            reactor_wait(&read_fds, &write_fds, -1, 100000);
+            elapsed += bench_now_ns() - start;
+            waits++;
+        }
+    }
+    *bytes_out = reactor_bytes;
+    *waits_out = waits;
+
+done:
+    for (int i = 0; i < opened; i++) {
+        reactor_remove_stream(masters[i]);
+        close(masters[i]);
+        close(slaves[i]);
+    }
+    reactor_shutdown();
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+
+    if (!bench_term_open(HOST_COLUMNS, HOST_ROWS)) {
+        return 1;
+    }
+
+    int panel_columns = (mux.screen_width * 7) / 10 - 2;
+    int panel_rows = (mux.screen_height * 7) / 10 - 2;
+    bench_stream_t stream = bench_stream_build(BENCH_STREAM_SESSION, STREAM_BYTES,
+                                               panel_columns, panel_rows);
+
+    if (!perf) {
+        printf("replay benchmark: %dx%d host, %zu KiB session in %d byte reads, best of %d\n\n",
+               mux.screen_width, mux.screen_height, stream.len >> 10, BUFFER_SIZE, ROUNDS);
+        printf("%-16s %10s %10s %10s %14s\n", "case", "MB/s", "ns/byte", "frames", "bytes/frame");
+    }
+
+    for (int overlay = 0; overlay <= 1; overlay++) {
+        const char *name = overlay ? "session+overlay" : "session";
+        long bytes = 0;
+        int frames = 0;
+        double elapsed = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            long round_bytes = 0;
+            int round_frames = 0;
+            double round_elapsed = replay(&stream, overlay, &round_bytes, &round_frames);
+            if (round == 0 || round_elapsed < elapsed) {
+                elapsed = round_elapsed;
+                bytes = round_bytes;
+                frames = round_frames;
+            }
+        }
+
+        if (perf) {
+            char metric[64];
+            snprintf(metric, sizeof(metric), "replay.%s", overlay ? "session_overlay" : "session");
+            bench_perf_metric(metric, elapsed / stream.len, calibration);
+        } else {
+            printf("%-16s %10.1f %10.2f %10d %14.0f\n", name, stream.len / elapsed * 1e3,
+                   elapsed / stream.len, frames, frames ? (double)bytes / frames : 0.0);
+        }
+    }
+
+    if (!perf) {
+        printf("\n%-16s %10s %10s %10s %14s\n", "reactor", "MB/s", "ns/byte", "waits", "bytes/wait");
+    }
+    for (int backend = REACTOR_SELECT; backend <= REACTOR_URING; backend++) {
+        for (size_t p = 0; p < sizeof(reactor_panels) / sizeof(reactor_panels[0]); p++) {
+            long bytes = 0;
+            int waits = 0;
+            double elapsed = 0;
+            for (int round = 0; round < ROUNDS; round++) {
+                long round_bytes = 0;
+                int round_waits = 0;
+                double round_elapsed = replay_reactor(backend, reactor_panels[p], &stream,
+                                                      &round_bytes, &round_waits);
+                if (round_elapsed < 0) {
+                    break;
+                }
+                if (round == 0 || round_elapsed < elapsed) {
+                    elapsed = round_elapsed;
+                    bytes = round_bytes;
+                    waits = round_waits;
+                }
+            }
+            if (bytes == 0) {
+                // The kernel lacks this backend; nothing to compare
+                continue;
+            }
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s x%d", reactor_backend_name(backend), reactor_panels[p]);
+            if (perf) {
+                char metric[64];
+                snprintf(metric, sizeof(metric), "replay.reactor_%s_%d",
+                         reactor_backend_name(backend), reactor_panels[p]);
+                bench_perf_metric(metric, elapsed / bytes, calibration);
+            } else {
+                printf("%-16s %10.1f %10.2f %10d %14.0f\n", name, bytes / elapsed * 1e3,
+                       elapsed / bytes, waits, waits ? (double)bytes / waits : 0.0);
+            }
+        }
+    }
+
+    int seeks = 0;
+    double worst = 0;
+    double elapsed = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        int round_seeks = 0;
+        double round_worst = 0;
+        double round_elapsed = replay_rewind(&stream, &round_seeks, &round_worst);
+        if (round == 0 || round_elapsed < elapsed) {
+            elapsed = round_elapsed;
+            seeks = round_seeks;
+            worst = round_worst;
+        }
+    }
+    if (perf) {
+        bench_perf_metric("replay.rewind_seek", seeks ? elapsed / seeks : 0, calibration);
+    } else {
+        printf("\n%-16s %10s %10s %10s\n", "rewind", "seeks", "mean us", "worst us");
+        printf("%-16s %10d %10.1f %10.1f\n", "session", seeks, seeks ? elapsed / seeks / 1e3 : 0.0,
+               worst / 1e3);
+    }
+
+    bench_stream_free(&stream);
+    bench_term_close();
+    return 0;
+}
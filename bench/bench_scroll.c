@@ -0,0 +1,112 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toad.h"
+#include "bench.h"
+
+// Scroll benchmark: cost of scrolling the panel grid one line at a time,
+// through the line feed path toad uses, a scrolling region and reverse index,
+// and line feeds while a snapshot of the screen is held.
+//
+// Usage: bench_scroll [--perf]
+
+#define PANEL_COLUMNS 200
+#define PANEL_ROWS 60
+#define SCROLL_LINES 20000
+#define ROUNDS 3
+
+typedef struct {
+    const char *name;
+    void (*run)(terminal_panel_t *panel);
+} scroll_case_t;
+
+static void scroll_linefeed(terminal_panel_t *panel) {
+    panel->cursor_y = panel->screen_height - 1;
+    vte_parser_feed(panel, "\n", 1);
+}
+
+static void scroll_region(terminal_panel_t *panel) {
+    panel->scroll_top = 5;
+    panel->scroll_bottom = panel->screen_height - 10;
+    terminal_scroll_up(panel, 1);
+}
+
+static void scroll_reverse(terminal_panel_t *panel) {
+    panel->cursor_y = 0;
+    vte_parser_feed(panel, "\033M", 2);
+}
+
+// A snapshot taken before every line feed and dropped after it: the cost of
+// sharing the rows plus copying the one row the line feed clears
+static void scroll_snapshot(terminal_panel_t *panel) {
+    vte_snapshot_t snapshot;
+    vte_snapshot_take(&snapshot, panel);
+    scroll_linefeed(panel);
+    vte_snapshot_free(&snapshot);
+}
+
+static const scroll_case_t cases[] = {
+    { "linefeed", scroll_linefeed },
+    { "region",   scroll_region },
+    { "reverse",  scroll_reverse },
+    { "snapshot", scroll_snapshot },
+};
+
+static double run_case(const scroll_case_t *scroll_case) {
+    terminal_panel_t panel;
+    memset(&panel, 0, sizeof(panel));
+    panel.width = PANEL_COLUMNS + 2;
+    panel.height = PANEL_ROWS + 2;
+    init_panel_screen(&panel);
+
+    // Start from a full screen so rows carry real content
+    for (int y = 0; y < PANEL_ROWS; y++) {
+        for (int x = 0; x < PANEL_COLUMNS; x++) {
+            panel.screen[y][x].codepoint = 'a' + (x + y) % 26;
+        }
+    }
+
+    double start = bench_now_ns();
+    for (int i = 0; i < SCROLL_LINES; i++) {
+        scroll_case->run(&panel);
+    }
+    double elapsed = bench_now_ns() - start;
+
+    free_panel_screen(&panel);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    bool perf = bench_perf_mode(argc, argv);
+    double calibration = bench_calibrate();
+
+    if (!perf) {
+        printf("scroll benchmark: %dx%d panel, %d lines per case, best of %d\n\n",
+               PANEL_COLUMNS, PANEL_ROWS, SCROLL_LINES, ROUNDS);
+        printf("%-10s %12s %14s\n", "case", "ns/line", "lines/s");
+    }
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        double best = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            double elapsed = run_case(&cases[c]);
+            if (round == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+
+        double ns_per_line = best / SCROLL_LINES;
+        if (perf) {
+            char name[64];
+            snprintf(name, sizeof(name), "scroll.%s", cases[c].name);
+            bench_perf_metric(name, ns_per_line, calibration);
+        } else {
+            printf("%-10s %12.1f %14.0f\n", cases[c].name, ns_per_line, 1e9 / ns_per_line);
+        }
+    }
+
+    return 0;
+}
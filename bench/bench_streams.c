@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_streams.h"
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} stream_buffer_t;
+
+static void append(stream_buffer_t *buf, const char *text, size_t len) {
+    if (buf->len + len > buf->cap) {
+        size_t cap = buf->cap ? buf->cap * 2 : 65536;
+        while (cap < buf->len + len) {
+            cap *= 2;
+        }
+        buf->data = realloc(buf->data, cap);
+        if (!buf->data) {
+            fprintf(stderr, "bench_streams: out of memory\n");
+            exit(1);
+        }
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, text, len);
+    buf->len += len;
+}
+
+static void append_str(stream_buffer_t *buf, const char *text) {
+    append(buf, text, strlen(text));
+}
+
+static void ascii_line(stream_buffer_t *buf, int seed, int columns) {
+    static const char *words[] = {
+        "static", "void", "int", "return", "panel->cursor_x", "if", "for",
+        "(", ")", "{", "}", ";", "while", "buffer", "size_t", "len", "=", "+"
+    };
+    int col = 0;
+    while (col < columns - 16) {
+        const char *word = words[(seed * 7 + col) % 18];
+        append_str(buf, word);
+        append_str(buf, " ");
+        col += (int)strlen(word) + 1;
+    }
+    append_str(buf, "\r\n");
+}
+
+static void sgr_line(stream_buffer_t *buf, int seed, int columns) {
+    char chunk[64];
+    int col = 0;
+    while (col < columns - 16) {
+        int n = snprintf(chunk, sizeof(chunk), "\033[%d;%dm%s-%03d\033[0m ",
+                         (seed + col) % 3 == 0 ? 1 : 22, 31 + (seed + col) % 7,
+                         (col % 2) ? "file" : "dir", (seed * 13 + col) % 1000);
+        append(buf, chunk, (size_t)n);
+        col += 9;
+    }
+    append_str(buf, "\r\n");
+}
+
+static void utf8_line(stream_buffer_t *buf, int seed, int columns) {
+    static const char *words[] = { "漢字", "テスト", "한국어", "🐸", "✨", "端末", "café", "naïve" };
+    int col = 0;
+    while (col < columns - 8) {
+        append_str(buf, words[(seed + col) % 8]);
+        append_str(buf, " ");
+        col += 5;
+    }
+    append_str(buf, "\r\n");
+}
+
+static void cursor_screen(stream_buffer_t *buf, int seed, int columns, int rows) {
+    char chunk[64];
+    append_str(buf, "\033[H\033[2J");
+    for (int y = 1; y <= rows; y++) {
+        int n = snprintf(chunk, sizeof(chunk), "\033[%d;1H\033[K\033[33m%4d\033[0m ", y, seed + y);
+        append(buf, chunk, (size_t)n);
+        ascii_line(buf, seed + y, columns - 6);
+        buf->len -= 2; // Editors position every line; drop the CRLF
+    }
+    int n = snprintf(chunk, sizeof(chunk), "\033[%d;1H\033[7m-- INSERT --\033[0m\033[%d;%dH",
+                     rows, 1 + seed % rows, 1 + seed % columns);
+    append(buf, chunk, (size_t)n);
+}
+
+static void base64_payload(stream_buffer_t *buf, int seed, size_t len) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char chunk[256];
+    for (size_t done = 0; done < len; done += sizeof(chunk)) {
+        size_t n = len - done < sizeof(chunk) ? len - done : sizeof(chunk);
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] = alphabet[(seed * 31 + done + i * 7) % 64];
+        }
+        append(buf, chunk, n);
+    }
+}
+
+// What an image viewer or clipboard tool in a remote shell writes: a title,
+// a copied selection, an inline image and a small sixel, each followed by
+// a line of text
+static void string_payloads(stream_buffer_t *buf, int seed, int columns) {
+    char chunk[64];
+    int n = snprintf(chunk, sizeof(chunk), "\033]0;toad %d\007", seed);
+    append(buf, chunk, (size_t)n);
+    append_str(buf, "\033]52;c;");
+    base64_payload(buf, seed, 4096 + (seed % 4) * 1024);
+    append_str(buf, "\007");
+    ascii_line(buf, seed, columns);
+    append_str(buf, "\033_Ga=T,f=100;");
+    base64_payload(buf, seed + 1, 16384);
+    append_str(buf, "\033\\");
+    ascii_line(buf, seed + 1, columns);
+    append_str(buf, "\033Pq#0;2;0;0;0#1;2;100;100;0");
+    for (int i = 0; i < 32; i++) {
+        append_str(buf, "#1~~@@vv@@~~@@vv@@~~$-");
+    }
+    append_str(buf, "\033\\");
+}
+
+bench_stream_t bench_stream_build(bench_stream_kind_t kind, size_t target_len,
+                                  int columns, int rows) {
+    static const char *names[BENCH_STREAM_COUNT] = {
+        "ascii", "sgr", "utf8", "cursor", "session", "osc"
+    };
+    stream_buffer_t buf = {0};
+    int seed = 0;
+
+    while (buf.len < target_len) {
+        switch (kind) {
+            case BENCH_STREAM_ASCII:
+                ascii_line(&buf, seed, columns);
+                break;
+            case BENCH_STREAM_SGR:
+                sgr_line(&buf, seed, columns);
+                break;
+            case BENCH_STREAM_UTF8:
+                utf8_line(&buf, seed, columns);
+                break;
+            case BENCH_STREAM_CURSOR:
+                cursor_screen(&buf, seed, columns, rows);
+                break;
+            case BENCH_STREAM_SESSION:
+                // Prompt, command output, then a full-screen program
+                append_str(&buf, "\033[32muser@toad\033[0m:\033[34m~/src\033[0m$ make\r\n");
+                for (int i = 0; i < rows; i++) {
+                    switch ((seed + i) % 3) {
+                        case 0: ascii_line(&buf, seed + i, columns); break;
+                        case 1: sgr_line(&buf, seed + i, columns); break;
+                        case 2: utf8_line(&buf, seed + i, columns); break;
+                    }
+                }
+                append_str(&buf, "\033[?1049h");
+                cursor_screen(&buf, seed, columns, rows);
+                append_str(&buf, "\033[?1049l");
+                break;
+            case BENCH_STREAM_OSC:
+                string_payloads(&buf, seed, columns);
+                break;
+            default:
+                break;
+        }
+        seed++;
+    }
+
+    bench_stream_t stream = { names[kind], buf.data, buf.len };
+    return stream;
+}
+
+void bench_stream_free(bench_stream_t *stream) {
+    free(stream->data);
+    stream->data = NULL;
+    stream->len = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef BENCH_STREAMS_H
+#define BENCH_STREAMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Synthetic terminal output streams shared by the parser and replay
+// benchmarks. Each stream is generated deterministically for a given
+// terminal width so results are reproducible between runs.
+
+typedef enum {
+    BENCH_STREAM_ASCII,   // Plain text lines (cat of a source file)
+    BENCH_STREAM_SGR,     // Dense SGR color runs (ls --color, compiler output)
+    BENCH_STREAM_UTF8,    // CJK text and emoji
+    BENCH_STREAM_CURSOR,  // Cursor addressing and erases (full-screen editors)
+    BENCH_STREAM_SESSION, // Mix of all of the above, like a recorded session
+    BENCH_STREAM_OSC,     // Titles, base64 clipboard (OSC 52), image (APC) and
+                          // sixel (DCS) payloads between short lines
+    BENCH_STREAM_COUNT
+} bench_stream_kind_t;
+
+typedef struct {
+    const char *name;
+    uint8_t *data;
+    size_t len;
+} bench_stream_t;
+
+// Build a stream of roughly target_len bytes; free with bench_stream_free()
+bench_stream_t bench_stream_build(bench_stream_kind_t kind, size_t target_len,
+                                  int columns, int rows);
+void bench_stream_free(bench_stream_t *stream);
+
+#endif // BENCH_STREAMS_H
@@ -0,0 +1,111 @@
+#define _DEFAULT_SOURCE  // tmpfile(), ftruncate() and setenv() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <locale.h>
+
+#include "bench_term.h"
+
+multiplexer_t mux;
+
+static FILE *term_out;
+static FILE *term_in;
+static SCREEN *term_screen;
+
+bool bench_term_open(int columns, int rows) {
+    // ncurses takes the screen size from the environment when the output
+    // stream is not a tty
+    char value[16];
+    snprintf(value, sizeof(value), "%d", columns);
+    setenv("COLUMNS", value, 1);
+    snprintf(value, sizeof(value), "%d", rows);
+    setenv("LINES", value, 1);
+    setlocale(LC_ALL, "");
+
+    term_out = tmpfile();
+    term_in = fopen("/dev/null", "r");
+    if (!term_out || !term_in) {
+        perror("bench_term_open");
+        return false;
+    }
+
+    term_screen = newterm("xterm-256color", term_out, term_in);
+    if (!term_screen) {
+        fprintf(stderr, "bench_term_open: newterm failed (is xterm-256color in terminfo?)\n");
+        return false;
+    }
+    set_term(term_screen);
+    init_render_colors();
+
+    memset(&mux, 0, sizeof(mux));
+    getmaxyx(stdscr, mux.screen_height, mux.screen_width);
+    return true;
+}
+
+void bench_term_close(void) {
+    free_render_cache();
+    endwin();
+    delscreen(term_screen);
+    fclose(term_in);
+    fclose(term_out);
+}
+
+long bench_term_output_bytes(void) {
+    fflush(term_out);
+    return ftell(term_out);
+}
+
+void bench_term_reset_output(void) {
+    fflush(term_out);
+    rewind(term_out);
+    if (ftruncate(fileno(term_out), 0) != 0) {
+        perror("ftruncate");
+    }
+}
+
+void bench_term_setup_panel(int index, panel_type_t type, int x, int y, int width, int height) {
+    terminal_panel_t *panel = &mux.panels[index];
+    memset(panel, 0, sizeof(*panel));
+    panel->start_x = x;
+    panel->start_y = y;
+    panel->width = width;
+    panel->height = height;
+    panel->active = 1;
+    panel->master_fd = -1;
+    panel->child_pid = -1;
+    panel->win = newwin(height, width, y, x);
+    init_panel_screen(panel);
+
+    mux.panel_types[index] = type;
+    mux.panel_z_order[index] = index;
+    mux.panel_count = index + 1;
+    mux.active_panel = index;
+}
+
+void bench_term_setup_layout(bool with_overlay) {
+    mux.zoomed_panel = -1;
+    mux.rewound_panel = -1;
+    int main_w = (mux.screen_width * 7) / 10;
+    int main_h = (mux.screen_height * 7) / 10;
+    bench_term_setup_panel(0, PANEL_TYPE_MAIN, (mux.screen_width - main_w) / 2,
+                           (mux.screen_height - main_h) / 2, main_w, main_h);
+
+    if (with_overlay) {
+        int overlay_w = mux.screen_width / 2;
+        int overlay_h = mux.screen_height / 2;
+        bench_term_setup_panel(1, PANEL_TYPE_OVERLAY, (mux.screen_width - overlay_w) / 2,
+                               (mux.screen_height - overlay_h) / 2, overlay_w, overlay_h);
+    }
+}
+
+void bench_term_teardown_layout(void) {
+    for (int i = 0; i < mux.panel_count; i++) {
+        delwin(mux.panels[i].win);
+        free_panel_screen(&mux.panels[i]);
+        free_panel_chrome(i);
+    }
+    mux.panel_count = 0;
+    mux.active_panel = 0;
+}
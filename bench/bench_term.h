@@ -0,0 +1,26 @@
+#ifndef BENCH_TERM_H
+#define BENCH_TERM_H
+
+#include <stdbool.h>
+
+#include "toad.h"
+
+// Virtual host terminal for the render and replay benchmarks: an ncurses
+// screen created with newterm() on a temporary file, so output bytes can be
+// counted without a tty.
+
+bool bench_term_open(int columns, int rows);
+void bench_term_close(void);
+
+// Bytes the renderer has written since the last reset
+long bench_term_output_bytes(void);
+void bench_term_reset_output(void);
+
+// Create a panel with a window and screen buffer but no pty or child
+void bench_term_setup_panel(int index, panel_type_t type, int x, int y, int width, int height);
+
+// Same geometry as toad: a 70% main panel, optionally with a 50% overlay
+void bench_term_setup_layout(bool with_overlay);
+void bench_term_teardown_layout(void);
+
+#endif // BENCH_TERM_H
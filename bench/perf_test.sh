@@ -0,0 +1,120 @@
+#!/bin/sh
+# Performance regression check.
+#
+# Usage: perf_test.sh <baseline-file> <benchmark>...
+#
+# Runs every benchmark with --perf, which prints "metric value" lines
+# normalized by the calibration loop in bench/bench.h, and compares each
+# metric with the baseline file. A metric fails when it is slower than its
+# baseline by more than its tolerance band (percent, third column of the
+# baseline, or PERF_TOLERANCE for all metrics). Metrics missing from the
+# baseline are reported but do not fail, and so are metrics whose tolerance
+# is "-": ones bound by system calls rather than CPU time, which the
+# calibration loop cannot normalize across machines.
+#
+# PERF_UPDATE=1 rewrites the baseline from this run, keeping the tolerance
+# of metrics already listed and using PERF_DEFAULT_TOLERANCE for new ones.
+# PERF_RUNS=n runs the suite n times and compares the median of each metric.
+
+baseline="$1"
+shift
+if [ -z "$baseline" ] || [ $# -eq 0 ]; then
+    echo "usage: $0 <baseline-file> <benchmark>..." >&2
+    exit 2
+fi
+
+results=$(mktemp)
+trap 'rm -f "$results"' EXIT
+
+# PERF_RUNS repeats the whole suite and keeps the median of every metric
+runs="${PERF_RUNS:-1}"
+raw=$(mktemp)
+trap 'rm -f "$results" "$raw"' EXIT
+run=0
+while [ "$run" -lt "$runs" ]; do
+    for bench in "$@"; do
+        if ! "$bench" --perf >> "$raw"; then
+            echo "perf-test: $bench failed" >&2
+            exit 1
+        fi
+    done
+    run=$((run + 1))
+done
+
+awk '
+    { if (!($1 in count)) order[n++] = $1; values[$1, count[$1]++] = $2 }
+    END {
+        for (i = 0; i < n; i++) {
+            m = order[i]; c = count[m]
+            for (j = 0; j < c; j++) sorted[j] = values[m, j]
+            for (j = 1; j < c; j++) {
+                v = sorted[j]
+                for (k = j - 1; k >= 0 && sorted[k] > v; k--) sorted[k + 1] = sorted[k]
+                sorted[k + 1] = v
+            }
+            print m, sorted[int(c / 2)]
+        }
+    }
+' "$raw" > "$results"
+
+if [ "${PERF_UPDATE:-0}" = "1" ]; then
+    tmp=$(mktemp)
+    {
+        echo "# toad performance baseline (make perf-baseline)"
+        echo "#"
+        echo "# Values are nanoseconds per unit of work (byte, line or frame) divided"
+        echo "# by the calibration loop time in bench/bench.h, times 1e6, measured with"
+        echo "# the default CFLAGS. make perf-test fails when a metric is slower than"
+        echo "# its baseline by more than the tolerance in percent. A tolerance of"
+        echo "# - only reports the metric: it is bound by system calls, which the"
+        echo "# calibration loop does not measure."
+        echo "#"
+        echo "# metric                                       baseline  tolerance%"
+        known="$baseline"
+        [ -f "$known" ] || known=/dev/null
+        awk -v default_tol="${PERF_DEFAULT_TOLERANCE:-30}" '
+            FILENAME == ARGV[1] { if ($1 !~ /^#/ && NF >= 3) tol[$1] = $3; next }
+            { t = ($1 in tol) ? tol[$1] : default_tol
+              printf "%-40s %14.4f  %s\n", $1, $2, t }
+        ' "$known" "$results"
+    } > "$tmp"
+    mv "$tmp" "$baseline"
+    echo "perf-test: baseline written to $baseline"
+    exit 0
+fi
+
+if [ ! -f "$baseline" ]; then
+    echo "perf-test: no baseline at $baseline (run make perf-baseline)" >&2
+    exit 1
+fi
+
+awk -v override="${PERF_TOLERANCE:-}" '
+    BEGIN { checked = 0; failed = 0 }
+    FILENAME == ARGV[1] {
+        if ($1 !~ /^#/ && NF >= 3) { base[$1] = $2; tol[$1] = $3 }
+        next
+    }
+    {
+        metric = $1; value = $2
+        if (!(metric in base)) {
+            printf "  NEW   %-40s %14.4f (not in baseline)\n", metric, value
+            next
+        }
+        change = (value - base[metric]) / base[metric] * 100
+        if (tol[metric] == "-") {
+            printf "  info  %-40s %14.4f vs %14.4f  %+6.1f%% (not checked)\n",
+                   metric, value, base[metric], change
+            next
+        }
+        limit = (override != "") ? override : tol[metric]
+        status = "ok"
+        if (change > limit) { status = "FAIL"; failed++ }
+        printf "  %-5s %-40s %14.4f vs %14.4f  %+6.1f%% (limit +%s%%)\n",
+               status, metric, value, base[metric], change, limit
+        checked++
+    }
+    END {
+        printf "\nperf-test: %d metrics checked, %d regressions\n", checked, failed
+        exit (failed > 0) ? 1 : 0
+    }
+' "$baseline" "$results"
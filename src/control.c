@@ -0,0 +1,812 @@
+#define _DEFAULT_SOURCE  // strdup(), setenv() and friends under -std=c99
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "toad.h"
+
+// Control socket: a Unix domain socket at $TMPDIR/toad-<pid>.sock (exported
+// to panels as TOAD_SOCKET) that accepts line-based commands, so scripts can
+// drive toad without injecting keystrokes.
+//
+// Commands are queued as they arrive and applied together by control_apply()
+// once per main loop iteration, right before render_frame(), so everything
+// received since the last frame lands in a single redraw. Lines between
+// "begin" and "commit" are held back until the commit arrives and then
+// queued at once, so a batch split across several socket reads is still
+// applied within one frame. A batch that does not fit in the queue is
+// dropped whole with "error queue full".
+//
+// Each command gets one reply: "ok", "ok <n>" followed by n bytes of payload,
+// or "error <message>". Panels are addressed by index or "active".
+//
+//   new [command...]            overlay panel running command (or the shell)
+//   split <panel> h|v [command...]  tile side by side (h) or stacked (v)
+//   close <panel>
+//   focus <panel>
+//   zoom <panel>                give the panel the whole screen, or undo that
+//   send <panel> <text>         text with \n \r \t \e \xHH \\ escapes
+//   capture <panel> [text|ansi|html] [first [last]]
+//   resize <panel> <width> <height>
+//   move <panel> <x> <y>        overlays only, kept on screen
+//   hibernate <panel>           pack an unfocused panel now, as if it were idle
+//   rewind <panel> [frames]     show the panel as it was frames parses ago
+//                               (default 1), replying "ok frame <n>"
+//   rewind off                  back to the live screen
+//   list                        one line per panel: index tiled|overlay x y w h
+//   metrics                     performance counters, Prometheus text format
+//   begin / commit
+
+#define CONTROL_MAX_CLIENTS 8
+#define CONTROL_MAX_LINE 4096
+#define CONTROL_MAX_QUEUE 1024
+#define CONTROL_MAX_OUTPUT (64 * 1024 * 1024)
+
+typedef struct {
+    int fd;                       // -1 when the slot is free
+    unsigned serial;              // Tells a reused slot from its previous client
+    char in[CONTROL_MAX_LINE];
+    size_t in_len;
+    char *out;
+    size_t out_len, out_cap;
+    bool eof;                     // Peer finished sending
+    bool in_batch;                // Between begin and commit
+    char *batch[CONTROL_MAX_QUEUE];
+    int batch_len;
+    int queued;                   // Commands waiting in the global queue
+} control_client_t;
+
+typedef struct {
+    int client;
+    unsigned serial;
+    char *line;
+} control_command_t;
+
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static control_client_t clients[CONTROL_MAX_CLIENTS];
+static unsigned next_serial = 1;
+static control_command_t queue[CONTROL_MAX_QUEUE];
+static int queue_len = 0;
+
+static void client_close(control_client_t *client) {
+    reactor_forget_fd(client->fd);
+    close(client->fd);
+    client->fd = -1;
+    free(client->out);
+    client->out = NULL;
+    client->out_len = client->out_cap = 0;
+    for (int i = 0; i < client->batch_len; i++) {
+        free(client->batch[i]);
+    }
+    client->batch_len = 0;
+}
+
+static void client_write(control_client_t *client, const char *data, size_t len) {
+    if (client->fd < 0) {
+        return;
+    }
+    if (client->out_len + len > client->out_cap) {
+        size_t cap = client->out_cap ? client->out_cap : 4096;
+        while (cap < client->out_len + len) {
+            cap *= 2;
+        }
+        char *out = cap <= CONTROL_MAX_OUTPUT ? realloc(client->out, cap) : NULL;
+        if (!out) {
+            // A client that does not read its replies is dropped
+            client_close(client);
+            return;
+        }
+        client->out = out;
+        client->out_cap = cap;
+    }
+    memcpy(client->out + client->out_len, data, len);
+    client->out_len += len;
+}
+
+static void client_flush(control_client_t *client) {
+    while (client->fd >= 0 && client->out_len > 0) {
+        ssize_t n = write(client->fd, client->out, client->out_len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                client_close(client);
+            }
+            return;
+        }
+        memmove(client->out, client->out + n, client->out_len - n);
+        client->out_len -= n;
+    }
+}
+
+static void reply(control_client_t *client, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void reply(control_client_t *client, const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    if (len > (int)sizeof(line) - 2) {
+        len = sizeof(line) - 2;
+    }
+    line[len++] = '\n';
+    client_write(client, line, len);
+}
+
+static void reply_payload(control_client_t *client, const char *data, size_t len) {
+    reply(client, "ok %zu", len);
+    client_write(client, data, len);
+}
+
+static void enqueue(int index, char *line) {
+    control_client_t *client = &clients[index];
+    if (queue_len >= CONTROL_MAX_QUEUE) {
+        reply(client, "error queue full");
+        free(line);
+        return;
+    }
+    queue[queue_len].client = index;
+    queue[queue_len].serial = client->serial;
+    queue[queue_len].line = line;
+    queue_len++;
+    client->queued++;
+}
+
+// A complete line from a client: batch control is handled on arrival, every
+// other command waits in the queue for the next frame
+static void client_line(int index, char *line) {
+    control_client_t *client = &clients[index];
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+        line[len - 1] = '\0';
+    }
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (*line == '\0') {
+        return;
+    }
+
+    if (strcmp(line, "begin") == 0) {
+        if (client->in_batch) {
+            reply(client, "error already in a batch");
+        } else {
+            client->in_batch = true;
+            reply(client, "ok");
+        }
+        return;
+    }
+    if (strcmp(line, "commit") == 0) {
+        if (!client->in_batch) {
+            reply(client, "error no batch");
+            return;
+        }
+        // All of the batch is applied or none of it
+        bool room = queue_len + client->batch_len <= CONTROL_MAX_QUEUE;
+        for (int i = 0; i < client->batch_len; i++) {
+            if (room) {
+                enqueue(index, client->batch[i]);
+            } else {
+                free(client->batch[i]);
+            }
+        }
+        client->batch_len = 0;
+        client->in_batch = false;
+        reply(client, room ? "ok" : "error queue full");
+        return;
+    }
+
+    char *copy = strdup(line);
+    if (!copy) {
+        reply(client, "error out of memory");
+        return;
+    }
+    if (client->in_batch) {
+        if (client->batch_len >= CONTROL_MAX_QUEUE) {
+            reply(client, "error batch too large");
+            free(copy);
+            return;
+        }
+        client->batch[client->batch_len++] = copy;
+    } else {
+        enqueue(index, copy);
+    }
+}
+
+static void client_read(int index) {
+    control_client_t *client = &clients[index];
+    ssize_t n = read(client->fd, client->in + client->in_len, sizeof(client->in) - client->in_len);
+    if (n <= 0) {
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            client->eof = true;
+        }
+        return;
+    }
+    client->in_len += n;
+
+    size_t start = 0;
+    for (size_t i = 0; i < client->in_len; i++) {
+        if (client->in[i] == '\n') {
+            client->in[i] = '\0';
+            client_line(index, client->in + start);
+            start = i + 1;
+        }
+    }
+    if (start == 0 && client->in_len == sizeof(client->in)) {
+        reply(client, "error line too long");
+        client->in_len = 0;
+        return;
+    }
+    memmove(client->in, client->in + start, client->in_len - start);
+    client->in_len -= start;
+}
+
+static void accept_client(void) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            memset(&clients[i], 0, sizeof(clients[i]));
+            clients[i].fd = fd;
+            clients[i].serial = next_serial++;
+            return;
+        }
+    }
+    close(fd); // All slots busy
+}
+
+bool control_init(void) {
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !*dir) {
+        dir = "/tmp";
+    }
+    int len = snprintf(socket_path, sizeof(socket_path), "%s/toad-%d.sock", dir, (int)getpid());
+    if (len < 0 || len >= (int)sizeof(socket_path)) {
+        socket_path[0] = '\0';
+        return false;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, len + 1);
+    unlink(socket_path);
+
+    // Only the owner may connect
+    mode_t old_umask = umask(077);
+    int bound = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_umask);
+    if (bound != 0 || listen(listen_fd, CONTROL_MAX_CLIENTS) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        socket_path[0] = '\0';
+        return false;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+    setenv("TOAD_SOCKET", socket_path, 1);
+    return true;
+}
+
+void control_shutdown(void) {
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            client_close(&clients[i]);
+        }
+    }
+    for (int i = 0; i < queue_len; i++) {
+        free(queue[i].line);
+    }
+    queue_len = 0;
+    if (listen_fd >= 0) {
+        reactor_forget_fd(listen_fd);
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path);
+    }
+}
+
+int control_add_fds(fd_set *read_fds, fd_set *write_fds, int max_fd) {
+    if (listen_fd < 0) {
+        return max_fd;
+    }
+    FD_SET(listen_fd, read_fds);
+    if (listen_fd > max_fd) {
+        max_fd = listen_fd;
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        control_client_t *client = &clients[i];
+        if (client->fd < 0) {
+            continue;
+        }
+        if (!client->eof) {
+            FD_SET(client->fd, read_fds);
+        }
+        if (client->out_len > 0) {
+            FD_SET(client->fd, write_fds);
+        }
+        if (client->fd > max_fd) {
+            max_fd = client->fd;
+        }
+    }
+    return max_fd;
+}
+
+void control_handle_fds(fd_set *read_fds, fd_set *write_fds) {
+    if (listen_fd < 0) {
+        return;
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        control_client_t *client = &clients[i];
+        if (client->fd >= 0 && FD_ISSET(client->fd, write_fds)) {
+            client_flush(client);
+        }
+        if (client->fd >= 0 && !client->eof && FD_ISSET(client->fd, read_fds)) {
+            client_read(i);
+        }
+        // Close once everything the client sent has been answered
+        if (client->fd >= 0 && client->eof && client->queued == 0 && client->out_len == 0) {
+            client_close(client);
+        }
+    }
+    if (FD_ISSET(listen_fd, read_fds)) {
+        accept_client();
+    }
+}
+
+// Command arguments
+
+static char *next_word(char **cursor) {
+    char *p = *cursor;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0') {
+        *cursor = p;
+        return NULL;
+    }
+    char *word = p;
+    while (*p && !isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p) {
+        *p++ = '\0';
+    }
+    *cursor = p;
+    return word;
+}
+
+static bool parse_int(const char *word, int *value) {
+    if (!word || !*word) {
+        return false;
+    }
+    char *end;
+    long parsed = strtol(word, &end, 10);
+    if (*end != '\0' || parsed < -0x7FFFFFFF || parsed > 0x7FFFFFFF) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+static bool parse_panel(control_client_t *client, const char *word, int *index) {
+    if (word && strcmp(word, "active") == 0) {
+        *index = mux.active_panel;
+        return true;
+    }
+    if (!parse_int(word, index) || *index < 0 || *index >= mux.panel_count) {
+        reply(client, "error no such panel");
+        return false;
+    }
+    return true;
+}
+
+// Decode \n \r \t \e \xHH and \\ in place, returns the decoded length
+static size_t unescape(char *text) {
+    char *out = text;
+    for (char *p = text; *p; p++) {
+        if (*p != '\\' || p[1] == '\0') {
+            *out++ = *p;
+            continue;
+        }
+        p++;
+        switch (*p) {
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'e': *out++ = '\033'; break;
+            case 'x':
+                if (isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+                    char hex[3] = { p[1], p[2], '\0' };
+                    *out++ = (char)strtol(hex, NULL, 16);
+                    p += 2;
+                } else {
+                    *out++ = 'x';
+                }
+                break;
+            default: *out++ = *p; break;
+        }
+    }
+    return out - text;
+}
+
+// Prometheus text format
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} metrics_buf_t;
+
+static void metrics_printf(metrics_buf_t *buf, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void metrics_printf(metrics_buf_t *buf, const char *format, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+        va_end(args);
+        if (n < 0) {
+            return;
+        }
+        if (buf->len + n < buf->cap) {
+            buf->len += n;
+            return;
+        }
+        size_t cap = buf->cap ? buf->cap * 2 : 4096;
+        while (cap <= buf->len + n) {
+            cap *= 2;
+        }
+        char *data = realloc(buf->data, cap);
+        if (!data) {
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+}
+
+static void metric(metrics_buf_t *buf, const char *name, const char *type,
+                   const char *help, double value) {
+    metrics_printf(buf, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n", name, help, name, type, name, value);
+}
+
+static void command_metrics(control_client_t *client) {
+    const toad_stats_t *stats = &mux.stats;
+    metrics_buf_t buf = { NULL, 0, 0 };
+
+    metric(&buf, "toad_pty_reads_total", "counter", "Reads of panel pty output.", stats->pty_reads);
+    metric(&buf, "toad_pty_bytes_total", "counter", "Bytes read from panel ptys.", stats->pty_bytes);
+    metric(&buf, "toad_parse_seconds_total", "counter", "Time spent parsing pty output.",
+           stats->parse_ns / 1e9);
+    metric(&buf, "toad_pty_bytes_deferred_total", "counter",
+           "Bytes of hidden panels' output held back to be parsed later.", stats->pty_bytes_deferred);
+    metric(&buf, "toad_parse_catch_ups_total", "counter",
+           "Held back output parsed in one go.", stats->catch_ups);
+    metric(&buf, "toad_pty_flushes_total", "counter",
+           "Output flushes reported by the panels' line discipline.", stats->pty_flushes);
+    metric(&buf, "toad_pty_bytes_flushed_total", "counter",
+           "Held back output dropped because the program's output was flushed.", stats->pty_bytes_flushed);
+    metric(&buf, "toad_frames_total", "counter", "Frames sent to the terminal.", stats->frames);
+    metric(&buf, "toad_cursor_frames_total", "counter", "Frames that only moved the cursor.",
+           stats->cursor_frames);
+    metric(&buf, "toad_panels_drawn_total", "counter", "Panels drawn.", stats->panels_drawn);
+    metric(&buf, "toad_rows_unchanged_total", "counter",
+           "Rows of drawn panels skipped because their content had not changed.", stats->rows_unchanged);
+    metric(&buf, "toad_render_seconds_total", "counter", "Time spent rendering frames.",
+           stats->render_ns / 1e9);
+    metric(&buf, "toad_control_commands_total", "counter", "Control socket commands applied.",
+           stats->control_commands);
+    metric(&buf, "toad_control_batches_total", "counter",
+           "Groups of control commands applied between two frames.", stats->control_batches);
+    metric(&buf, "toad_hibernations_total", "counter", "Idle panels packed to save memory.",
+           stats->hibernations);
+    metric(&buf, "toad_rewind_seeks_total", "counter", "Earlier screens of panels rebuilt for rewinding.",
+           stats->rewind_seeks);
+    metric(&buf, "toad_rewind_seconds_total", "counter", "Time spent rebuilding them.",
+           stats->rewind_ns / 1e9);
+    metric(&buf, "toad_panels", "gauge", "Open panels.", mux.panel_count);
+
+    metrics_printf(&buf, "# HELP toad_panel_scrollback_lines Lines of scrollback history.\n"
+                         "# TYPE toad_panel_scrollback_lines gauge\n");
+    for (int i = 0; i < mux.panel_count; i++) {
+        metrics_printf(&buf, "toad_panel_scrollback_lines{panel=\"%d\"} %zu\n", i,
+                       vte_scrollback_count(&mux.panels[i].scrollback));
+    }
+    metrics_printf(&buf, "# HELP toad_panel_scrollback_unique_lines Distinct lines stored for the history.\n"
+                         "# TYPE toad_panel_scrollback_unique_lines gauge\n");
+    for (int i = 0; i < mux.panel_count; i++) {
+        metrics_printf(&buf, "toad_panel_scrollback_unique_lines{panel=\"%d\"} %zu\n", i,
+                       mux.panels[i].scrollback.unique);
+    }
+    metrics_printf(&buf, "# HELP toad_panel_scrollback_shared_bytes Cell memory saved by storing repeated lines once and plain lines compact.\n"
+                         "# TYPE toad_panel_scrollback_shared_bytes gauge\n");
+    for (int i = 0; i < mux.panel_count; i++) {
+        size_t referenced, stored;
+        vte_scrollback_memory(&mux.panels[i].scrollback, &referenced, &stored);
+        metrics_printf(&buf, "toad_panel_scrollback_shared_bytes{panel=\"%d\"} %zu\n", i,
+                       referenced - stored);
+    }
+    metrics_printf(&buf, "# HELP toad_panel_rewind_frames Earlier screens a panel can be rewound to.\n"
+                         "# TYPE toad_panel_rewind_frames gauge\n");
+    for (int i = 0; i < mux.panel_count; i++) {
+        metrics_printf(&buf, "toad_panel_rewind_frames{panel=\"%d\"} %zu\n", i,
+                       mux.panels[i].recording.frame_count);
+    }
+    metrics_printf(&buf, "# HELP toad_reactor_info Event loop backend in use.\n"
+                         "# TYPE toad_reactor_info gauge\n"
+                         "toad_reactor_info{backend=\"%s\"} 1\n", reactor_backend_name(reactor_backend()));
+    metrics_printf(&buf, "# HELP toad_panel_packed_bytes Packed screen and history of a hibernating panel.\n"
+                         "# TYPE toad_panel_packed_bytes gauge\n");
+    for (int i = 0; i < mux.panel_count; i++) {
+        const terminal_panel_t *panel = &mux.panels[i];
+        metrics_printf(&buf, "toad_panel_packed_bytes{panel=\"%d\"} %zu\n", i,
+                       panel->packed_screen_size + panel->scrollback.packed_size);
+    }
+
+    if (buf.data) {
+        reply_payload(client, buf.data, buf.len);
+    } else {
+        reply(client, "error out of memory");
+    }
+    free(buf.data);
+}
+
+static void command_capture(control_client_t *client, char *args) {
+    int index;
+    if (!parse_panel(client, next_word(&args), &index)) {
+        return;
+    }
+
+    vte_capture_format_t format = VTE_CAPTURE_TEXT;
+    int first = VTE_CAPTURE_FIRST, last = VTE_CAPTURE_LAST;
+    char *word = next_word(&args);
+    if (word && !vte_capture_parse_format(word, &format)) {
+        reply(client, "error unknown format %s", word);
+        return;
+    }
+    word = next_word(&args);
+    if (word && !parse_int(word, &first)) {
+        reply(client, "error bad first line");
+        return;
+    }
+    word = next_word(&args);
+    if (word && !parse_int(word, &last)) {
+        reply(client, "error bad last line");
+        return;
+    }
+
+    size_t len;
+    char *text = NULL;
+    catch_up_panel(index);
+    if (wake_panel(&mux.panels[index])) {
+        text = vte_capture_string(&mux.panels[index], first, last, format, &len);
+    }
+    if (!text) {
+        reply(client, "error out of memory");
+        return;
+    }
+    reply_payload(client, text, len);
+    free(text);
+}
+
+static void command_rewind(control_client_t *client, char *args) {
+    char *word = next_word(&args);
+    if (word && strcmp(word, "off") == 0) {
+        end_rewind();
+        reply(client, "ok");
+        return;
+    }
+    int index;
+    if (!parse_panel(client, word, &index)) {
+        return;
+    }
+    int frames = 1;
+    word = next_word(&args);
+    if (word && (!parse_int(word, &frames) || frames < 0)) {
+        reply(client, "error usage: rewind <panel> [frames] | rewind off");
+        return;
+    }
+
+    catch_up_panel(index);
+    const vte_recording_t *recording = &mux.panels[index].recording;
+    if (recording->frame_end < vte_recording_first_frame(recording) + 1 + (uint64_t)frames ||
+        !rewind_panel(index, recording->frame_end - 1 - frames)) {
+        reply(client, "error not recorded that far back");
+        return;
+    }
+    reply(client, "ok frame %llu", (unsigned long long)mux.rewind_frame);
+}
+
+static void execute(control_client_t *client, char *line) {
+    char *args = line;
+    char *command = next_word(&args);
+    int index;
+
+    if (strcmp(command, "new") == 0) {
+        while (isspace((unsigned char)*args)) {
+            args++;
+        }
+        index = create_overlay_panel(*args ? args : NULL);
+        if (index < 0) {
+            reply(client, "error cannot create panel");
+            return;
+        }
+        mark_all_panels_dirty();
+        mark_status_dirty();
+        reply(client, "ok %d", index);
+    } else if (strcmp(command, "split") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        char *direction = next_word(&args);
+        if (!direction || (strcmp(direction, "h") != 0 && strcmp(direction, "v") != 0)) {
+            reply(client, "error usage: split <panel> h|v [command]");
+            return;
+        }
+        while (isspace((unsigned char)*args)) {
+            args++;
+        }
+        index = split_panel(index, direction[0] == 'h' ? LAYOUT_SPLIT_H : LAYOUT_SPLIT_V,
+                            *args ? args : NULL);
+        if (index < 0) {
+            reply(client, "error cannot split panel");
+            return;
+        }
+        mark_status_dirty();
+        reply(client, "ok %d", index);
+    } else if (strcmp(command, "close") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        if (index == 0) {
+            reply(client, "error the main panel cannot be closed");
+            return;
+        }
+        close_panel(index);
+        mark_all_panels_dirty();
+        mark_status_dirty();
+        reply(client, "ok");
+    } else if (strcmp(command, "focus") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        focus_panel(index);
+        reply(client, "ok");
+    } else if (strcmp(command, "zoom") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        toggle_zoom(index);
+        reply(client, "%s", mux.zoomed_panel == index ? "ok zoomed" : "ok");
+    } else if (strcmp(command, "send") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        if (*args == ' ' || *args == '\t') {
+            args++;
+        }
+        size_t len = unescape(args);
+        terminal_panel_t *panel = &mux.panels[index];
+        if (panel->master_fd < 0 || !reactor_write(panel->master_fd, args, len)) {
+            reply(client, "error write failed");
+            return;
+        }
+        reply(client, "ok");
+    } else if (strcmp(command, "capture") == 0) {
+        command_capture(client, args);
+    } else if (strcmp(command, "resize") == 0) {
+        int width, height;
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        if (!parse_int(next_word(&args), &width) || !parse_int(next_word(&args), &height)) {
+            reply(client, "error usage: resize <panel> <width> <height>");
+            return;
+        }
+        if (!resize_panel(index, width, height)) {
+            reply(client, "error cannot resize panel");
+            return;
+        }
+        reply(client, "ok");
+    } else if (strcmp(command, "hibernate") == 0) {
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        if (index == mux.active_panel) {
+            reply(client, "error the focused panel does not hibernate");
+            return;
+        }
+        hibernate_idle_panel(index);
+        reply(client, "ok");
+    } else if (strcmp(command, "rewind") == 0) {
+        command_rewind(client, args);
+    } else if (strcmp(command, "move") == 0) {
+        int x, y;
+        if (!parse_panel(client, next_word(&args), &index)) {
+            return;
+        }
+        if (!parse_int(next_word(&args), &x) || !parse_int(next_word(&args), &y)) {
+            reply(client, "error usage: move <panel> <x> <y>");
+            return;
+        }
+        if (!move_panel(index, x, y)) {
+            reply(client, "error cannot move panel");
+            return;
+        }
+        reply(client, "ok");
+    } else if (strcmp(command, "list") == 0) {
+        char text[MAX_PANELS * 96];
+        size_t len = 0;
+        for (int i = 0; i < mux.panel_count; i++) {
+            const terminal_panel_t *panel = &mux.panels[i];
+            len += snprintf(text + len, sizeof(text) - len, "%d %s %d %d %d %d%s\n", i,
+                            mux.panel_types[i] == PANEL_TYPE_MAIN ? "tiled" : "overlay",
+                            panel->start_x, panel->start_y, panel->width, panel->height,
+                            i == mux.active_panel ? " active" : "");
+        }
+        reply_payload(client, text, len);
+    } else if (strcmp(command, "metrics") == 0) {
+        command_metrics(client);
+    } else {
+        reply(client, "error unknown command %s", command);
+    }
+}
+
+void control_apply(void) {
+    if (queue_len == 0) {
+        return;
+    }
+
+    for (int i = 0; i < queue_len; i++) {
+        control_client_t *client = &clients[queue[i].client];
+        bool connected = client->fd >= 0 && client->serial == queue[i].serial;
+
+        // Commands from a client that went away are still applied
+        control_client_t orphan = { .fd = -1 };
+        execute(connected ? client : &orphan, queue[i].line);
+        free(queue[i].line);
+        mux.stats.control_commands++;
+        if (connected) {
+            client->queued--;
+        }
+    }
+    queue_len = 0;
+    mux.stats.control_batches++;
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            client_flush(&clients[i]);
+        }
+    }
+}
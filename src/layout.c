@@ -0,0 +1,222 @@
+#include <string.h>
+
+#include "toad.h"
+
+// Layout tree: a binary tree of splits whose leaves are the tiled panels.
+// Each split divides its rectangle between two children, side by side or
+// stacked, by a ratio; each leaf's rectangle is where its panel goes.
+//
+// Nodes live in a fixed pool and refer to each other by index, so the tree
+// can be copied and needs no allocation. Every operation recomputes only the
+// subtree it touches and flags the leaves whose rectangle actually changed;
+// the caller then moves, resizes and redraws just those panels.
+
+#define RATIO_SCALE 1000
+
+static int alloc_node(layout_t *layout) {
+    for (int i = 0; i < LAYOUT_MAX_NODES; i++) {
+        if (!layout->nodes[i].in_use) {
+            memset(&layout->nodes[i], 0, sizeof(layout->nodes[i]));
+            layout->nodes[i].in_use = true;
+            layout->nodes[i].parent = -1;
+            layout->nodes[i].child[0] = layout->nodes[i].child[1] = -1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Smallest width (axis LAYOUT_SPLIT_H) or height (LAYOUT_SPLIT_V) the
+// subtree can be given without squeezing a panel below the minimum
+static int min_extent(const layout_t *layout, int index, layout_kind_t axis) {
+    const layout_node_t *node = &layout->nodes[index];
+    if (node->kind == LAYOUT_LEAF) {
+        return axis == LAYOUT_SPLIT_H ? LAYOUT_MIN_WIDTH : LAYOUT_MIN_HEIGHT;
+    }
+    int first = min_extent(layout, node->child[0], axis);
+    int second = min_extent(layout, node->child[1], axis);
+    if (node->kind == axis) {
+        return first + second;
+    }
+    return first > second ? first : second;
+}
+
+// Size of the first child of a split, from its ratio, kept large enough for
+// both children when the split has room for them
+static int first_extent(const layout_t *layout, int index) {
+    const layout_node_t *node = &layout->nodes[index];
+    int extent = node->kind == LAYOUT_SPLIT_H ? node->width : node->height;
+    int size = (extent * node->ratio + RATIO_SCALE / 2) / RATIO_SCALE;
+    int min_first = min_extent(layout, node->child[0], node->kind);
+    int min_second = min_extent(layout, node->child[1], node->kind);
+    if (min_first + min_second <= extent) {
+        if (size < min_first) size = min_first;
+        if (size > extent - min_second) size = extent - min_second;
+    }
+    return size;
+}
+
+// Give a subtree its rectangle and lay out everything below it
+static void assign(layout_t *layout, int index, int x, int y, int width, int height) {
+    layout_node_t *node = &layout->nodes[index];
+    if (node->kind == LAYOUT_LEAF) {
+        if (node->x != x || node->y != y || node->width != width || node->height != height) {
+            node->changed = true;
+        }
+    }
+    node->x = x;
+    node->y = y;
+    node->width = width;
+    node->height = height;
+    if (node->kind == LAYOUT_LEAF) {
+        return;
+    }
+
+    int size = first_extent(layout, index);
+    if (node->kind == LAYOUT_SPLIT_H) {
+        assign(layout, node->child[0], x, y, size, height);
+        assign(layout, node->child[1], x + size, y, width - size, height);
+    } else {
+        assign(layout, node->child[0], x, y, width, size);
+        assign(layout, node->child[1], x, y + size, width, height - size);
+    }
+}
+
+void layout_init(layout_t *layout, int panel_index, int x, int y, int width, int height) {
+    memset(layout, 0, sizeof(*layout));
+    layout->root = alloc_node(layout);
+    layout->nodes[layout->root].kind = LAYOUT_LEAF;
+    layout->nodes[layout->root].panel = panel_index;
+    assign(layout, layout->root, x, y, width, height);
+    layout->nodes[layout->root].changed = true;
+}
+
+void layout_set_area(layout_t *layout, int x, int y, int width, int height) {
+    assign(layout, layout->root, x, y, width, height);
+}
+
+int layout_find(const layout_t *layout, int panel_index) {
+    for (int i = 0; i < LAYOUT_MAX_NODES; i++) {
+        const layout_node_t *node = &layout->nodes[i];
+        if (node->in_use && node->kind == LAYOUT_LEAF && node->panel == panel_index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool layout_split(layout_t *layout, int panel_index, layout_kind_t kind, int new_panel_index) {
+    int index = layout_find(layout, panel_index);
+    if (index < 0 || kind == LAYOUT_LEAF) {
+        return false;
+    }
+    layout_node_t *node = &layout->nodes[index];
+    int extent = kind == LAYOUT_SPLIT_H ? node->width : node->height;
+    int min = kind == LAYOUT_SPLIT_H ? LAYOUT_MIN_WIDTH : LAYOUT_MIN_HEIGHT;
+    if (extent < 2 * min) {
+        return false;
+    }
+
+    int first = alloc_node(layout);
+    if (first < 0) {
+        return false;
+    }
+    int second = alloc_node(layout);
+    if (second < 0) {
+        layout->nodes[first].in_use = false;
+        return false;
+    }
+
+    // The leaf becomes the split, so its parent link stays valid; the
+    // existing panel moves into the first half
+    layout->nodes[first].kind = LAYOUT_LEAF;
+    layout->nodes[first].panel = panel_index;
+    layout->nodes[first].parent = index;
+    layout->nodes[first].x = node->x;
+    layout->nodes[first].y = node->y;
+    layout->nodes[first].width = node->width;
+    layout->nodes[first].height = node->height;
+    layout->nodes[second].kind = LAYOUT_LEAF;
+    layout->nodes[second].panel = new_panel_index;
+    layout->nodes[second].parent = index;
+    layout->nodes[second].changed = true;
+
+    node->kind = kind;
+    node->ratio = RATIO_SCALE / 2;
+    node->child[0] = first;
+    node->child[1] = second;
+    node->changed = false;
+    assign(layout, index, node->x, node->y, node->width, node->height);
+    return true;
+}
+
+bool layout_remove(layout_t *layout, int panel_index) {
+    int index = layout_find(layout, panel_index);
+    if (index < 0 || index == layout->root) {
+        return false;
+    }
+
+    // The sibling takes over the parent split's place and rectangle
+    int parent = layout->nodes[index].parent;
+    layout_node_t *split = &layout->nodes[parent];
+    int sibling = split->child[0] == index ? split->child[1] : split->child[0];
+    int grandparent = split->parent;
+
+    layout->nodes[sibling].parent = grandparent;
+    if (grandparent < 0) {
+        layout->root = sibling;
+    } else {
+        layout_node_t *above = &layout->nodes[grandparent];
+        above->child[above->child[0] == parent ? 0 : 1] = sibling;
+    }
+
+    int x = split->x, y = split->y, width = split->width, height = split->height;
+    layout->nodes[index].in_use = false;
+    split->in_use = false;
+    assign(layout, sibling, x, y, width, height);
+    return true;
+}
+
+bool layout_resize(layout_t *layout, int panel_index, layout_kind_t kind, int delta) {
+    int index = layout_find(layout, panel_index);
+    if (index < 0 || delta == 0) {
+        return false;
+    }
+
+    // The nearest split along that axis decides the panel's size there
+    int child = index;
+    int split = layout->nodes[index].parent;
+    while (split >= 0 && layout->nodes[split].kind != kind) {
+        child = split;
+        split = layout->nodes[split].parent;
+    }
+    if (split < 0) {
+        return false;
+    }
+
+    layout_node_t *node = &layout->nodes[split];
+    int extent = kind == LAYOUT_SPLIT_H ? node->width : node->height;
+    int size = first_extent(layout, split) + (node->child[0] == child ? delta : -delta);
+    int min_first = min_extent(layout, node->child[0], kind);
+    int min_second = min_extent(layout, node->child[1], kind);
+    if (size < min_first) size = min_first;
+    if (size > extent - min_second) size = extent - min_second;
+    if (size <= 0 || size >= extent) {
+        return false;
+    }
+
+    int ratio = (size * RATIO_SCALE + extent / 2) / extent;
+    if (ratio == node->ratio) {
+        return false;
+    }
+    node->ratio = ratio;
+    assign(layout, split, node->x, node->y, node->width, node->height);
+    return true;
+}
+
+void layout_renumber(layout_t *layout, int old_index, int new_index) {
+    int index = layout_find(layout, old_index);
+    if (index >= 0) {
+        layout->nodes[index].panel = new_index;
+    }
+}
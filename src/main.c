@@ -1,3 +1,5 @@
+#define _DEFAULT_SOURCE  // kill(), setsid() and friends under -std=c99 on glibc
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,60 +10,24 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
+#ifdef __APPLE__
 #include <util.h>
+#else
+#include <pty.h>
+#endif
 #include <locale.h>
 #include <time.h>
 
-#include <ncurses.h>
-#include "vte/vte_parser.h"
-
-#define MAX_PANELS 8
-#define BUFFER_SIZE 1024
-#define CTRL_KEY(k) ((k) & 0x1f)
-
-typedef enum {
-    MODE_NORMAL,    // All input goes to terminal
-    MODE_COMMAND    // Waiting for command key
-} input_mode_t;
+#include "toad.h"
+#include "vte/vte_kernels.h"
 
-typedef enum {
-    PANEL_TYPE_MAIN,    // Full-screen main panel
-    PANEL_TYPE_OVERLAY  // Smaller overlay panel
-} panel_type_t;
-
-typedef struct {
-    terminal_panel_t panels[MAX_PANELS];
-    panel_type_t panel_types[MAX_PANELS];
-    int panel_z_order[MAX_PANELS];  // Z-order for rendering (higher index = front)
-    bool panel_dirty[MAX_PANELS];   // Track which panels need redrawing
-    int panel_count;
-    int active_panel;
-    int screen_width, screen_height;
-    int should_quit;
-    
-    // Input mode system
-    input_mode_t mode;
-    int ctrl_count;
-    
-    // Rendering optimization
-    bool force_full_redraw;
-    bool status_line_dirty;
-} multiplexer_t;
-
-static multiplexer_t mux;
+multiplexer_t mux;
 
 // Function declarations
 void cleanup_multiplexer(void);
 void enter_command_mode(void);
 void exit_command_mode(void);
-int create_overlay_panel(void);
-void bring_panel_to_front(int panel_index);
-void close_panel(int panel_index);
-void mark_panel_dirty(int panel_index);
-void mark_all_panels_dirty(void);
-void mark_status_dirty(void);
-void draw_background_pattern(void);
-void draw_colorful_border(WINDOW *win, bool active, panel_type_t type);
+void capture_active_panel(vte_capture_format_t format);
 
 void cleanup_and_exit(int sig) {
     (void)sig;
@@ -82,168 +48,25 @@ void exit_command_mode(void) {
     mark_status_dirty();
 }
 
-void mark_panel_dirty(int panel_index) {
-    if (panel_index >= 0 && panel_index < mux.panel_count) {
-        mux.panel_dirty[panel_index] = true;
-    }
-}
-
-void mark_all_panels_dirty(void) {
-    for (int i = 0; i < mux.panel_count; i++) {
-        mux.panel_dirty[i] = true;
-    }
-    mux.force_full_redraw = true;
-}
-
-void mark_status_dirty(void) {
-    mux.status_line_dirty = true;
-}
-
-void draw_background_pattern(void) {
-    // Draw a decorative pattern background inspired by retro interfaces
-    // Use different characters and colors to create a charming pattern
-    
-    for (int y = 0; y < mux.screen_height - 1; y++) { // Leave space for status line
-        for (int x = 0; x < mux.screen_width; x++) {
-            char pattern_char = ' ';
-            int color_pair = 0;
-            
-            // Create a decorative pattern with dots, stars, and other characters
-            int pattern_x = x % 8;
-            int pattern_y = y % 6;
-            
-            if ((pattern_x == 1 && pattern_y == 1) || (pattern_x == 6 && pattern_y == 4)) {
-                pattern_char = '*';
-                color_pair = 9; // Green stars
-            } else if ((pattern_x == 3 && pattern_y == 2) || (pattern_x == 5 && pattern_y == 5)) {
-                pattern_char = '.';
-                color_pair = 11; // Blue dots
-            } else if ((pattern_x == 0 && pattern_y == 3) || (pattern_x == 7 && pattern_y == 0)) {
-                pattern_char = '+';
-                color_pair = 12; // Magenta plus signs
-            } else if ((pattern_x == 2 && pattern_y == 4) || (pattern_x == 4 && pattern_y == 1)) {
-                pattern_char = 'o';
-                color_pair = 13; // Cyan circles
-            } else {
-                // Background with very subtle pattern
-                if ((x + y) % 4 == 0) {
-                    pattern_char = '.';
-                    color_pair = 15; // Very dim
-                } else {
-                    pattern_char = ' ';
-                    color_pair = 0;
-                }
-            }
-            
-            if (color_pair > 0) {
-                attron(COLOR_PAIR(color_pair));
-            }
-            mvaddch(y, x, pattern_char);
-            if (color_pair > 0) {
-                attroff(COLOR_PAIR(color_pair));
-            }
-        }
-    }
-}
-
-void draw_colorful_border(WINDOW *win, bool active, panel_type_t type) {
-    // Draw colorful borders for panels
-    int border_color = 0;
-    
-    if (active) {
-        // Active panels get bright, colorful borders
-        if (type == PANEL_TYPE_OVERLAY) {
-            border_color = 12; // Bright magenta for active overlays
-        } else {
-            border_color = 10; // Bright yellow for active main panel
-        }
-        wattron(win, COLOR_PAIR(border_color) | A_BOLD);
-    } else {
-        // Inactive panels get softer colors
-        if (type == PANEL_TYPE_OVERLAY) {
-            border_color = 11; // Blue for inactive overlays
-        } else {
-            border_color = 9; // Green for inactive main panel
-        }
-        wattron(win, COLOR_PAIR(border_color));
-    }
-    
-    // Draw the border
-    box(win, 0, 0);
-    
-    // Add corner decorations for active panels
-    if (active) {
-        mvwaddch(win, 0, 0, '+');
-        mvwaddch(win, 0, getmaxx(win) - 1, '+');
-        mvwaddch(win, getmaxy(win) - 1, 0, '+');
-        mvwaddch(win, getmaxy(win) - 1, getmaxx(win) - 1, '+');
-    }
-    
-    if (border_color > 0) {
-        wattroff(win, COLOR_PAIR(border_color));
-        if (active) {
-            wattroff(win, A_BOLD);
-        }
-    }
-}
-
-void init_panel_screen(terminal_panel_t *panel) {
-    panel->screen_width = panel->width - 2; // Account for borders
-    panel->screen_height = panel->height - 2;
-    
-    // Allocate screen buffer
-    panel->screen = malloc(panel->screen_height * sizeof(terminal_cell_t*));
-    if (!panel->screen) {
-        fprintf(stderr, "Failed to allocate screen buffer\n");
-        exit(1);
-    }
-    
-    for (int y = 0; y < panel->screen_height; y++) {
-        panel->screen[y] = malloc(panel->screen_width * sizeof(terminal_cell_t));
-        if (!panel->screen[y]) {
-            fprintf(stderr, "Failed to allocate screen line %d\n", y);
-            exit(1);
-        }
-        
-        // Initialize cells
-        for (int x = 0; x < panel->screen_width; x++) {
-            panel->screen[y][x].codepoint = ' ';
-            panel->screen[y][x].fg_color = -1;
-            panel->screen[y][x].bg_color = -1;
-            panel->screen[y][x].attrs = A_NORMAL;
-        }
-    }
-    
-    panel->cursor_x = 0;
-    panel->cursor_y = 0;
-    
-    // Initialize VTE parser and set up terminal perform implementation
-    vte_parser_init(&panel->parser);
-    panel->perform = terminal_perform;
-    
-    // Initialize with enhanced terminal functions
-    terminal_panel_init(panel, panel->screen_width, panel->screen_height);
-}
-
-void free_panel_screen(terminal_panel_t *panel) {
-    if (panel->screen) {
-        for (int y = 0; y < panel->screen_height; y++) {
-            if (panel->screen[y]) {
-                free(panel->screen[y]);
-            }
-        }
-        free(panel->screen);
-        panel->screen = NULL;
+// Answers to the program's queries go back through its pty, queued behind
+// any input not written yet
+static void reply_to_program(terminal_panel_t *panel, const char *data, size_t len) {
+    if (panel->master_fd >= 0) {
+        reactor_write(panel->master_fd, data, len);
     }
 }
 
-int create_terminal_panel(terminal_panel_t *panel, int x, int y, int width, int height, panel_type_t type) {
+// Create a panel running command under /bin/sh -c, or the shell when NULL
+int create_terminal_panel(terminal_panel_t *panel, int x, int y, int width, int height,
+                          panel_type_t type, const char *command) {
     if (!panel) {
         return -1;
     }
     
     // Initialize panel structure
     memset(panel, 0, sizeof(terminal_panel_t));
+    mux.panel_output_ns[panel - mux.panels] = toad_now_ns();
+    memset(&mux.pty[panel - mux.panels], 0, sizeof(pty_state_t));
     panel->start_x = x;
     panel->start_y = y;
     panel->width = width;
@@ -271,6 +94,14 @@ int create_terminal_panel(terminal_panel_t *panel, int x, int y, int width, int
         return -1;
     }
     
+    // Packet mode: every read starts with a status byte, through which the
+    // line discipline reports flushes and XON/XOFF. It is set before the
+    // child can write so that no read comes without one.
+#ifdef TIOCPKT
+    int packet = 1;
+    mux.pty[panel - mux.panels].packet_mode = ioctl(panel->master_fd, TIOCPKT, &packet) == 0;
+#endif
+    
     // Fork child process
     panel->child_pid = fork();
     if (panel->child_pid == -1) {
@@ -302,15 +133,21 @@ int create_terminal_panel(terminal_panel_t *panel, int x, int y, int width, int
         ws.ws_ypixel = 0;
         ioctl(STDOUT_FILENO, TIOCSWINSZ, &ws);
         
-        // Execute shell
-        execl("/bin/zsh", "zsh", NULL);
+        // Execute the command or the shell
+        if (command) {
+            execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        } else {
+            execl("/bin/zsh", "zsh", (char *)NULL);
+        }
         exit(1);
     }
     
     // Parent process - close slave fd and set non-blocking
     close(slave_fd);
+    panel->reply = reply_to_program;
     int flags = fcntl(panel->master_fd, F_GETFL);
     fcntl(panel->master_fd, F_SETFL, flags | O_NONBLOCK);
+    reactor_add_stream(panel->master_fd, mux.pty[panel - mux.panels].packet_mode);
     
     // Initial draw
     box(panel->win, 0, 0);
@@ -319,168 +156,11 @@ int create_terminal_panel(terminal_panel_t *panel, int x, int y, int width, int
     return 0;
 }
 
-void draw_panel(terminal_panel_t *panel, int panel_index) {
-    if (!panel || !panel->active || !panel->win || !panel->screen) {
-        return;
-    }
-    
-    werase(panel->win);
-    
-    // Draw different styles based on panel type
-    panel_type_t type = mux.panel_types[panel_index];
-    bool is_active = (panel_index == mux.active_panel);
-    
-    // Use the colorful border function
-    draw_colorful_border(panel->win, is_active, type);
-    
-    // Add shadow effect for overlay panels
-    if (type == PANEL_TYPE_OVERLAY) {
-        if (panel->start_x + panel->width < mux.screen_width && 
-            panel->start_y + panel->height < mux.screen_height) {
-            // Draw shadow with color
-            attron(COLOR_PAIR(15)); // Dim color for shadow
-            for (int y = 1; y <= panel->height; y++) {
-                mvaddch(panel->start_y + y, panel->start_x + panel->width, ':');
-            }
-            for (int x = 1; x <= panel->width; x++) {
-                mvaddch(panel->start_y + panel->height, panel->start_x + x, '.');
-            }
-            attroff(COLOR_PAIR(15));
-        }
-    }
-    
-    // Draw colorful title with panel type indicator
-    int title_color = is_active ? (type == PANEL_TYPE_OVERLAY ? 12 : 10) : 
-                                 (type == PANEL_TYPE_OVERLAY ? 11 : 9);
-    
-    wattron(panel->win, COLOR_PAIR(title_color));
-    if (is_active) {
-        wattron(panel->win, A_BOLD);
-        if (type == PANEL_TYPE_OVERLAY) {
-            mvwprintw(panel->win, 0, 2, " ✨ Overlay %d [ACTIVE] ✨ ", panel_index);
-        } else {
-            mvwprintw(panel->win, 0, 2, " 🖥️  Main Terminal [ACTIVE] 🖥️  ");
-        }
-        wattroff(panel->win, A_BOLD);
-    } else {
-        if (type == PANEL_TYPE_OVERLAY) {
-            mvwprintw(panel->win, 0, 2, " ⭐ Overlay %d ⭐ ", panel_index);
-        } else {
-            mvwprintw(panel->win, 0, 2, " 💻 Main Terminal 💻 ");
-        }
-    }
-    wattroff(panel->win, COLOR_PAIR(title_color));
-    
-    // Draw screen content
-    for (int y = 0; y < panel->screen_height; y++) {
-        for (int x = 0; x < panel->screen_width; x++) {
-            terminal_cell_t *cell = &panel->screen[y][x];
-            
-            // Only draw non-space characters or characters with background colors
-            if (cell->codepoint != ' ' || cell->bg_color != -1 || cell->attrs != A_NORMAL) {
-                // Calculate color pair
-                int color_pair = 0;
-                if (cell->fg_color != -1 || cell->bg_color != -1) {
-                    int fg = (cell->fg_color == -1) ? -1 : cell->fg_color;
-                    int bg = (cell->bg_color == -1) ? -1 : cell->bg_color;
-                    
-                    // Find existing color pair or create new one
-                    bool found = false;
-                    for (int i = 1; i < COLOR_PAIRS && i < 64; i++) {
-                        short pair_fg, pair_bg;
-                        pair_content(i, &pair_fg, &pair_bg);
-                        if (pair_fg == fg && pair_bg == bg) {
-                            color_pair = i;
-                            found = true;
-                            break;
-                        }
-                    }
-                    
-                    // If not found, create new pair
-                    if (!found) {
-                        for (int i = 16; i < COLOR_PAIRS && i < 64; i++) { // Start from 16 to avoid conflicts
-                            short pair_fg, pair_bg;
-                            pair_content(i, &pair_fg, &pair_bg);
-                            if (pair_fg == 0 && pair_bg == 0) { // Uninitialized pair
-                                init_pair(i, fg, bg);
-                                color_pair = i;
-                                break;
-                            }
-                        }
-                    }
-                }
-                
-                // Apply attributes and colors
-                if (cell->attrs != A_NORMAL) {
-                    wattron(panel->win, cell->attrs);
-                }
-                if (color_pair > 0) {
-                    wattron(panel->win, COLOR_PAIR(color_pair));
-                }
-                
-                // Handle Unicode codepoints
-                if (cell->codepoint <= 0x7F) {
-                    // ASCII character
-                    mvwaddch(panel->win, y + 1, x + 1, (chtype)cell->codepoint);
-                } else {
-                    // Unicode character - convert to UTF-8 and print
-                    char utf8_buf[5] = {0};
-                    if (cell->codepoint <= 0x7FF) {
-                        utf8_buf[0] = 0xC0 | (cell->codepoint >> 6);
-                        utf8_buf[1] = 0x80 | (cell->codepoint & 0x3F);
-                    } else if (cell->codepoint <= 0xFFFF) {
-                        utf8_buf[0] = 0xE0 | (cell->codepoint >> 12);
-                        utf8_buf[1] = 0x80 | ((cell->codepoint >> 6) & 0x3F);
-                        utf8_buf[2] = 0x80 | (cell->codepoint & 0x3F);
-                    } else if (cell->codepoint <= 0x10FFFF) {
-                        utf8_buf[0] = 0xF0 | (cell->codepoint >> 18);
-                        utf8_buf[1] = 0x80 | ((cell->codepoint >> 12) & 0x3F);
-                        utf8_buf[2] = 0x80 | ((cell->codepoint >> 6) & 0x3F);
-                        utf8_buf[3] = 0x80 | (cell->codepoint & 0x3F);
-                    } else {
-                        // Invalid codepoint, use replacement character
-                        utf8_buf[0] = '?';
-                    }
-                    mvwaddstr(panel->win, y + 1, x + 1, utf8_buf);
-                }
-                
-                // Remove attributes and colors
-                if (color_pair > 0) {
-                    wattroff(panel->win, COLOR_PAIR(color_pair));
-                }
-                if (cell->attrs != A_NORMAL) {
-                    wattroff(panel->win, cell->attrs);
-                }
-            } else {
-                // For spaces with default colors, just put a space
-                mvwaddch(panel->win, y + 1, x + 1, ' ');
-            }
-        }
-    }
-    
-    // Highlight active panel border
-    if (panel_index == mux.active_panel) {
-        wattron(panel->win, A_BOLD);
-        box(panel->win, 0, 0);
-        wattroff(panel->win, A_BOLD);
-    }
-    
-    // Position the real cursor for active panel
-    if (panel_index == mux.active_panel && 
-        panel->cursor_y >= 0 && panel->cursor_y < panel->screen_height &&
-        panel->cursor_x >= 0 && panel->cursor_x < panel->screen_width) {
-        wmove(panel->win, panel->cursor_y + 1, panel->cursor_x + 1);
-    }
-    
-    // Use wnoutrefresh instead of wrefresh to reduce flickering
-    // The actual refresh will happen once at the end of the main loop
-    wnoutrefresh(panel->win);
-}
-
-int create_overlay_panel(void) {
+int create_overlay_panel(const char *command) {
     if (mux.panel_count >= MAX_PANELS) {
         return -1; // No more panels available
     }
+    unzoom_panel();
     
     // Calculate overlay panel size and position (centered, 50% of screen size - smaller than main)
     int overlay_width = (mux.screen_width * 1) / 2;
@@ -495,7 +175,7 @@ int create_overlay_panel(void) {
     int panel_index = mux.panel_count;
     
     if (create_terminal_panel(&mux.panels[panel_index], overlay_x, overlay_y, 
-                             overlay_width, overlay_height, PANEL_TYPE_OVERLAY) == -1) {
+                             overlay_width, overlay_height, PANEL_TYPE_OVERLAY, command) == -1) {
         return -1;
     }
     
@@ -506,6 +186,7 @@ int create_overlay_panel(void) {
     
     // Bring new panel to front and make it active
     bring_panel_to_front(panel_index);
+    mark_panel_chrome_dirty(mux.active_panel);
     mux.active_panel = panel_index;
     
     return panel_index;
@@ -530,10 +211,240 @@ void bring_panel_to_front(int panel_index) {
     mux.panel_z_order[panel_index] = mux.panel_count - 1;
 }
 
+void focus_panel(int panel_index) {
+    if (panel_index < 0 || panel_index >= mux.panel_count || panel_index == mux.active_panel) {
+        return;
+    }
+    if (mux.zoomed_panel >= 0 && mux.zoomed_panel != panel_index) {
+        unzoom_panel();
+    }
+    // Only the two borders change; the contents stay as they are
+    wake_panel(&mux.panels[panel_index]);
+    mark_panel_chrome_dirty(mux.active_panel);
+    mux.active_panel = panel_index;
+    mark_panel_chrome_dirty(mux.active_panel);
+    mark_status_dirty();
+}
+
+// Move and resize a panel's window and screen buffer, and tell the program
+// in it about the new size through the pty. Only the panel itself is marked
+// dirty; callers decide what else the change uncovers.
+static bool place_panel(int panel_index, int x, int y, int width, int height) {
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    mark_panel_dirty(panel_index);
+    catch_up_panel(panel_index); // Written for the old size
+    if (x == panel->start_x && y == panel->start_y &&
+        width == panel->width && height == panel->height) {
+        return true;
+    }
+    
+    if (width != panel->width || height != panel->height) {
+        // The earlier screens were for the old size
+        if (mux.rewound_panel == panel_index) {
+            end_rewind();
+        }
+        if (!resize_panel_screen(panel, width, height)) {
+            return false;
+        }
+    }
+    panel->start_x = x;
+    panel->start_y = y;
+    wresize(panel->win, height, width);
+    mvwin(panel->win, y, x);
+    mark_panel_chrome_dirty(panel_index);
+    
+    if (panel->master_fd >= 0) {
+        struct winsize ws;
+        ws.ws_row = panel->screen_height;
+        ws.ws_col = panel->screen_width;
+        ws.ws_xpixel = 0;
+        ws.ws_ypixel = 0;
+        ioctl(panel->master_fd, TIOCSWINSZ, &ws);
+    }
+    return true;
+}
+
+// Give a panel the whole screen above the status line, or put the zoomed
+// panel back when it is toggled again. The grid is resized through
+// resize_panel_screen() and the program told through TIOCSWINSZ, nothing is
+// re-parsed, and the geometry from before the zoom is restored on unzoom.
+// Either way the change is drawn in a single frame.
+void toggle_zoom(int panel_index) {
+    if (mux.zoomed_panel >= 0) {
+        bool same = mux.zoomed_panel == panel_index;
+        unzoom_panel();
+        if (same) {
+            return;
+        }
+    }
+    if (panel_index < 0 || panel_index >= mux.panel_count) {
+        return;
+    }
+    
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    int x = panel->start_x, y = panel->start_y;
+    int width = panel->width, height = panel->height;
+    if (!place_panel(panel_index, 0, 0, mux.screen_width, mux.screen_height - 1)) {
+        return;
+    }
+    mux.zoom_x = x;
+    mux.zoom_y = y;
+    mux.zoom_width = width;
+    mux.zoom_height = height;
+    mux.zoomed_panel = panel_index;
+    focus_panel(panel_index);
+    mark_status_dirty();
+}
+
+void unzoom_panel(void) {
+    if (mux.zoomed_panel < 0) {
+        return;
+    }
+    int panel_index = mux.zoomed_panel;
+    mux.zoomed_panel = -1;
+    place_panel(panel_index, mux.zoom_x, mux.zoom_y, mux.zoom_width, mux.zoom_height);
+    
+    // Everything the zoomed panel covered comes back
+    mark_all_panels_dirty();
+    mark_status_dirty();
+}
+
+// Move the tiled panels whose layout rectangle changed. Tiles never overlap
+// each other, so only they need redrawing, plus the overlays floating above.
+static void apply_layout(void) {
+    bool any_changed = false;
+    for (int i = 0; i < LAYOUT_MAX_NODES; i++) {
+        layout_node_t *node = &mux.layout.nodes[i];
+        if (node->in_use && node->kind == LAYOUT_LEAF && node->changed) {
+            node->changed = false;
+            place_panel(node->panel, node->x, node->y, node->width, node->height);
+            any_changed = true;
+        }
+    }
+    if (any_changed) {
+        for (int i = 0; i < mux.panel_count; i++) {
+            if (mux.panel_types[i] == PANEL_TYPE_OVERLAY) {
+                mark_panel_dirty(i);
+            }
+        }
+    }
+}
+
+// Split a tiled panel in two, running command (or the shell) in the new
+// half: side by side for LAYOUT_SPLIT_H, stacked for LAYOUT_SPLIT_V
+int split_panel(int panel_index, layout_kind_t kind, const char *command) {
+    unzoom_panel();
+    if (mux.panel_count >= MAX_PANELS || panel_index < 0 || panel_index >= mux.panel_count ||
+        mux.panel_types[panel_index] != PANEL_TYPE_MAIN) {
+        return -1;
+    }
+    
+    int new_index = mux.panel_count;
+    if (!layout_split(&mux.layout, panel_index, kind, new_index)) {
+        return -1; // Too small to split
+    }
+    const layout_node_t *node = &mux.layout.nodes[layout_find(&mux.layout, new_index)];
+    if (create_terminal_panel(&mux.panels[new_index], node->x, node->y, node->width, node->height,
+                              PANEL_TYPE_MAIN, command) == -1) {
+        layout_remove(&mux.layout, new_index);
+        apply_layout();
+        return -1;
+    }
+    
+    // Tiles stay below every overlay
+    for (int i = 0; i < mux.panel_count; i++) {
+        mux.panel_z_order[i]++;
+    }
+    mux.panel_types[new_index] = PANEL_TYPE_MAIN;
+    mux.panel_z_order[new_index] = 0;
+    mux.panel_count++;
+    
+    apply_layout();
+    focus_panel(new_index);
+    return new_index;
+}
+
+// Resize a panel. Overlays are resized in place (moving left/up if they
+// would leave the screen); tiles move the splits next to them, which also
+// resizes the neighbours sharing those splits.
+bool resize_panel(int panel_index, int width, int height) {
+    if (panel_index < 0 || panel_index >= mux.panel_count) {
+        return false;
+    }
+    unzoom_panel();
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    
+    if (mux.panel_types[panel_index] == PANEL_TYPE_MAIN) {
+        bool resized = layout_resize(&mux.layout, panel_index, LAYOUT_SPLIT_H, width - panel->width);
+        resized |= layout_resize(&mux.layout, panel_index, LAYOUT_SPLIT_V, height - panel->height);
+        apply_layout();
+        return resized;
+    }
+    
+    // Leave the status line free and keep room for the border
+    if (width > mux.screen_width) width = mux.screen_width;
+    if (height > mux.screen_height - 1) height = mux.screen_height - 1;
+    if (width < 4 || height < 3) {
+        return false;
+    }
+    
+    int x = panel->start_x, y = panel->start_y;
+    if (x + width > mux.screen_width) x = mux.screen_width - width;
+    if (y + height > mux.screen_height - 1) y = mux.screen_height - 1 - height;
+    
+    int old_x = panel->start_x, old_y = panel->start_y;
+    int old_width = panel->width, old_height = panel->height;
+    if (!place_panel(panel_index, x, y, width, height)) {
+        return false;
+    }
+    
+    // Whatever the panel covered before may now be uncovered; the panels
+    // below are composited again there, not redrawn
+    mark_region_exposed(old_x, old_y, old_width + 1, old_height + 1);
+    return true;
+}
+
+// Move an overlay without redrawing it: its window keeps what was drawn and
+// is composited at the new place, and only the area it leaves is refreshed
+// from the windows below. Tiles are placed by the layout and do not move.
+bool move_panel(int panel_index, int x, int y) {
+    if (panel_index < 0 || panel_index >= mux.panel_count ||
+        mux.panel_types[panel_index] != PANEL_TYPE_OVERLAY) {
+        return false;
+    }
+    unzoom_panel();
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    
+    // Stay on screen, above the status line
+    if (x > mux.screen_width - panel->width) x = mux.screen_width - panel->width;
+    if (y > mux.screen_height - 1 - panel->height) y = mux.screen_height - 1 - panel->height;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x == panel->start_x && y == panel->start_y) {
+        return true;
+    }
+    if (mvwin(panel->win, y, x) == ERR) {
+        return false;
+    }
+    
+    // The shadow is rebuilt with the border at the new place
+    mark_region_exposed(panel->start_x, panel->start_y, panel->width + 1, panel->height + 1);
+    panel->start_x = x;
+    panel->start_y = y;
+    mark_panel_chrome_dirty(panel_index);
+    return true;
+}
+
 void close_panel(int panel_index) {
     if (panel_index < 0 || panel_index >= mux.panel_count || panel_index == 0) {
         return; // Can't close main panel (index 0)
     }
+    unzoom_panel();
+    
+    // The rewound panel goes away or moves to another index
+    if (mux.rewound_panel == panel_index || mux.rewound_panel == mux.panel_count - 1) {
+        end_rewind();
+    }
     
     terminal_panel_t *panel = &mux.panels[panel_index];
     
@@ -545,6 +456,7 @@ void close_panel(int panel_index) {
     
     // Close file descriptor
     if (panel->master_fd >= 0) {
+        reactor_remove_stream(panel->master_fd);
         close(panel->master_fd);
     }
     
@@ -553,10 +465,17 @@ void close_panel(int panel_index) {
         delwin(panel->win);
     }
     free_panel_screen(panel);
+    free_panel_chrome(panel_index);
     
     // Mark as inactive
     panel->active = 0;
     
+    // A closed tile hands its space to its sibling in the layout
+    if (mux.panel_types[panel_index] == PANEL_TYPE_MAIN &&
+        layout_remove(&mux.layout, panel_index)) {
+        apply_layout();
+    }
+    
     // Adjust z-order for remaining panels
     int closed_z = mux.panel_z_order[panel_index];
     for (int i = 0; i < mux.panel_count; i++) {
@@ -570,6 +489,14 @@ void close_panel(int panel_index) {
         mux.panels[panel_index] = mux.panels[mux.panel_count - 1];
         mux.panel_types[panel_index] = mux.panel_types[mux.panel_count - 1];
         mux.panel_z_order[panel_index] = mux.panel_z_order[mux.panel_count - 1];
+        mux.panel_output_ns[panel_index] = mux.panel_output_ns[mux.panel_count - 1];
+        mux.pty[panel_index] = mux.pty[mux.panel_count - 1];
+        layout_renumber(&mux.layout, mux.panel_count - 1, panel_index);
+        
+        // The moved panel's title shows its index
+        mux.panel_chrome[panel_index] = mux.panel_chrome[mux.panel_count - 1];
+        memset(&mux.panel_chrome[mux.panel_count - 1], 0, sizeof(panel_chrome_t));
+        mark_panel_chrome_dirty(panel_index);
         
         // Update z-order references
         for (int i = 0; i < mux.panel_count; i++) {
@@ -585,27 +512,312 @@ void close_panel(int panel_index) {
     // Switch to main panel if we closed the active panel
     if (mux.active_panel == panel_index || mux.active_panel >= mux.panel_count) {
         mux.active_panel = 0; // Switch to main panel
+        mark_panel_chrome_dirty(0);
     }
 }
 
-void read_panel_data(terminal_panel_t *panel) {
-    if (!panel || panel->master_fd < 0) {
+// Parse everything a panel has read and not parsed yet, in place in its
+// input ring, and mark what it changed for the next frame
+static void parse_output(int panel_index) {
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    if (vte_input_pending(&panel->input) == 0) {
         return;
     }
     
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read = read(panel->master_fd, buffer, sizeof(buffer) - 1);
+    // A hibernating panel gets its screen back and is recorded again; the
+    // history is unpacked only once a line scrolls into it
+    if (!wake_panel_screen(panel)) {
+        return;
+    }
+    wake_panel_recording(panel);
     
-    if (bytes_read > 0) {
-        // Feed data to VTE parser
-        vte_parser_feed(panel, buffer, bytes_read);
-        
-        // Mark this panel as dirty since it received new data
-        int panel_index = panel - mux.panels;
+    if (mux.pty[panel_index].held_back) {
+        mux.pty[panel_index].held_back = false;
+        mux.stats.catch_ups++;
+    }
+    
+    // Feed data to VTE parser
+    uint64_t start = toad_now_ns();
+    vte_input_parse(&panel->input, panel);
+    mux.stats.parse_ns += toad_now_ns() - start;
+    
+    // Repaint the panel if cells changed; if the output only moved the
+    // cursor, the renderer just moves the host cursor
+    if (panel->cells_damaged) {
+        panel->cells_damaged = false;
         mark_panel_dirty(panel_index);
-    } else if (bytes_read == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-        // Error reading from pty
-        panel->active = 0;
+    } else {
+        mark_cursor_dirty(panel_index);
+    }
+}
+
+// Whether a panel cannot be seen: behind a zoomed panel, or covered
+// entirely by a panel above it
+static bool panel_hidden(int panel_index) {
+    if (mux.zoomed_panel >= 0) {
+        return panel_index != mux.zoomed_panel;
+    }
+    const terminal_panel_t *panel = &mux.panels[panel_index];
+    for (int i = 0; i < mux.panel_count; i++) {
+        const terminal_panel_t *above = &mux.panels[i];
+        if (mux.panel_z_order[i] > mux.panel_z_order[panel_index] && above->active &&
+            above->start_x <= panel->start_x && above->start_y <= panel->start_y &&
+            above->start_x + above->width >= panel->start_x + panel->width &&
+            above->start_y + above->height >= panel->start_y + panel->height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether output asks the terminal for an answer (DSR, DA), or may end in
+// the middle of such a request, so it cannot wait to be parsed
+static bool output_needs_answer(const char *data, size_t len) {
+    const char *end = data + len;
+    for (const char *p = memchr(data, '\033', len); p; p = memchr(p, '\033', end - p)) {
+        if (++p == end) {
+            return true;
+        }
+        if (*p != '[') {
+            continue;
+        }
+        // Parameters and private markers, then the final byte
+        p++;
+        while (p < end && *p >= 0x30 && *p <= 0x3F) {
+            p++;
+        }
+        if (p == end || *p == 'n' || *p == 'c') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parse everything held back for a panel in one go
+void catch_up_panel(int panel_index) {
+    if (panel_index < 0 || panel_index >= mux.panel_count) {
+        return;
+    }
+    if (vte_input_pending(&mux.panels[panel_index].input) > 0) {
+        parse_output(panel_index);
+    }
+}
+
+// Show a panel as it was after an earlier frame of its output, rebuilt from
+// its recording; its program goes on and the output is parsed as usual
+// meanwhile. Rewind mode lets the keys scrub through the frames until
+// end_rewind(). Returns false if the frame is no longer recorded.
+bool rewind_panel(int panel_index, uint64_t frame) {
+    if (panel_index < 0 || panel_index >= mux.panel_count) {
+        return false;
+    }
+    catch_up_panel(panel_index); // Output held back is recorded as it is parsed
+    uint64_t start = toad_now_ns();
+    if (!vte_recording_seek(&mux.panels[panel_index].recording, frame, &mux.rewind_view)) {
+        return false;
+    }
+    mux.stats.rewind_ns += toad_now_ns() - start;
+    mux.stats.rewind_seeks++;
+    
+    if (mux.rewound_panel >= 0 && mux.rewound_panel != panel_index) {
+        mark_panel_dirty(mux.rewound_panel);
+    }
+    mux.rewound_panel = panel_index;
+    mux.rewind_frame = frame;
+    mux.mode = MODE_REWIND;
+    mark_panel_dirty(panel_index);
+    mark_status_dirty();
+    return true;
+}
+
+// Back to the live screen
+void end_rewind(void) {
+    if (mux.rewound_panel < 0) {
+        return;
+    }
+    mark_panel_dirty(mux.rewound_panel);
+    vte_recording_view_free(&mux.rewind_view);
+    mux.rewound_panel = -1;
+    exit_command_mode();
+}
+
+// Move the rewound panel frames frames later (earlier if negative), stopping
+// at the oldest frame still recorded and at the live screen
+static void step_rewind(int frames) {
+    const vte_recording_t *recording = &mux.panels[mux.rewound_panel].recording;
+    uint64_t first = vte_recording_first_frame(recording);
+    if (recording->frame_end == first) {
+        return;
+    }
+    uint64_t frame = mux.rewind_frame < first ? first : mux.rewind_frame;
+    if (frames < 0) {
+        frame = frame - first > (uint64_t)-frames ? frame - (uint64_t)-frames : first;
+    } else {
+        frame = recording->frame_end - 1 - frame > (uint64_t)frames ? frame + frames
+                                                                    : recording->frame_end - 1;
+    }
+    rewind_panel(mux.rewound_panel, frame);
+}
+
+// Whether the len bytes a panel just read may stay unparsed in its input
+// ring with the output held back before them. A panel that can be seen
+// parses its reads together right before the next frame
+// (catch_up_visible_panels()), so a flush reported in the same wait
+// (handle_pty_status()) still drops them. An unfocused panel nobody can
+// see is parsed in larger batches: once it is shown, once its ring has no
+// room for another read (panel_read_space()), or, like any panel, as soon
+// as the program asks something that needs an answer.
+static bool defer_output(int panel_index, size_t len) {
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    vte_input_t *input = &panel->input;
+    size_t held = vte_input_pending(input) - len;
+    
+    // The read may sit on both sides of the ring's wrap point
+    struct iovec iov[2];
+    int count = vte_input_span(input, input->tail - len, input->tail, iov);
+    bool needs_answer = false;
+    for (int i = 0; i < count && !needs_answer; i++) {
+        needs_answer = output_needs_answer(iov[i].iov_base, iov[i].iov_len);
+    }
+    if (needs_answer) {
+        return false;
+    }
+    if (!mux.lazy_parse || panel_index == mux.active_panel || !panel_hidden(panel_index)) {
+        return true;  // Until the frame
+    }
+    
+    // A request split across reads is only seen whole by the parser
+    if (held == 0 && panel->parser.state != VTE_STATE_GROUND) {
+        return false;
+    }
+    mux.pty[panel_index].held_back = true;
+    mux.stats.pty_bytes_deferred += len;
+    return true;
+}
+
+// Parse what the panels that can be seen read since the last frame, and
+// the held back output of panels shown again or focused
+static void catch_up_visible_panels(void) {
+    for (int i = 0; i < mux.panel_count; i++) {
+        if (vte_input_pending(&mux.panels[i].input) > 0 &&
+            (!mux.lazy_parse || i == mux.active_panel || !panel_hidden(i))) {
+            catch_up_panel(i);
+        }
+    }
+}
+
+#ifdef TIOCPKT
+// Act on a packet mode status byte. When the program's output is flushed
+// (the line discipline does so on Ctrl+C unless NOFLSH is set), what was
+// read of it and not parsed yet goes too: a hidden panel's held back
+// output, or what any other panel read since the last frame. A flood then
+// stops on screen as soon as it stops in the kernel.
+static void handle_pty_status(int panel_index, unsigned char status) {
+    if (status & TIOCPKT_FLUSHWRITE) {
+        vte_input_t *input = &mux.panels[panel_index].input;
+        mux.stats.pty_flushes++;
+        mux.stats.pty_bytes_flushed += vte_input_pending(input);
+        vte_input_discard(input);
+        mux.pty[panel_index].held_back = false;
+    }
+    if (status & (TIOCPKT_STOP | TIOCPKT_START)) {
+        mux.pty[panel_index].stopped = (status & TIOCPKT_STOP) != 0;
+        if (panel_index == mux.active_panel) {
+            mark_status_dirty();
+        }
+    }
+}
+#endif
+
+static int panel_of_fd(int fd) {
+    for (int i = 0; i < mux.panel_count; i++) {
+        if (mux.panels[i].master_fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Reactor callback: where a panel's next read goes, straight into the free
+// space of its input ring, at most BUFFER_SIZE so a flooding pty cannot
+// hold up the frame
+static int panel_read_space(int fd, struct iovec *iov) {
+    int panel_index = panel_of_fd(fd);
+    if (panel_index < 0) {
+        return 0;
+    }
+    vte_input_t *input = &mux.panels[panel_index].input;
+    if (input->size - vte_input_pending(input) < BUFFER_SIZE) {
+        catch_up_panel(panel_index);
+    }
+    return vte_input_space(input, BUFFER_SIZE, iov);
+}
+
+// Reactor callback: a read stored len bytes of output in the panel's input
+// ring, or the pty ended
+static void panel_output(int fd, ssize_t len, uint8_t status) {
+    int panel_index = panel_of_fd(fd);
+    if (panel_index < 0) {
+        return;
+    }
+    if (len <= 0 && status == 0) {
+        // The program exited or its pty failed
+        mux.panels[panel_index].active = 0;
+        return;
+    }
+    
+#ifdef TIOCPKT
+    // A status packet carries no output
+    if (status != TIOCPKT_DATA) {
+        handle_pty_status(panel_index, status);
+        return;
+    }
+#endif
+    if (len == 0) {
+        return;
+    }
+    
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    vte_input_commit(&panel->input, len);
+    mux.stats.pty_reads++;
+    mux.stats.pty_bytes += len;
+    mux.panel_output_ns[panel_index] = toad_now_ns();
+    if (!defer_output(panel_index, len)) {
+        parse_output(panel_index);
+    }
+}
+
+// Hibernate a panel now: its history always, its screen too when nothing
+// draws it (the panel exited or cannot be seen)
+void hibernate_idle_panel(int panel_index) {
+    if (panel_index < 0 || panel_index >= mux.panel_count) {
+        return;
+    }
+    if (panel_index == mux.rewound_panel) {
+        return;  // Its recording is being looked through
+    }
+    terminal_panel_t *panel = &mux.panels[panel_index];
+    if (hibernate_panel(panel, !panel->active || panel_hidden(panel_index))) {
+        mux.stats.hibernations++;
+    }
+}
+
+// Once a second, hibernate the unfocused panels that have had no output for
+// TOAD_IDLE_SECONDS, so memory follows the panels in use rather than all
+// the history ever shown
+static void hibernate_idle_panels(void) {
+    static uint64_t last_check = 0;
+    uint64_t now = toad_now_ns();
+    if (now - last_check < 1000000000u) {
+        return;
+    }
+    last_check = now;
+    
+    for (int i = 0; i < mux.panel_count; i++) {
+        if (i != mux.active_panel &&
+            now - mux.panel_output_ns[i] >= (uint64_t)TOAD_IDLE_SECONDS * 1000000000u) {
+            hibernate_idle_panel(i);
+        }
     }
 }
 
@@ -637,25 +849,21 @@ void handle_input() {
             case 'n':
             case 'N':
                 // Switch to next panel
-                mark_panel_dirty(mux.active_panel); // Mark old panel dirty
-                mux.active_panel = (mux.active_panel + 1) % mux.panel_count;
-                mark_panel_dirty(mux.active_panel); // Mark new panel dirty
+                focus_panel((mux.active_panel + 1) % mux.panel_count);
                 exit_command_mode();
                 break;
                 
             case 'p':
             case 'P':
                 // Switch to previous panel
-                mark_panel_dirty(mux.active_panel); // Mark old panel dirty
-                mux.active_panel = (mux.active_panel - 1 + mux.panel_count) % mux.panel_count;
-                mark_panel_dirty(mux.active_panel); // Mark new panel dirty
+                focus_panel((mux.active_panel - 1 + mux.panel_count) % mux.panel_count);
                 exit_command_mode();
                 break;
                 
             case 'c':
             case 'C':
                 // Create new overlay panel
-                create_overlay_panel();
+                create_overlay_panel(NULL);
                 mark_all_panels_dirty(); // New panel affects rendering
                 exit_command_mode();
                 break;
@@ -670,6 +878,47 @@ void handle_input() {
                 exit_command_mode();
                 break;
                 
+            case '|':
+            case '-':
+                // Split the current tile side by side or stacked
+                split_panel(mux.active_panel, ch == '|' ? LAYOUT_SPLIT_H : LAYOUT_SPLIT_V, NULL);
+                exit_command_mode();
+                break;
+                
+            case '<':
+            case '>':
+                // Narrow or widen the current tile
+                resize_panel(mux.active_panel, active->width + (ch == '>' ? 2 : -2), active->height);
+                exit_command_mode();
+                break;
+                
+            case '{':
+            case '}':
+                // Shorten or lengthen the current tile
+                resize_panel(mux.active_panel, active->width, active->height + (ch == '}' ? 1 : -1));
+                exit_command_mode();
+                break;
+                
+            case KEY_LEFT:
+            case KEY_RIGHT:
+            case KEY_UP:
+            case KEY_DOWN:
+                // Move the current overlay one cell; command mode stays on
+                // so holding an arrow key drags it
+                if (!move_panel(mux.active_panel,
+                                active->start_x + (ch == KEY_RIGHT) - (ch == KEY_LEFT),
+                                active->start_y + (ch == KEY_DOWN) - (ch == KEY_UP))) {
+                    exit_command_mode();
+                }
+                break;
+                
+            case 'z':
+            case 'Z':
+                // Zoom the current panel to the whole screen, or back
+                toggle_zoom(mux.active_panel);
+                exit_command_mode();
+                break;
+                
             case 'f':
             case 'F':
                 // Bring current panel to front
@@ -678,11 +927,47 @@ void handle_input() {
                 exit_command_mode();
                 break;
                 
+            case 's':
+            case 'S':
+                // Capture scrollback and screen as plain text
+                capture_active_panel(VTE_CAPTURE_TEXT);
+                exit_command_mode();
+                break;
+                
+            case 'e':
+            case 'E':
+                // Capture with ANSI escape sequences
+                capture_active_panel(VTE_CAPTURE_ANSI);
+                exit_command_mode();
+                break;
+                
+            case 'h':
+            case 'H':
+                // Capture as HTML
+                capture_active_panel(VTE_CAPTURE_HTML);
+                exit_command_mode();
+                break;
+                
+            case 'r':
+            case 'R':
+                // Rewind the current panel to the screen before its last output
+                {
+                    const vte_recording_t *recording = &active->recording;
+                    exit_command_mode();
+                    catch_up_panel(mux.active_panel);
+                    if (recording->frame_end < vte_recording_first_frame(recording) + 2 ||
+                        !rewind_panel(mux.active_panel, recording->frame_end - 2)) {
+                        snprintf(mux.status_message, sizeof(mux.status_message),
+                                 "nothing recorded to rewind");
+                    }
+                }
+                break;
+                
             case 'a':
             case 'A':
                 // Send literal Ctrl+A to terminal (like screen does)
                 if (active->master_fd >= 0) {
-                    write(active->master_fd, "\001", 1); // Ctrl+A
+                    reactor_write(active->master_fd, "\001", 1); // Ctrl+A
                 }
                 exit_command_mode();
                 break;
@@ -698,11 +983,7 @@ void handle_input() {
                 // Switch to specific panel
                 {
                     int panel_num = (ch == '0') ? 0 : ch - '1' + 1;
-                    if (panel_num >= 0 && panel_num < mux.panel_count) {
-                        mark_panel_dirty(mux.active_panel); // Mark old panel dirty
-                        mux.active_panel = panel_num;
-                        mark_panel_dirty(mux.active_panel); // Mark new panel dirty
-                    }
+                    focus_panel(panel_num);
                     exit_command_mode();
                 }
                 break;
@@ -717,6 +998,33 @@ void handle_input() {
                 exit_command_mode();
                 break;
         }
+    } else if (mux.mode == MODE_REWIND) {
+        // Rewind mode - scrub through the rewound panel's earlier screens
+        switch (ch) {
+            case KEY_LEFT:
+            case '[':
+                step_rewind(-1);
+                break;
+            case KEY_RIGHT:
+            case ']':
+                step_rewind(1);
+                break;
+            case KEY_PPAGE:
+            case '{':
+                step_rewind(-10);
+                break;
+            case KEY_NPAGE:
+            case '}':
+                step_rewind(10);
+                break;
+            case KEY_HOME:
+                step_rewind(-(int)mux.panels[mux.rewound_panel].recording.frame_capacity);
+                break;
+            default:
+                // Anything else goes back to the live screen
+                end_rewind();
+                break;
+        }
     } else {
         // Normal mode - handle Control key detection and pass through to terminal
         // Use Ctrl+A twice as the trigger (like GNU Screen)
@@ -738,33 +1046,53 @@ void handle_input() {
         // Send input to active terminal (skip if it was our trigger key)
         if (active->master_fd >= 0 && ch != CTRL_KEY('a')) {
             if (ch == '\n' || ch == '\r') {
-                write(active->master_fd, "\r", 1);
+                reactor_write(active->master_fd, "\r", 1);
             } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
-                write(active->master_fd, "\b", 1);
+                reactor_write(active->master_fd, "\b", 1);
             } else if (ch == KEY_LEFT) {
-                write(active->master_fd, "\033[D", 3);
+                reactor_write(active->master_fd, "\033[D", 3);
             } else if (ch == KEY_RIGHT) {
-                write(active->master_fd, "\033[C", 3);
+                reactor_write(active->master_fd, "\033[C", 3);
             } else if (ch == KEY_UP) {
-                write(active->master_fd, "\033[A", 3);
+                reactor_write(active->master_fd, "\033[A", 3);
             } else if (ch == KEY_DOWN) {
-                write(active->master_fd, "\033[B", 3);
+                reactor_write(active->master_fd, "\033[B", 3);
             } else if (ch >= 1 && ch <= 26) {
                 // Control characters (including Ctrl+C)
                 char c = ch;
-                write(active->master_fd, &c, 1);
+                reactor_write(active->master_fd, &c, 1);
             } else if (ch == 27) {
                 // ESC key
-                write(active->master_fd, "\033", 1);
+                reactor_write(active->master_fd, "\033", 1);
             } else if (ch >= 32 && ch <= 126) {
                 // Printable characters
                 char c = ch;
-                write(active->master_fd, &c, 1);
+                reactor_write(active->master_fd, &c, 1);
             }
         }
     }
 }
 
+// Capture the active panel's scrollback and screen to
+// $TMPDIR/toad-capture-<pid>-<panel>.<txt|ansi|html>
+void capture_active_panel(vte_capture_format_t format) {
+    static const char *extensions[] = { "txt", "ansi", "html" };
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !*dir) {
+        dir = "/tmp";
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/toad-capture-%d-%d.%s", dir, (int)getpid(),
+             mux.active_panel, extensions[format]);
+    if (capture_panel_to_file(&mux.panels[mux.active_panel], format, path)) {
+        snprintf(mux.status_message, sizeof(mux.status_message), "captured to %s", path);
+    } else {
+        snprintf(mux.status_message, sizeof(mux.status_message), "capture to %s failed", path);
+    }
+    mark_status_dirty();
+}
+
 void init_multiplexer() {
     // Initialize multiplexer structure
     memset(&mux, 0, sizeof(multiplexer_t));
@@ -773,6 +1101,19 @@ void init_multiplexer() {
     mux.ctrl_count = 0;
     mux.force_full_redraw = true;
     mux.status_line_dirty = true;
+    mux.zoomed_panel = -1;
+    mux.rewound_panel = -1;
+    const char *lazy_parse = getenv("TOAD_LAZY_PARSE");
+    mux.lazy_parse = !lazy_parse || strcmp(lazy_parse, "0") != 0;
+    
+    // TOAD_REACTOR=select|epoll|uring picks the event loop; one the kernel
+    // cannot run falls back to the next simpler one
+    reactor_backend_t backend = REACTOR_EPOLL;
+    const char *reactor = getenv("TOAD_REACTOR");
+    if (reactor && !reactor_backend_from_name(reactor, &backend)) {
+        fprintf(stderr, "Unknown TOAD_REACTOR %s, using %s\n", reactor, reactor_backend_name(backend));
+    }
+    reactor_init(backend, panel_read_space, panel_output);
     
     // Initialize locale for UTF-8 support
     setlocale(LC_ALL, "");
@@ -785,31 +1126,7 @@ void init_multiplexer() {
     }
     
     // Enable colors
-    if (has_colors()) {
-        start_color();
-        use_default_colors();
-        
-        // Initialize colorful color pairs
-        init_pair(8, COLOR_RED, -1);
-        init_pair(9, COLOR_GREEN, -1);
-        init_pair(10, COLOR_YELLOW, -1);
-        init_pair(11, COLOR_BLUE, -1);
-        init_pair(12, COLOR_MAGENTA, -1);
-        init_pair(13, COLOR_CYAN, -1);
-        init_pair(14, COLOR_WHITE, -1);
-        init_pair(15, COLOR_BLACK, -1);
-        
-        // Additional color combinations for the background pattern
-        if (COLORS >= 16) {
-            // Try to use bright colors if available
-            init_pair(16, COLOR_RED, COLOR_BLACK);
-            init_pair(17, COLOR_GREEN, COLOR_BLACK);
-            init_pair(18, COLOR_YELLOW, COLOR_BLACK);
-            init_pair(19, COLOR_BLUE, COLOR_BLACK);
-            init_pair(20, COLOR_MAGENTA, COLOR_BLACK);
-            init_pair(21, COLOR_CYAN, COLOR_BLACK);
-        }
-    }
+    init_render_colors();
     
     cbreak();
     noecho();
@@ -824,36 +1141,22 @@ void init_multiplexer() {
         exit(1);
     }
     
-    // Create initial main panel (centered, similar to overlay size)
+    // Create initial main panel
     mux.panel_count = 1;
     mux.active_panel = 0;
     
-    // Calculate main panel size and position (centered, 70% of screen size for better visibility)
-    int panel_width = (mux.screen_width * 7) / 10;
-    int panel_height = (mux.screen_height * 7) / 10;
-    int panel_x = (mux.screen_width - panel_width) / 2;
-    int panel_y = (mux.screen_height - panel_height) / 2;
-    
-    // Ensure minimum size
-    if (panel_width < 30) panel_width = 30;
-    if (panel_height < 15) panel_height = 15;
-    
-    // Ensure it fits on screen
-    if (panel_x < 0) panel_x = 0;
-    if (panel_y < 0) panel_y = 0;
-    if (panel_x + panel_width > mux.screen_width) {
-        panel_width = mux.screen_width - panel_x;
-    }
-    if (panel_y + panel_height > mux.screen_height - 1) { // Leave space for status line
-        panel_height = mux.screen_height - 1 - panel_y;
-    }
+    // The main panel is the root of the layout tree and fills the screen
+    // above the status line; splitting it tiles that area
+    layout_init(&mux.layout, 0, 0, 0, mux.screen_width, mux.screen_height - 1);
+    const layout_node_t *root = &mux.layout.nodes[mux.layout.root];
     
-    if (create_terminal_panel(&mux.panels[0], panel_x, panel_y, 
-                             panel_width, panel_height, PANEL_TYPE_MAIN) == -1) {
+    if (create_terminal_panel(&mux.panels[0], root->x, root->y, 
+                             root->width, root->height, PANEL_TYPE_MAIN, NULL) == -1) {
         endwin();
         fprintf(stderr, "Failed to create main panel\n");
         exit(1);
     }
+    mux.layout.nodes[mux.layout.root].changed = false;
     
     // Set up initial panel type and z-order
     mux.panel_types[0] = PANEL_TYPE_MAIN;
@@ -863,13 +1166,16 @@ void init_multiplexer() {
     mark_panel_dirty(0);
     mux.force_full_redraw = true; // Ensure background is drawn initially
     
-    // Initial draw with background pattern
+    // Start from a blank host screen; the first frame composites the
+    // background pattern
     clear();
-    draw_background_pattern();
     refresh();
 }
 
 void cleanup_multiplexer() {
+    control_shutdown();
+    free_render_cache();
+    
     // Kill child processes first
     for (int i = 0; i < mux.panel_count; i++) {
         terminal_panel_t *panel = &mux.panels[i];
@@ -880,6 +1186,7 @@ void cleanup_multiplexer() {
         }
         
         if (panel->master_fd >= 0) {
+            reactor_remove_stream(panel->master_fd);
             close(panel->master_fd);
         }
         
@@ -889,6 +1196,7 @@ void cleanup_multiplexer() {
         
         free_panel_screen(panel);
     }
+    reactor_shutdown();
     
     // Restore terminal state
     if (stdscr) {
@@ -909,39 +1217,23 @@ int main() {
     signal(SIGINT, cleanup_and_exit);
     signal(SIGTERM, cleanup_and_exit);
     
+    vte_kernels_init();
     init_multiplexer();
     
-    fd_set read_fds;
-    struct timeval timeout;
+    // Scripted control is optional: toad runs without it if the socket
+    // cannot be created
+    control_init();
+    
+    fd_set read_fds, write_fds;
     
     while (!mux.should_quit) {
-        // Prepare file descriptor set
+        // Wait for pty output, which the reactor reads and hands to
+        // panel_output(), the control socket, or the next frame at ~60 FPS
         FD_ZERO(&read_fds);
-        int max_fd = 0;
-        
-        for (int i = 0; i < mux.panel_count; i++) {
-            if (mux.panels[i].active && mux.panels[i].master_fd >= 0) {
-                FD_SET(mux.panels[i].master_fd, &read_fds);
-                if (mux.panels[i].master_fd > max_fd) {
-                    max_fd = mux.panels[i].master_fd;
-                }
-            }
-        }
-        
-        // Set timeout for select - reduced for better responsiveness
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 16667; // ~60 FPS (16.67ms)
-        
-        int ready = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
-        
-        if (ready > 0) {
-            // Read data from terminals
-            for (int i = 0; i < mux.panel_count; i++) {
-                if (mux.panels[i].active && mux.panels[i].master_fd >= 0 &&
-                    FD_ISSET(mux.panels[i].master_fd, &read_fds)) {
-                    read_panel_data(&mux.panels[i]);
-                }
-            }
+        FD_ZERO(&write_fds);
+        int max_fd = control_add_fds(&read_fds, &write_fds, -1);
+        if (reactor_wait(&read_fds, &write_fds, max_fd, 16667) > 0) {
+            control_handle_fds(&read_fds, &write_fds);
         }
         
         // Handle user input
@@ -952,88 +1244,17 @@ int main() {
             break;
         }
         
-        // Optimized rendering - only redraw dirty panels
-        bool any_panel_dirty = mux.force_full_redraw;
-        for (int i = 0; i < mux.panel_count; i++) {
-            if (mux.panel_dirty[i]) {
-                any_panel_dirty = true;
-                break;
-            }
-        }
+        // Apply control commands received since the last frame together, so
+        // a batch shows up in a single redraw
+        control_apply();
         
-        if (any_panel_dirty) {
-            // If force_full_redraw, clear screen and draw background pattern
-            if (mux.force_full_redraw) {
-                clear();
-                draw_background_pattern();
-            }
-            
-            // Create array of panel indices sorted by z-order
-            int sorted_panels[MAX_PANELS];
-            for (int i = 0; i < mux.panel_count; i++) {
-                sorted_panels[i] = i;
-            }
-            
-            // Simple bubble sort by z-order (low to high)
-            for (int i = 0; i < mux.panel_count - 1; i++) {
-                for (int j = 0; j < mux.panel_count - 1 - i; j++) {
-                    if (mux.panel_z_order[sorted_panels[j]] > mux.panel_z_order[sorted_panels[j + 1]]) {
-                        int temp = sorted_panels[j];
-                        sorted_panels[j] = sorted_panels[j + 1];
-                        sorted_panels[j + 1] = temp;
-                    }
-                }
-            }
-            
-            // Draw panels in z-order, but only if dirty or force redraw
-            for (int i = 0; i < mux.panel_count; i++) {
-                int panel_idx = sorted_panels[i];
-                if (mux.panels[panel_idx].active && 
-                    (mux.panel_dirty[panel_idx] || mux.force_full_redraw)) {
-                    draw_panel(&mux.panels[panel_idx], panel_idx);
-                    mux.panel_dirty[panel_idx] = false; // Clear dirty flag
-                }
-            }
-            
-            mux.force_full_redraw = false;
-        }
+        // Panels shown again since the last frame parse what they held back
+        catch_up_visible_panels();
         
-        // Status line - only redraw if dirty
-        bool status_was_dirty = mux.status_line_dirty;
-        if (mux.status_line_dirty) {
-            // Clear the status line first
-            move(mux.screen_height - 1, 0);
-            clrtoeol();
-            
-            if (mux.mode == MODE_COMMAND) {
-                // Colorful command mode status
-                attron(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
-                mvprintw(mux.screen_height - 1, 0, 
-                        " ⚡ COMMAND MODE ⚡ | q:quit | n:next | p:prev | c:create | x:close | f:front | 0-7:panel | ESC:cancel ");
-                attroff(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
-            } else {
-                // Status line with emojis and colors
-                int status_color = (mux.panel_types[mux.active_panel] == PANEL_TYPE_OVERLAY) ? 12 : 9;
-                attron(COLOR_PAIR(status_color));
-                
-                if (mux.panel_types[mux.active_panel] == PANEL_TYPE_OVERLAY) {
-                    mvprintw(mux.screen_height - 1, 0, 
-                            "✨ %s %d ✨ | Ctrl+A Ctrl+A: command mode", 
-                            "Overlay", mux.active_panel);
-                } else {
-                    mvprintw(mux.screen_height - 1, 0, 
-                            "🖥️  %s 🖥️  | Ctrl+A Ctrl+A: command mode", 
-                            "Main Terminal");
-                }
-                attroff(COLOR_PAIR(status_color));
-            }
-            mux.status_line_dirty = false;
-        }
+        // Render dirty panels, status line and refresh in one frame
+        render_frame();
         
-        // Only refresh if something was drawn
-        if (any_panel_dirty || status_was_dirty) {
-            doupdate(); // More efficient than refresh() when using wnoutrefresh()
-        }
+        hibernate_idle_panels();
     }
     
     cleanup_multiplexer();
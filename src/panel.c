@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "toad.h"
+
+void init_panel_screen(terminal_panel_t *panel) {
+    panel->screen_width = panel->width - 2; // Account for borders
+    panel->screen_height = panel->height - 2;
+    
+    // Allocate screen buffer
+    panel->screen = malloc(panel->screen_height * sizeof(terminal_cell_t*));
+    if (!panel->screen) {
+        fprintf(stderr, "Failed to allocate screen buffer\n");
+        exit(1);
+    }
+    
+    for (int y = 0; y < panel->screen_height; y++) {
+        panel->screen[y] = vte_row_new(panel->screen_width);
+        if (!panel->screen[y]) {
+            fprintf(stderr, "Failed to allocate screen line %d\n", y);
+            exit(1);
+        }
+        
+        // Initialize cells
+        for (int x = 0; x < panel->screen_width; x++) {
+            panel->screen[y][x].codepoint = ' ';
+            panel->screen[y][x].fg_color = -1;
+            panel->screen[y][x].bg_color = -1;
+            panel->screen[y][x].attrs = VTE_ATTR_NORMAL;
+        }
+    }
+    
+    panel->cursor_x = 0;
+    panel->cursor_y = 0;
+    
+    // Initialize VTE parser and set up terminal perform implementation
+    vte_parser_init(&panel->parser);
+    panel->perform = terminal_perform;
+    
+    // Initialize with enhanced terminal functions
+    terminal_panel_init(panel, panel->screen_width, panel->screen_height);
+    
+    if (!vte_scrollback_init(&panel->scrollback, TOAD_SCROLLBACK_LINES)) {
+        fprintf(stderr, "Failed to allocate scrollback\n");
+        exit(1);
+    }
+    if (!vte_input_init(&panel->input, TOAD_INPUT_RING_BYTES)) {
+        fprintf(stderr, "Failed to allocate input ring\n");
+        exit(1);
+    }
+    if (!vte_recording_init(&panel->recording, TOAD_REWIND_BYTES, TOAD_REWIND_INTERVAL)) {
+        fprintf(stderr, "Failed to allocate rewind recording\n");
+        exit(1);
+    }
+}
+
+void free_panel_screen(terminal_panel_t *panel) {
+    if (panel->screen) {
+        for (int y = 0; y < panel->screen_height; y++) {
+            vte_row_unref(panel->screen[y]);
+        }
+        free(panel->screen);
+        panel->screen = NULL;
+    }
+    free(panel->packed_screen);
+    panel->packed_screen = NULL;
+    panel->packed_screen_size = 0;
+    vte_scrollback_free(&panel->scrollback);
+    vte_input_free(&panel->input);
+    vte_recording_free(&panel->recording);
+}
+
+// Hand freed heap pages back to the kernel. glibc keeps freed small blocks
+// in the heap; malloc_trim() madvises the whole free pages among them away.
+static void release_free_memory(void) {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+// Pack the history of a panel nobody is looking at, and its screen too if
+// pack_screen is set (the panel is hidden, so nothing draws it). Its rewind
+// recording goes, with the rows its keyframes share. Returns true if
+// anything was packed.
+bool hibernate_panel(terminal_panel_t *panel, bool pack_screen) {
+    bool packed = false;
+    if (!vte_scrollback_is_packed(&panel->scrollback) &&
+        vte_scrollback_count(&panel->scrollback) > 0 && vte_scrollback_pack(&panel->scrollback)) {
+        packed = true;
+    }
+    if (panel->recording.data) {
+        vte_recording_free(&panel->recording);
+        packed = true;
+    }
+    
+    if (pack_screen && panel->screen) {
+        size_t size;
+        uint8_t *data = vte_pack_rows(panel->screen, panel->screen_height, panel->screen_width, &size);
+        if (data) {
+            for (int y = 0; y < panel->screen_height; y++) {
+                vte_row_unref(panel->screen[y]);
+            }
+            free(panel->screen);
+            panel->screen = NULL;
+            panel->packed_screen = data;
+            panel->packed_screen_size = size;
+            packed = true;
+        }
+    }
+    
+    if (packed) {
+        release_free_memory();
+    }
+    return packed;
+}
+
+// Unpack the screen of a hibernating panel so it can be drawn or written
+bool wake_panel_screen(terminal_panel_t *panel) {
+    if (!panel->packed_screen) {
+        return panel->screen != NULL;
+    }
+    
+    terminal_cell_t **screen = calloc(panel->screen_height, sizeof(terminal_cell_t*));
+    if (!screen) {
+        return false;
+    }
+    for (int y = 0; y < panel->screen_height; y++) {
+        screen[y] = vte_row_new(panel->screen_width);
+        if (!screen[y]) {
+            while (--y >= 0) {
+                vte_row_unref(screen[y]);
+            }
+            free(screen);
+            return false;
+        }
+    }
+    vte_unpack_rows(panel->packed_screen, panel->packed_screen_size, screen,
+                    panel->screen_height, panel->screen_width);
+    
+    free(panel->packed_screen);
+    panel->packed_screen = NULL;
+    panel->packed_screen_size = 0;
+    panel->screen = screen;
+    return true;
+}
+
+// Start recording a hibernated panel again, from its next output. Without
+// the memory it goes on unrecorded.
+bool wake_panel_recording(terminal_panel_t *panel) {
+    return panel->recording.data ||
+           vte_recording_init(&panel->recording, TOAD_REWIND_BYTES, TOAD_REWIND_INTERVAL);
+}
+
+// Unpack everything of a hibernating panel: on focus or capture
+bool wake_panel(terminal_panel_t *panel) {
+    return vte_scrollback_unpack(&panel->scrollback) && wake_panel_screen(panel);
+}
+
+bool resize_panel_screen(terminal_panel_t *panel, int width, int height) {
+    int screen_width = width - 2; // Account for borders
+    int screen_height = height - 2;
+    if (screen_width < 1 || screen_height < 1 || !wake_panel(panel)) {
+        return false;
+    }
+    
+    // Rows move between the screen and the history so the cursor row stays
+    // visible: a shorter screen scrolls the top rows into the history, a
+    // taller one pulls them back. Old row y becomes row y - shift.
+    int shift = 0;
+    if (panel->cursor_y >= screen_height) {
+        shift = panel->cursor_y - screen_height + 1;
+    } else if (screen_height > panel->screen_height) {
+        int pull = screen_height - panel->screen_height;
+        int history = (int)vte_scrollback_count(&panel->scrollback);
+        shift = -(history < pull ? history : pull);
+    }
+    
+    terminal_cell_t **screen = malloc(screen_height * sizeof(terminal_cell_t*));
+    if (!screen) {
+        return false;
+    }
+    for (int y = 0; y < screen_height; y++) {
+        screen[y] = vte_row_new(screen_width);
+        if (!screen[y]) {
+            while (--y >= 0) {
+                vte_row_unref(screen[y]);
+            }
+            free(screen);
+            return false;
+        }
+        
+        // Keep what fits of the old row, blank the rest
+        int keep = 0;
+        int old_y = y + shift;
+        if (old_y >= 0 && old_y < panel->screen_height) {
+            keep = screen_width < panel->screen_width ? screen_width : panel->screen_width;
+            memcpy(screen[y], panel->screen[old_y], keep * sizeof(terminal_cell_t));
+        }
+        for (int x = keep; x < screen_width; x++) {
+            screen[y][x].codepoint = ' ';
+            screen[y][x].fg_color = -1;
+            screen[y][x].bg_color = -1;
+            screen[y][x].attrs = VTE_ATTR_NORMAL;
+        }
+    }
+    
+    // Newest history line goes to the row just above the old top row
+    for (int y = -shift - 1; y >= 0; y--) {
+        vte_scrollback_pop(&panel->scrollback, screen[y], screen_width);
+    }
+    for (int y = 0; y < shift; y++) {
+        vte_scrollback_push(&panel->scrollback, panel->screen[y], panel->screen_width);
+    }
+    
+    for (int y = 0; y < panel->screen_height; y++) {
+        vte_row_unref(panel->screen[y]);
+    }
+    free(panel->screen);
+    
+    panel->screen = screen;
+    panel->width = width;
+    panel->height = height;
+    panel->screen_width = screen_width;
+    panel->screen_height = screen_height;
+    panel->scroll_top = 0;
+    panel->scroll_bottom = screen_height - 1;
+    panel->cursor_y -= shift;
+    panel->saved_cursor_y -= shift;
+    if (panel->cursor_x >= screen_width) panel->cursor_x = screen_width - 1;
+    if (panel->cursor_y >= screen_height) panel->cursor_y = screen_height - 1;
+    if (panel->saved_cursor_x >= screen_width) panel->saved_cursor_x = screen_width - 1;
+    if (panel->saved_cursor_y < 0) panel->saved_cursor_y = 0;
+    if (panel->saved_cursor_y >= screen_height) panel->saved_cursor_y = screen_height - 1;
+    
+    // The output recorded so far was laid out for the old size
+    vte_recording_clear(&panel->recording);
+    return true;
+}
+
+bool capture_panel_to_file(terminal_panel_t *panel, vte_capture_format_t format, const char *path) {
+    if (!wake_panel(panel)) {
+        return false;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = vte_capture_fd(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, format, fd);
+    return close(fd) == 0 && ok;
+}
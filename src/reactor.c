@@ -0,0 +1,834 @@
+#define _DEFAULT_SOURCE  // syscall() under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "toad.h"
+
+// Event loop backends: wait for pty output, the control socket or the frame
+// timeout, read the ptys and write queued input to them.
+//
+// Panel ptys are streams: the reactor reads them itself, straight into the
+// space their owner hands out (a panel's input ring), reports every read to
+// the callback given to reactor_init(), and writes their input from a queue
+// per stream. Other descriptors (the control socket) are passed in fd_sets and
+// come back as the ready subset, the way select() returns them.
+//
+//   select  portable; rebuilds the sets every wait, one readv() per ready pty
+//   epoll   interest kept in the kernel, one readv() per ready pty
+//   uring   a poll linked to a readv per pty and the writes, all submitted
+//           together with the wait in one io_uring_enter(), so a busy pty
+//           costs no syscall per read (Linux 6.1 or later, for
+//           IORING_SETUP_DEFER_TASKRUN)
+//
+// A backend the kernel does not support falls back to the next one down.
+
+#define REACTOR_MAX_STREAMS 256
+#define REACTOR_MAX_EVENTS 64
+#define URING_ENTRIES 256
+#define URING_CANCEL_WAIT_NS 10000000  // One wait for a removed stream's read
+#define URING_CANCEL_WAITS 50          // Waits before giving up on it
+
+#define WATCH_READ 1
+#define WATCH_WRITE 2
+#define EPOLL_STREAM_TAG (1ull << 32)
+
+typedef struct {
+    int fd;                 // -1 when removed
+    uint32_t generation;    // Tells completions for a reused slot apart
+    bool ended;             // End of file or error delivered, not read anymore
+    bool packet_mode;       // Reads start with a TIOCPKT status byte
+    uint8_t status;         // Where that byte goes
+    struct iovec iov[3];    // The read's segments, status byte first
+    char *out;              // Input queued for the stream
+    size_t out_len, out_cap;
+    uint32_t events;        // epoll: interest registered for the stream
+    bool reading;           // uring: poll and read armed
+    bool writing;           // uring: write in flight from sending
+    bool polling;           // uring: waiting for room to write
+    bool cancelling;        // uring: cancel of a removed stream in flight
+    int32_t cancelled;      // uring: its result, requests ended or -errno
+    char *sending;          // uring: input owned by the write in flight
+    size_t sending_len, sending_off, sending_cap;
+} reactor_stream_t;
+
+static reactor_backend_t backend = REACTOR_SELECT;
+static reactor_space_fn read_space;
+static reactor_read_fn on_read;
+static reactor_stream_t streams[REACTOR_MAX_STREAMS];
+static int stream_limit = 0;             // Slots in use are below this
+static int stream_of_fd[FD_SETSIZE];     // Slot + 1, or 0
+
+static const char *backend_names[] = { "select", "epoll", "uring" };
+
+#ifdef __linux__
+static int epoll_fd = -1;
+static uint8_t watched[FD_SETSIZE];      // WATCH_* registered with epoll_fd
+static int watched_limit = 0;
+
+enum { OP_READ = 1, OP_POLL_IN, OP_WRITE, OP_POLL_OUT, OP_POLL_WATCHED, OP_CANCEL };
+
+static struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail;                // Next SQE to fill
+    unsigned sq_submitted;                 // Tail the kernel has been given
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *rings;
+    size_t rings_size, sqes_size;
+    bool watch_polled;                     // POLL_ADD on epoll_fd in flight
+    bool watch_ready;
+} ring = { .fd = -1 };
+#endif
+
+static reactor_stream_t *find_stream(int fd) {
+    if (fd < 0 || fd >= FD_SETSIZE || stream_of_fd[fd] == 0) {
+        return NULL;
+    }
+    return &streams[stream_of_fd[fd] - 1];
+}
+
+static bool stream_busy(const reactor_stream_t *stream) {
+    return stream->fd >= 0 || stream->reading || stream->writing || stream->polling;
+}
+
+// Free what a removed stream kept for its operations once none is in flight
+static void release_stream(reactor_stream_t *stream) {
+    if (stream_busy(stream)) {
+        return;
+    }
+    free(stream->out);
+    free(stream->sending);
+    uint32_t generation = stream->generation;
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+    stream->generation = generation;
+}
+
+static bool queue_input(reactor_stream_t *stream, const char *data, size_t len) {
+    if (stream->out_len + len > stream->out_cap) {
+        size_t cap = stream->out_cap ? stream->out_cap : 256;
+        while (cap < stream->out_len + len) {
+            cap *= 2;
+        }
+        char *out = realloc(stream->out, cap);
+        if (!out) {
+            return false;
+        }
+        stream->out = out;
+        stream->out_cap = cap;
+    }
+    memcpy(stream->out + stream->out_len, data, len);
+    stream->out_len += len;
+    return true;
+}
+
+#ifdef __linux__
+// Keep the epoll interest of a stream in line with what it waits for
+static void update_stream_events(reactor_stream_t *stream) {
+    uint32_t events = (stream->ended ? 0 : EPOLLIN) | (stream->out_len > 0 ? EPOLLOUT : 0);
+    if (events == stream->events) {
+        return;
+    }
+    struct epoll_event event = { .events = events };
+    event.data.u64 = EPOLL_STREAM_TAG | (uint64_t)(stream - streams);
+    int op = stream->events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    epoll_ctl(epoll_fd, op, stream->fd, &event);
+    stream->events = events;
+}
+#endif
+
+// The program behind a stream is gone: tell the callback once and stop
+// reading, dropping input it will never take
+static void end_stream(reactor_stream_t *stream, ssize_t result) {
+    stream->ended = true;
+    stream->out_len = 0;
+#ifdef __linux__
+    if (backend == REACTOR_EPOLL) {
+        update_stream_events(stream);
+    }
+#endif
+    on_read(stream->fd, result < 0 ? -1 : 0, 0);
+}
+
+// Segments for the next read of a stream: its status byte, then the owner's
+// space. Returns how many, 0 when the owner has no room.
+static int read_segments(reactor_stream_t *stream) {
+    int first = stream->packet_mode ? 1 : 0;
+    if (stream->packet_mode) {
+        stream->iov[0].iov_base = &stream->status;
+        stream->iov[0].iov_len = 1;
+    }
+    int count = read_space(stream->fd, &stream->iov[first]);
+    return count > 0 ? first + count : 0;
+}
+
+// A read stored n bytes in the segments
+static void deliver_read(reactor_stream_t *stream, ssize_t n) {
+    uint8_t status = 0;
+    if (stream->packet_mode) {
+        status = stream->status;
+        n--;
+    }
+    on_read(stream->fd, n, status);
+}
+
+// select and epoll: write as much queued input as the stream takes now
+static void flush_stream(reactor_stream_t *stream) {
+    size_t done = 0;
+    while (done < stream->out_len) {
+        ssize_t n = write(stream->fd, stream->out + done, stream->out_len - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            done = stream->out_len;  // Nobody reads it anymore
+        }
+    }
+    memmove(stream->out, stream->out + done, stream->out_len - done);
+    stream->out_len -= done;
+#ifdef __linux__
+    if (backend == REACTOR_EPOLL) {
+        update_stream_events(stream);
+    }
+#endif
+}
+
+// select and epoll: one read per ready stream and wait
+static void read_stream(reactor_stream_t *stream) {
+    int count = read_segments(stream);
+    if (count == 0) {
+        return;  // Tried again on the next wait
+    }
+    ssize_t n = readv(stream->fd, stream->iov, count);
+    if (n > 0) {
+        deliver_read(stream, n);
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        end_stream(stream, n);
+    }
+}
+
+static int select_wait(fd_set *read_fds, fd_set *write_fds, int max_fd, int timeout_us) {
+    for (int i = 0; i < stream_limit; i++) {
+        reactor_stream_t *stream = &streams[i];
+        if (stream->fd < 0 || stream->ended) {
+            continue;
+        }
+        FD_SET(stream->fd, read_fds);
+        if (stream->out_len > 0) {
+            FD_SET(stream->fd, write_fds);
+        }
+        if (stream->fd > max_fd) {
+            max_fd = stream->fd;
+        }
+    }
+
+    struct timeval timeout = { timeout_us / 1000000, timeout_us % 1000000 };
+    int ready = select(max_fd + 1, read_fds, write_fds, NULL, &timeout);
+    if (ready <= 0) {
+        FD_ZERO(read_fds);
+        FD_ZERO(write_fds);
+        return ready;
+    }
+
+    // What remains set afterwards is the caller's
+    for (int i = 0; i < stream_limit; i++) {
+        reactor_stream_t *stream = &streams[i];
+        int fd = stream->fd;
+        if (fd < 0 || stream->ended) {
+            continue;
+        }
+        if (FD_ISSET(fd, write_fds)) {
+            FD_CLR(fd, write_fds);
+            ready--;
+            flush_stream(stream);
+        }
+        if (FD_ISSET(fd, read_fds)) {
+            FD_CLR(fd, read_fds);
+            ready--;
+            read_stream(stream);
+        }
+    }
+    return ready;
+}
+
+#ifdef __linux__
+// Register the caller's descriptors with epoll_fd, changing only what
+// changed since the last wait
+static void watch_fds(const fd_set *read_fds, const fd_set *write_fds, int max_fd) {
+    int limit = max_fd + 1 > watched_limit ? max_fd + 1 : watched_limit;
+    watched_limit = 0;
+    for (int fd = 0; fd < limit; fd++) {
+        uint8_t want = 0;
+        if (fd <= max_fd) {
+            want = (FD_ISSET(fd, read_fds) ? WATCH_READ : 0) | (FD_ISSET(fd, write_fds) ? WATCH_WRITE : 0);
+        }
+        if (want != watched[fd]) {
+            struct epoll_event event = {
+                .events = (want & WATCH_READ ? EPOLLIN : 0) | (want & WATCH_WRITE ? EPOLLOUT : 0),
+            };
+            event.data.u64 = (uint64_t)fd;
+            int op = watched[fd] == 0 ? EPOLL_CTL_ADD : want == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+            epoll_ctl(epoll_fd, op, fd, &event);
+            watched[fd] = want;
+        }
+        if (want) {
+            watched_limit = fd + 1;
+        }
+    }
+}
+
+static void report_watched(const struct epoll_event *event, fd_set *read_fds, fd_set *write_fds) {
+    int fd = (int)event->data.u64;
+    if ((event->events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && (watched[fd] & WATCH_READ)) {
+        FD_SET(fd, read_fds);
+    }
+    if ((event->events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && (watched[fd] & WATCH_WRITE)) {
+        FD_SET(fd, write_fds);
+    }
+}
+
+static int count_ready(const fd_set *read_fds, const fd_set *write_fds) {
+    int ready = 0;
+    for (int fd = 0; fd < watched_limit; fd++) {
+        ready += FD_ISSET(fd, read_fds) ? 1 : 0;
+        ready += FD_ISSET(fd, write_fds) ? 1 : 0;
+    }
+    return ready;
+}
+
+static bool epoll_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return epoll_fd >= 0;
+}
+
+static int epoll_wait_streams(fd_set *read_fds, fd_set *write_fds, int max_fd, int timeout_us) {
+    watch_fds(read_fds, write_fds, max_fd);
+    FD_ZERO(read_fds);
+    FD_ZERO(write_fds);
+
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int count = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, (timeout_us + 999) / 1000);
+    for (int i = 0; i < count; i++) {
+        if (!(events[i].data.u64 & EPOLL_STREAM_TAG)) {
+            report_watched(&events[i], read_fds, write_fds);
+            continue;
+        }
+        // A callback may have removed a stream that is still in this batch
+        reactor_stream_t *stream = &streams[(uint32_t)events[i].data.u64];
+        if (stream->fd < 0) {
+            continue;
+        }
+        if ((events[i].events & (EPOLLOUT | EPOLLERR)) && stream->out_len > 0) {
+            flush_stream(stream);
+        }
+        if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !stream->ended) {
+            read_stream(stream);
+        }
+    }
+    return count < 0 ? -1 : count_ready(read_fds, write_fds);
+}
+
+// io_uring without liburing: the rings are mapped by hand and every access
+// to a head or tail the kernel shares goes through an acquire or release
+
+static uint64_t op_data(int op, int slot, uint32_t generation) {
+    return (uint64_t)generation << 32 | (uint64_t)slot << 8 | (uint64_t)op;
+}
+
+static int uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+// Hand the kernel the SQEs filled since the last call
+static void uring_publish(void) {
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+}
+
+// Submit what is queued and run completions, waiting for at least
+// min_complete or the timeout
+static int uring_submit(unsigned min_complete, const struct __kernel_timespec *timeout) {
+    uring_publish();
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t)(uintptr_t)timeout;
+    int n = uring_enter(ring.sq_local_tail - ring.sq_submitted, min_complete,
+                        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (n > 0) {
+        ring.sq_submitted += n;
+    }
+    return n;
+}
+
+// Room for count more SQEs, submitting what is queued if need be, so a
+// linked pair is never split across submissions
+static bool uring_reserve(unsigned count) {
+    unsigned head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    if (ring.sq_local_tail - head + count > ring.sq_entries) {
+        // Full: submit what is there without waiting
+        uring_publish();
+        int n = uring_enter(ring.sq_local_tail - ring.sq_submitted, 0, 0, NULL, 0);
+        if (n > 0) {
+            ring.sq_submitted += n;
+        }
+        head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    }
+    return ring.sq_local_tail - head + count <= ring.sq_entries;
+}
+
+static struct io_uring_sqe *uring_sqe(void) {
+    if (!uring_reserve(1)) {
+        return NULL;
+    }
+    struct io_uring_sqe *sqe = &ring.sqes[ring.sq_local_tail & *ring.sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_local_tail++;
+    return sqe;
+}
+
+// Cancel everything in flight on a descriptor; false if it cannot be queued
+static bool uring_cancel(int fd, uint64_t data) {
+    struct io_uring_sqe *sqe = uring_sqe();
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = data;
+    }
+    return sqe != NULL;
+}
+
+static void uring_poll(int fd, uint32_t events, uint64_t data) {
+    struct io_uring_sqe *sqe = uring_sqe();
+    if (sqe) {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = events;
+        sqe->user_data = data;
+    }
+}
+
+static bool uring_supports(int op) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (!probe) {
+        return false;
+    }
+    bool supported = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                     op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+static void uring_shutdown(void) {
+    if (ring.fd >= 0) {
+        close(ring.fd);
+    }
+    if (ring.rings) {
+        munmap(ring.rings, ring.rings_size);
+    }
+    if (ring.sqes) {
+        munmap(ring.sqes, ring.sqes_size);
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+static bool uring_init(void) {
+    // Completions are only run from our own waits, which also keeps their
+    // cost out of unrelated syscalls
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    ring.fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        ring.fd = -1;
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) ||
+        !uring_supports(IORING_OP_READV)) {
+        uring_shutdown();
+        return false;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.rings_size = sq_size > cq_size ? sq_size : cq_size;
+    ring.rings = mmap(NULL, ring.rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring.fd, IORING_OFF_SQ_RING);
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQES);
+    if (ring.rings == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        ring.rings = ring.rings == MAP_FAILED ? NULL : ring.rings;
+        ring.sqes = ring.sqes == MAP_FAILED ? NULL : ring.sqes;
+        uring_shutdown();
+        return false;
+    }
+    char *base = ring.rings;
+    ring.sq_head = (unsigned *)(base + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(base + params.sq_off.ring_mask);
+    ring.cq_head = (unsigned *)(base + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(base + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+    ring.sq_entries = params.sq_entries;
+    unsigned *sq_array = (unsigned *)(base + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        sq_array[i] = i;
+    }
+    ring.sq_local_tail = ring.sq_submitted = *ring.sq_tail;
+
+    // Descriptors passed in fd_sets are watched through an epoll instance
+    // polled by the ring
+    if (!epoll_init()) {
+        uring_shutdown();
+        return false;
+    }
+    return true;
+}
+
+// Arm reads for new streams and start writes for queued input
+static void uring_arm(void) {
+    for (int i = 0; i < stream_limit; i++) {
+        reactor_stream_t *stream = &streams[i];
+        if (stream->fd < 0) {
+            continue;
+        }
+        // The pty is non-blocking, so a read alone would fail at once with
+        // nothing to read; a poll linked ahead of it holds it back until
+        // there is. The poll keeps its completion: skipping it also loses
+        // the read's when a cancel fails the link.
+        int count;
+        if (!stream->ended && !stream->reading && uring_reserve(2) && (count = read_segments(stream)) > 0) {
+            struct io_uring_sqe *poll = uring_sqe();
+            poll->opcode = IORING_OP_POLL_ADD;
+            poll->fd = stream->fd;
+            poll->poll32_events = POLLIN;
+            poll->flags = IOSQE_IO_LINK;
+            poll->user_data = op_data(OP_POLL_IN, i, stream->generation);
+            struct io_uring_sqe *sqe = uring_sqe();
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = stream->fd;
+            sqe->off = (uint64_t)-1;
+            sqe->addr = (uint64_t)(uintptr_t)stream->iov;
+            sqe->len = (uint32_t)count;
+            sqe->user_data = op_data(OP_READ, i, stream->generation);
+            stream->reading = true;
+        }
+        if (stream->writing || stream->polling) {
+            continue;
+        }
+        if (stream->sending_off == stream->sending_len && stream->out_len > 0) {
+            // The queue becomes the write's; later input queues behind it
+            char *buffer = stream->sending;
+            size_t cap = stream->sending_cap;
+            stream->sending = stream->out;
+            stream->sending_cap = stream->out_cap;
+            stream->sending_len = stream->out_len;
+            stream->sending_off = 0;
+            stream->out = buffer;
+            stream->out_cap = cap;
+            stream->out_len = 0;
+        }
+        if (stream->sending_off < stream->sending_len) {
+            struct io_uring_sqe *sqe = uring_sqe();
+            if (!sqe) {
+                return;
+            }
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = stream->fd;
+            sqe->off = (uint64_t)-1;
+            sqe->addr = (uint64_t)(uintptr_t)(stream->sending + stream->sending_off);
+            sqe->len = (uint32_t)(stream->sending_len - stream->sending_off);
+            sqe->user_data = op_data(OP_WRITE, i, stream->generation);
+            stream->writing = true;
+        }
+    }
+    if (watched_limit > 0 && !ring.watch_polled) {
+        uring_poll(epoll_fd, POLLIN, op_data(OP_POLL_WATCHED, 0, 0));
+        ring.watch_polled = true;
+    }
+}
+
+static void uring_complete(uint64_t data, int32_t res) {
+    int op = (int)(data & 0xff);
+    int slot = (int)((data >> 8) & 0xffffff);
+    reactor_stream_t *stream = &streams[slot];
+    bool live = stream->fd >= 0 && stream->generation == (uint32_t)(data >> 32);
+
+    switch (op) {
+    case OP_READ:
+        stream->reading = false;  // Armed again on the next wait unless ended
+        if (res > 0 && live) {
+            deliver_read(stream, res);
+        } else if (live && res != -EAGAIN && res != -EINTR && res != -ECANCELED) {
+            end_stream(stream, res);
+        }
+        break;
+    case OP_POLL_IN:
+        return;  // The linked read reports what happened
+    case OP_WRITE:
+        stream->writing = false;
+        if (res > 0) {
+            stream->sending_off += res;
+        } else if (res == -EAGAIN && live) {
+            uring_poll(stream->fd, POLLOUT, op_data(OP_POLL_OUT, slot, stream->generation));
+            stream->polling = true;
+        } else if (res != -EINTR) {
+            stream->sending_off = stream->sending_len;  // Nobody reads it anymore
+        }
+        break;
+    case OP_POLL_OUT:
+        stream->polling = false;
+        break;
+    case OP_POLL_WATCHED:
+        ring.watch_polled = false;
+        ring.watch_ready = true;
+        return;
+    case OP_CANCEL:
+        if (stream->generation == (uint32_t)(data >> 32)) {
+            stream->cancelling = false;
+            stream->cancelled = res;
+        }
+        return;
+    default:
+        return;
+    }
+    if (stream->fd < 0) {
+        release_stream(stream);
+    }
+}
+
+// Run the completions the kernel has posted
+static void uring_reap(void) {
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        uint64_t data = cqe->user_data;
+        int32_t res = cqe->res;
+        head++;
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        uring_complete(data, res);
+        if (head == tail) {
+            tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+}
+
+static int uring_wait(fd_set *read_fds, fd_set *write_fds, int max_fd, int timeout_us) {
+    watch_fds(read_fds, write_fds, max_fd);
+    FD_ZERO(read_fds);
+    FD_ZERO(write_fds);
+
+    // Submit and wait in one call; when completions are already waiting,
+    // only submit and run the deferred work
+    uring_arm();
+    struct __kernel_timespec ts = { timeout_us / 1000000, (long long)(timeout_us % 1000000) * 1000 };
+    bool waiting = *ring.cq_head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    uring_submit(waiting ? 0 : 1, &ts);
+
+    ring.watch_ready = false;
+    uring_reap();
+    if (!ring.watch_ready) {
+        return 0;
+    }
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int count = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, 0);
+    for (int i = 0; i < count; i++) {
+        report_watched(&events[i], read_fds, write_fds);
+    }
+    return count_ready(read_fds, write_fds);
+}
+#endif
+
+bool reactor_init(reactor_backend_t requested, reactor_space_fn space, reactor_read_fn callback) {
+    read_space = space;
+    on_read = callback;
+    for (int i = 0; i < REACTOR_MAX_STREAMS; i++) {
+        streams[i].fd = -1;
+    }
+#ifdef __linux__
+    if (requested == REACTOR_URING && uring_init()) {
+        backend = REACTOR_URING;
+        return true;
+    }
+    if (requested != REACTOR_SELECT && epoll_init()) {
+        backend = REACTOR_EPOLL;
+        return true;
+    }
+#else
+    (void)requested;
+#endif
+    backend = REACTOR_SELECT;
+    return true;
+}
+
+void reactor_shutdown(void) {
+#ifdef __linux__
+    if (backend == REACTOR_URING) {
+        uring_shutdown();
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    memset(watched, 0, sizeof(watched));
+    watched_limit = 0;
+#endif
+    for (int i = 0; i < stream_limit; i++) {
+        free(streams[i].out);
+        free(streams[i].sending);
+    }
+    memset(streams, 0, sizeof(streams));
+    memset(stream_of_fd, 0, sizeof(stream_of_fd));
+    stream_limit = 0;
+    backend = REACTOR_SELECT;
+}
+
+reactor_backend_t reactor_backend(void) {
+    return backend;
+}
+
+const char *reactor_backend_name(reactor_backend_t which) {
+    return backend_names[which];
+}
+
+bool reactor_backend_from_name(const char *name, reactor_backend_t *which) {
+    for (int i = 0; i < (int)(sizeof(backend_names) / sizeof(backend_names[0])); i++) {
+        if (strcmp(name, backend_names[i]) == 0) {
+            *which = (reactor_backend_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool reactor_add_stream(int fd, bool packet_mode) {
+    if (fd < 0 || fd >= FD_SETSIZE || stream_of_fd[fd] != 0) {
+        return false;
+    }
+    int slot = 0;
+    while (slot < REACTOR_MAX_STREAMS && stream_busy(&streams[slot])) {
+        slot++;
+    }
+    if (slot == REACTOR_MAX_STREAMS) {
+        return false;
+    }
+    reactor_stream_t *stream = &streams[slot];
+    stream->fd = fd;
+    stream->packet_mode = packet_mode;
+    stream_of_fd[fd] = slot + 1;
+    if (slot >= stream_limit) {
+        stream_limit = slot + 1;
+    }
+#ifdef __linux__
+    // A descriptor number reused from a watched one that was not forgotten
+    watched[fd] = 0;
+    if (backend == REACTOR_EPOLL) {
+        update_stream_events(stream);
+    }
+#endif
+    return true;
+}
+
+void reactor_remove_stream(int fd) {
+    reactor_stream_t *stream = find_stream(fd);
+    if (!stream) {
+        return;
+    }
+    stream_of_fd[fd] = 0;
+#ifdef __linux__
+    if (backend == REACTOR_EPOLL && stream->events != 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        stream->events = 0;
+    }
+    if (backend == REACTOR_URING && stream_busy(stream)) {
+        // Completions still to come find the slot removed and only clean up.
+        // A read armed into the owner's space must be over before the owner
+        // frees it, so wait for that one. A cancel that found nothing means
+        // the read has already finished, only its completion may be left to
+        // run. The wait is bounded, so a read that never ends cannot hang
+        // every other panel.
+        stream->generation++;
+        stream->cancelling = uring_cancel(fd, op_data(OP_CANCEL, (int)(stream - streams), stream->generation));
+        stream->fd = -1;
+        struct __kernel_timespec ts = { 0, URING_CANCEL_WAIT_NS };
+        for (int waits = 0; stream->reading && waits < URING_CANCEL_WAITS; waits++) {
+            if (!stream->cancelling && stream->cancelled == -ENOENT) {
+                break;
+            }
+            uring_submit(1, &ts);
+            uring_reap();
+        }
+        release_stream(stream);
+        return;
+    }
+#endif
+    stream->fd = -1;
+    stream->generation++;
+    stream->out_len = 0;
+    release_stream(stream);
+}
+
+void reactor_forget_fd(int fd) {
+#ifdef __linux__
+    if (fd >= 0 && fd < FD_SETSIZE && watched[fd] != 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        watched[fd] = 0;
+    }
+#else
+    (void)fd;
+#endif
+}
+
+bool reactor_write(int fd, const char *data, size_t len) {
+    reactor_stream_t *stream = find_stream(fd);
+    if (!stream || stream->ended) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+    bool idle = stream->out_len == 0;
+    if (!queue_input(stream, data, len)) {
+        return false;
+    }
+    // uring submits the queue with the next wait
+    if (backend != REACTOR_URING && idle) {
+        flush_stream(stream);
+    }
+    return true;
+}
+
+int reactor_wait(fd_set *read_fds, fd_set *write_fds, int max_fd, int timeout_us) {
+#ifdef __linux__
+    if (backend == REACTOR_URING) {
+        return uring_wait(read_fds, write_fds, max_fd, timeout_us);
+    }
+    if (backend == REACTOR_EPOLL) {
+        return epoll_wait_streams(read_fds, write_fds, max_fd, timeout_us);
+    }
+#endif
+    return select_wait(read_fds, write_fds, max_fd, timeout_us);
+}
@@ -0,0 +1,730 @@
+#define _DEFAULT_SOURCE  // clock_gettime() under -std=c99
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "toad.h"
+#include "vte/vte_kernels.h"
+
+uint64_t toad_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void init_render_colors(void) {
+    if (!has_colors()) {
+        return;
+    }
+    
+    start_color();
+    use_default_colors();
+    
+    // Initialize colorful color pairs
+    init_pair(8, COLOR_RED, -1);
+    init_pair(9, COLOR_GREEN, -1);
+    init_pair(10, COLOR_YELLOW, -1);
+    init_pair(11, COLOR_BLUE, -1);
+    init_pair(12, COLOR_MAGENTA, -1);
+    init_pair(13, COLOR_CYAN, -1);
+    init_pair(14, COLOR_WHITE, -1);
+    init_pair(15, COLOR_BLACK, -1);
+    
+    // Additional color combinations for the background pattern
+    if (COLORS >= 16) {
+        // Try to use bright colors if available
+        init_pair(16, COLOR_RED, COLOR_BLACK);
+        init_pair(17, COLOR_GREEN, COLOR_BLACK);
+        init_pair(18, COLOR_YELLOW, COLOR_BLACK);
+        init_pair(19, COLOR_BLUE, COLOR_BLACK);
+        init_pair(20, COLOR_MAGENTA, COLOR_BLACK);
+        init_pair(21, COLOR_CYAN, COLOR_BLACK);
+    }
+}
+
+void mark_panel_dirty(int panel_index) {
+    if (panel_index >= 0 && panel_index < mux.panel_count) {
+        mux.panel_dirty[panel_index] = true;
+    }
+}
+
+void mark_all_panels_dirty(void) {
+    for (int i = 0; i < mux.panel_count; i++) {
+        mux.panel_dirty[i] = true;
+    }
+    mux.force_full_redraw = true;
+}
+
+void mark_status_dirty(void) {
+    mux.status_line_dirty = true;
+}
+
+// Note host cells that something stopped covering. The next frame copies
+// the background and the panels below back over them from their windows;
+// several regions in one frame are merged into their bounding box.
+void mark_region_exposed(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    if (mux.exposed_x0 >= mux.exposed_x1) {
+        mux.exposed_x0 = x;
+        mux.exposed_y0 = y;
+        mux.exposed_x1 = x + width;
+        mux.exposed_y1 = y + height;
+        return;
+    }
+    if (x < mux.exposed_x0) mux.exposed_x0 = x;
+    if (y < mux.exposed_y0) mux.exposed_y0 = y;
+    if (x + width > mux.exposed_x1) mux.exposed_x1 = x + width;
+    if (y + height > mux.exposed_y1) mux.exposed_y1 = y + height;
+}
+
+// The background pattern is rendered once per host size into its own window
+// and composited from there, instead of a mvaddch() per host cell on every
+// forced redraw
+static WINDOW *background_cache = NULL;
+static int background_width = 0, background_height = 0;
+
+static void render_background_pattern(WINDOW *win, int width, int height) {
+    // Draw a decorative pattern background inspired by retro interfaces
+    // Use different characters and colors to create a charming pattern
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            char pattern_char = ' ';
+            int color_pair = 0;
+            
+            // Create a decorative pattern with dots, stars, and other characters
+            int pattern_x = x % 8;
+            int pattern_y = y % 6;
+            
+            if ((pattern_x == 1 && pattern_y == 1) || (pattern_x == 6 && pattern_y == 4)) {
+                pattern_char = '*';
+                color_pair = 9; // Green stars
+            } else if ((pattern_x == 3 && pattern_y == 2) || (pattern_x == 5 && pattern_y == 5)) {
+                pattern_char = '.';
+                color_pair = 11; // Blue dots
+            } else if ((pattern_x == 0 && pattern_y == 3) || (pattern_x == 7 && pattern_y == 0)) {
+                pattern_char = '+';
+                color_pair = 12; // Magenta plus signs
+            } else if ((pattern_x == 2 && pattern_y == 4) || (pattern_x == 4 && pattern_y == 1)) {
+                pattern_char = 'o';
+                color_pair = 13; // Cyan circles
+            } else {
+                // Background with very subtle pattern
+                if ((x + y) % 4 == 0) {
+                    pattern_char = '.';
+                    color_pair = 15; // Very dim
+                } else {
+                    pattern_char = ' ';
+                    color_pair = 0;
+                }
+            }
+            
+            if (color_pair > 0) {
+                wattron(win, COLOR_PAIR(color_pair));
+            }
+            mvwaddch(win, y, x, pattern_char);
+            if (color_pair > 0) {
+                wattroff(win, COLOR_PAIR(color_pair));
+            }
+        }
+    }
+}
+
+// Render the background cache for the current host size if needed
+static bool update_background_cache(void) {
+    int width = mux.screen_width;
+    int height = mux.screen_height - 1; // Leave space for status line
+    
+    if (!background_cache || background_width != width || background_height != height) {
+        if (background_cache) {
+            delwin(background_cache);
+        }
+        background_cache = newwin(height, width, 0, 0);
+        if (!background_cache) {
+            return false;
+        }
+        background_width = width;
+        background_height = height;
+        render_background_pattern(background_cache, width, height);
+    }
+    return true;
+}
+
+void draw_background_pattern(void) {
+    if (!update_background_cache()) {
+        return;
+    }
+    touchwin(background_cache);
+    wnoutrefresh(background_cache);
+}
+
+void free_render_cache(void) {
+    if (background_cache) {
+        delwin(background_cache);
+        background_cache = NULL;
+    }
+    for (int i = 0; i < MAX_PANELS; i++) {
+        free_panel_chrome(i);
+    }
+}
+
+void draw_colorful_border(WINDOW *win, bool active, panel_type_t type) {
+    // Draw colorful borders for panels
+    int border_color = 0;
+    
+    if (active) {
+        // Active panels get bright, colorful borders
+        if (type == PANEL_TYPE_OVERLAY) {
+            border_color = 12; // Bright magenta for active overlays
+        } else {
+            border_color = 10; // Bright yellow for active main panel
+        }
+        wattron(win, COLOR_PAIR(border_color) | A_BOLD);
+    } else {
+        // Inactive panels get softer colors
+        if (type == PANEL_TYPE_OVERLAY) {
+            border_color = 11; // Blue for inactive overlays
+        } else {
+            border_color = 9; // Green for inactive main panel
+        }
+        wattron(win, COLOR_PAIR(border_color));
+    }
+    
+    // Draw the border
+    box(win, 0, 0);
+    
+    // Add corner decorations for active panels
+    if (active) {
+        mvwaddch(win, 0, 0, '+');
+        mvwaddch(win, 0, getmaxx(win) - 1, '+');
+        mvwaddch(win, getmaxy(win) - 1, 0, '+');
+        mvwaddch(win, getmaxy(win) - 1, getmaxx(win) - 1, '+');
+    }
+    
+    if (border_color > 0) {
+        wattroff(win, COLOR_PAIR(border_color));
+        if (active) {
+            wattroff(win, A_BOLD);
+        }
+    }
+}
+
+// Translate VTE_ATTR_* cell attributes to ncurses attributes
+static attr_t cell_attrs_to_ncurses(int attrs) {
+    attr_t result = A_NORMAL;
+    if (attrs & VTE_ATTR_BOLD) result |= A_BOLD;
+    if (attrs & VTE_ATTR_UNDERLINE) result |= A_UNDERLINE;
+    if (attrs & VTE_ATTR_REVERSE) result |= A_REVERSE;
+    if (attrs & VTE_ATTR_DIM) result |= A_DIM;
+    if (attrs & VTE_ATTR_BLINK) result |= A_BLINK;
+    if (attrs & VTE_ATTR_HIDDEN) result |= A_INVIS;
+#ifdef A_ITALIC
+    if (attrs & VTE_ATTR_ITALIC) result |= A_ITALIC;
+#endif
+    return result;
+}
+
+void mark_panel_chrome_dirty(int panel_index) {
+    if (panel_index >= 0 && panel_index < MAX_PANELS) {
+        mux.panel_chrome[panel_index].valid = false;
+    }
+}
+
+void free_panel_chrome(int panel_index) {
+    panel_chrome_t *chrome = &mux.panel_chrome[panel_index];
+    if (chrome->shadow_right) {
+        delwin(chrome->shadow_right);
+    }
+    if (chrome->shadow_bottom) {
+        delwin(chrome->shadow_bottom);
+    }
+    vte_grid_free(&chrome->drawn);
+    memset(chrome, 0, sizeof(*chrome));
+}
+
+// Shadow strip of an overlay: a window of one repeated character
+static WINDOW *new_shadow(int height, int width, int y, int x, chtype ch) {
+    WINDOW *win = newwin(height, width, y, x);
+    if (!win) {
+        return NULL;
+    }
+    wattron(win, COLOR_PAIR(15)); // Dim color for shadow
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            mvwaddch(win, row, col, ch);
+        }
+    }
+    wattroff(win, COLOR_PAIR(15));
+    return win;
+}
+
+// Border, title and overlay shadow. They are drawn once into the panel
+// window and the shadow windows, and redrawn only after a resize, move,
+// focus change or new panel index invalidates them; the interior is
+// rewritten by draw_panel() and never touches them. The border is drawn
+// over in full, so the interior is left alone here, but the copy of the
+// drawn rows goes with the rest and the next draw_panel() rewrites every
+// row.
+static void draw_panel_chrome(terminal_panel_t *panel, int panel_index) {
+    // Draw different styles based on panel type
+    panel_type_t type = mux.panel_types[panel_index];
+    bool is_active = (panel_index == mux.active_panel);
+    
+    // Use the colorful border function
+    draw_colorful_border(panel->win, is_active, type);
+    
+    // Add shadow effect for overlay panels
+    free_panel_chrome(panel_index);
+    panel_chrome_t *chrome = &mux.panel_chrome[panel_index];
+    if (type == PANEL_TYPE_OVERLAY) {
+        if (panel->start_x + panel->width < mux.screen_width && 
+            panel->start_y + panel->height < mux.screen_height) {
+            chrome->shadow_right = new_shadow(panel->height, 1, panel->start_y + 1,
+                                              panel->start_x + panel->width, ':');
+            chrome->shadow_bottom = new_shadow(1, panel->width, panel->start_y + panel->height,
+                                               panel->start_x + 1, '.');
+        }
+    }
+    
+    // Draw colorful title with panel type indicator
+    int title_color = is_active ? (type == PANEL_TYPE_OVERLAY ? 12 : 10) : 
+                                 (type == PANEL_TYPE_OVERLAY ? 11 : 9);
+    
+    wattron(panel->win, COLOR_PAIR(title_color));
+    if (is_active) {
+        wattron(panel->win, A_BOLD);
+        if (type == PANEL_TYPE_OVERLAY) {
+            mvwprintw(panel->win, 0, 2, " ✨ Overlay %d [ACTIVE] ✨ ", panel_index);
+        } else {
+            mvwprintw(panel->win, 0, 2, " 🖥️  Main Terminal [ACTIVE] 🖥️  ");
+        }
+        wattroff(panel->win, A_BOLD);
+    } else {
+        if (type == PANEL_TYPE_OVERLAY) {
+            mvwprintw(panel->win, 0, 2, " ⭐ Overlay %d ⭐ ", panel_index);
+        } else {
+            mvwprintw(panel->win, 0, 2, " 💻 Main Terminal 💻 ");
+        }
+    }
+    wattroff(panel->win, COLOR_PAIR(title_color));
+    
+    // Highlight active panel border
+    if (is_active) {
+        wattron(panel->win, A_BOLD);
+        box(panel->win, 0, 0);
+        wattroff(panel->win, A_BOLD);
+    }
+    
+    chrome->valid = true;
+}
+
+// Copy a panel's window and shadow into the virtual screen as they are
+static void composite_panel(int panel_index) {
+    WINDOW *win = mux.panels[panel_index].win;
+    panel_chrome_t *chrome = &mux.panel_chrome[panel_index];
+    touchwin(win);
+    wnoutrefresh(win);
+    if (chrome->shadow_right) {
+        touchwin(chrome->shadow_right);
+        wnoutrefresh(chrome->shadow_right);
+    }
+    if (chrome->shadow_bottom) {
+        touchwin(chrome->shadow_bottom);
+        wnoutrefresh(chrome->shadow_bottom);
+    }
+}
+
+// Blank runs at least this long are drawn with one mvwhline()
+#define BLANK_RUN_MIN 8
+
+// The panel whose cells and cursor are drawn for panel_index
+static const terminal_panel_t *shown_panel(int panel_index) {
+    return panel_index == mux.rewound_panel ? &mux.rewind_view : &mux.panels[panel_index];
+}
+
+void draw_panel(terminal_panel_t *panel, int panel_index) {
+    if (!panel || !panel->active || !panel->win || !panel->screen) {
+        return;
+    }
+    
+    panel_chrome_t *chrome = &mux.panel_chrome[panel_index];
+    if (!chrome->valid) {
+        draw_panel_chrome(panel, panel_index);
+    }
+    
+    // Cells and cursor come from the earlier screen of a rewound panel
+    const terminal_panel_t *shown = shown_panel(panel_index);
+    
+    // Rows equal to the copy of what was last drawn are still in the window
+    // as they are; a screen that is repainted without changing (top, watch,
+    // a progress bar rewriting its text) costs a compare per row. Of a row
+    // that changed, only the columns from the first to the last difference
+    // are drawn again, so typing on a prompt line redraws a cell or two.
+    // The copy is an adaptive grid, so plain text rows take a byte a cell.
+    vte_grid_t *drawn = &chrome->drawn;
+    bool drawn_known = drawn->rows == shown->screen_height && drawn->columns == shown->screen_width;
+    if (!drawn_known) {
+        vte_grid_free(drawn);
+        vte_grid_init(drawn, VTE_GRID_ADAPTIVE, shown->screen_width, shown->screen_height);
+    }
+    
+    // Draw screen content
+    for (int y = 0; y < shown->screen_height; y++) {
+        terminal_cell_t *row = shown->screen[y];
+        int x0 = 0, x1 = shown->screen_width;
+        if (drawn_known && !vte_grid_row_diff(drawn, y, row, &x0, &x1)) {
+            mux.stats.rows_unchanged++;
+            continue;
+        }
+        if (drawn->rows > 0) {
+            vte_grid_store_row(drawn, y, row);
+        }
+        int scanned = x0;
+        for (int x = x0; x < x1; x++) {
+            // A long run of blank cells goes out as one line of spaces;
+            // shorter ones (gaps between words) are cheaper cell by cell, so
+            // the kernel only runs where both ends of such a run are spaces
+            if (x >= scanned && x + BLANK_RUN_MIN <= x1 &&
+                row[x].codepoint == ' ' && row[x + BLANK_RUN_MIN - 1].codepoint == ' ') {
+                int blanks = (int)vte_kernel->find_nonblank_cells(&row[x], x1 - x);
+                if (blanks >= BLANK_RUN_MIN) {
+                    mvwaddch(panel->win, y + 1, x + 1, ' ');
+                    mvwhline(panel->win, y + 1, x + 2, ' ', blanks - 1);
+                    x += blanks - 1;
+                    continue;
+                }
+                scanned = x + blanks + 1;
+            }
+            terminal_cell_t *cell = &row[x];
+            
+            // Only draw non-space characters or characters with background colors
+            if (cell->codepoint != ' ' || cell->bg_color != -1 || cell->attrs != VTE_ATTR_NORMAL) {
+                attr_t attrs = cell_attrs_to_ncurses(cell->attrs);
+                // Calculate color pair
+                int color_pair = 0;
+                if (cell->fg_color != -1 || cell->bg_color != -1) {
+                    int fg = (cell->fg_color == -1) ? -1 : cell->fg_color;
+                    int bg = (cell->bg_color == -1) ? -1 : cell->bg_color;
+                    
+                    // Find existing color pair or create new one
+                    bool found = false;
+                    for (int i = 1; i < COLOR_PAIRS && i < 64; i++) {
+                        short pair_fg, pair_bg;
+                        pair_content(i, &pair_fg, &pair_bg);
+                        if (pair_fg == fg && pair_bg == bg) {
+                            color_pair = i;
+                            found = true;
+                            break;
+                        }
+                    }
+                    
+                    // If not found, create new pair
+                    if (!found) {
+                        for (int i = 16; i < COLOR_PAIRS && i < 64; i++) { // Start from 16 to avoid conflicts
+                            short pair_fg, pair_bg;
+                            pair_content(i, &pair_fg, &pair_bg);
+                            if (pair_fg == 0 && pair_bg == 0) { // Uninitialized pair
+                                init_pair(i, fg, bg);
+                                color_pair = i;
+                                break;
+                            }
+                        }
+                    }
+                }
+                
+                // Apply attributes and colors
+                if (attrs != A_NORMAL) {
+                    wattron(panel->win, attrs);
+                }
+                if (color_pair > 0) {
+                    wattron(panel->win, COLOR_PAIR(color_pair));
+                }
+                
+                // Handle Unicode codepoints
+                if (cell->codepoint <= 0x7F) {
+                    // ASCII character
+                    mvwaddch(panel->win, y + 1, x + 1, (chtype)cell->codepoint);
+                } else {
+                    // Unicode character - convert to UTF-8 and print
+                    char utf8_buf[5] = {0};
+                    if (cell->codepoint <= 0x7FF) {
+                        utf8_buf[0] = 0xC0 | (cell->codepoint >> 6);
+                        utf8_buf[1] = 0x80 | (cell->codepoint & 0x3F);
+                    } else if (cell->codepoint <= 0xFFFF) {
+                        utf8_buf[0] = 0xE0 | (cell->codepoint >> 12);
+                        utf8_buf[1] = 0x80 | ((cell->codepoint >> 6) & 0x3F);
+                        utf8_buf[2] = 0x80 | (cell->codepoint & 0x3F);
+                    } else if (cell->codepoint <= 0x10FFFF) {
+                        utf8_buf[0] = 0xF0 | (cell->codepoint >> 18);
+                        utf8_buf[1] = 0x80 | ((cell->codepoint >> 12) & 0x3F);
+                        utf8_buf[2] = 0x80 | ((cell->codepoint >> 6) & 0x3F);
+                        utf8_buf[3] = 0x80 | (cell->codepoint & 0x3F);
+                    } else {
+                        // Invalid codepoint, use replacement character
+                        utf8_buf[0] = '?';
+                    }
+                    mvwaddstr(panel->win, y + 1, x + 1, utf8_buf);
+                }
+                
+                // Remove attributes and colors
+                if (color_pair > 0) {
+                    wattroff(panel->win, COLOR_PAIR(color_pair));
+                }
+                if (attrs != A_NORMAL) {
+                    wattroff(panel->win, attrs);
+                }
+            } else {
+                // For spaces with default colors, just put a space
+                mvwaddch(panel->win, y + 1, x + 1, ' ');
+            }
+        }
+    }
+    
+    // Position the real cursor for active panel
+    if (panel_index == mux.active_panel && 
+        shown->cursor_y >= 0 && shown->cursor_y < shown->screen_height &&
+        shown->cursor_x >= 0 && shown->cursor_x < shown->screen_width) {
+        wmove(panel->win, shown->cursor_y + 1, shown->cursor_x + 1);
+    }
+    
+    // Use wnoutrefresh instead of wrefresh to reduce flickering
+    // The actual refresh will happen once at the end of the main loop
+    composite_panel(panel_index);
+}
+
+void draw_status_line(void) {
+    // Clear the status line first
+    move(mux.screen_height - 1, 0);
+    clrtoeol();
+    
+    if (mux.mode == MODE_COMMAND) {
+        // Colorful command mode status
+        attron(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
+        mvprintw(mux.screen_height - 1, 0, 
+                " ⚡ COMMAND MODE ⚡ | q:quit | n:next | p:prev | c:create | |/-:split | <>{}:size | arrows:move | z:zoom | x:close | f:front | s/e/h:capture | r:rewind | 0-7:panel | ESC:cancel ");
+        attroff(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
+    } else if (mux.mode == MODE_REWIND) {
+        const vte_recording_t *recording = &mux.panels[mux.rewound_panel].recording;
+        uint64_t first = vte_recording_first_frame(recording);
+        attron(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
+        mvprintw(mux.screen_height - 1, 0,
+                " ⏪ REWIND %d ⏪ | frame %llu of %llu-%llu | ←→ []:step | PgUp PgDn {}:10 | Home:oldest | other keys:live ",
+                mux.rewound_panel, (unsigned long long)mux.rewind_frame,
+                (unsigned long long)first, (unsigned long long)recording->frame_end - 1);
+        attroff(COLOR_PAIR(10) | A_REVERSE | A_BOLD);
+    } else {
+        // Status line with emojis and colors
+        int status_color = (mux.panel_types[mux.active_panel] == PANEL_TYPE_OVERLAY) ? 12 : 9;
+        attron(COLOR_PAIR(status_color));
+        
+        if (mux.panel_types[mux.active_panel] == PANEL_TYPE_OVERLAY) {
+            mvprintw(mux.screen_height - 1, 0, 
+                    "✨ %s %d ✨ | Ctrl+A Ctrl+A: command mode", 
+                    "Overlay", mux.active_panel);
+        } else {
+            if (mux.active_panel == 0) {
+                mvprintw(mux.screen_height - 1, 0, 
+                        "🖥️  %s 🖥️  | Ctrl+A Ctrl+A: command mode", 
+                        "Main Terminal");
+            } else {
+                mvprintw(mux.screen_height - 1, 0, 
+                        "🖥️  %s %d 🖥️  | Ctrl+A Ctrl+A: command mode", 
+                        "Tile", mux.active_panel);
+            }
+        }
+        if (mux.pty[mux.active_panel].stopped) {
+            printw(" | output stopped, Ctrl+Q resumes");
+        }
+        if (mux.status_message[0]) {
+            printw(" | %s", mux.status_message);
+        }
+        attroff(COLOR_PAIR(status_color));
+    }
+    mux.status_line_dirty = false;
+}
+
+typedef struct {
+    int x0, y0, x1, y1;  // Half-open host cell rectangle
+} render_rect_t;
+
+// Host cells a panel can cover, shadow included
+static render_rect_t panel_rect(const terminal_panel_t *panel) {
+    render_rect_t rect = { panel->start_x, panel->start_y,
+                           panel->start_x + panel->width + 1, panel->start_y + panel->height + 1 };
+    return rect;
+}
+
+static bool rects_overlap(render_rect_t a, render_rect_t b) {
+    return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+// Copy part of the background cache into the virtual screen, through a
+// subwindow so the rest of the screen is left alone
+static void composite_background(render_rect_t rect) {
+    if (!update_background_cache()) {
+        return;
+    }
+    if (rect.x0 < 0) rect.x0 = 0;
+    if (rect.y0 < 0) rect.y0 = 0;
+    if (rect.x1 > background_width) rect.x1 = background_width;
+    if (rect.y1 > background_height) rect.y1 = background_height;
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) {
+        return;
+    }
+    WINDOW *part = derwin(background_cache, rect.y1 - rect.y0, rect.x1 - rect.x0, rect.y0, rect.x0);
+    if (!part) {
+        draw_background_pattern();
+        return;
+    }
+    touchwin(part);
+    wnoutrefresh(part);
+    delwin(part);
+}
+
+// Panels that can be drawn: a zoomed panel covers all the others, which
+// stay dirty until the zoom ends
+static bool panel_visible(int panel_index) {
+    const terminal_panel_t *panel = &mux.panels[panel_index];
+    if (!panel->active || !panel->win) {
+        return false;
+    }
+    return mux.zoomed_panel < 0 || panel_index == mux.zoomed_panel;
+}
+
+// Leave the host cursor at the active panel's cursor
+static void place_cursor(void) {
+    terminal_panel_t *panel = &mux.panels[mux.active_panel];
+    if (!panel->active || !panel->win) {
+        return;
+    }
+    const terminal_panel_t *shown = shown_panel(mux.active_panel);
+    if (shown->cursor_y >= 0 && shown->cursor_y < shown->screen_height &&
+        shown->cursor_x >= 0 && shown->cursor_x < shown->screen_width) {
+        wmove(panel->win, shown->cursor_y + 1, shown->cursor_x + 1);
+    }
+    wnoutrefresh(panel->win);
+}
+
+void mark_cursor_dirty(int panel_index) {
+    // Only the active panel shows a cursor
+    if (panel_index == mux.active_panel) {
+        mux.cursor_dirty = true;
+    }
+}
+
+// Render one frame: dirty panels in z-order, the status line, then a single
+// doupdate(). Panels whose only change is their border (focus changes) get
+// just the border redrawn, panels above anything redrawn or uncovered are
+// composited again from their windows, and a frame where only the cursor
+// moved is just a wmove(). Returns true if anything was sent to the terminal.
+bool render_frame(void) {
+    uint64_t start = toad_now_ns();
+    
+    // Optimized rendering - only redraw dirty panels
+    render_rect_t exposed = { mux.exposed_x0, mux.exposed_y0, mux.exposed_x1, mux.exposed_y1 };
+    bool any_exposed = exposed.x0 < exposed.x1;
+    mux.exposed_x0 = mux.exposed_x1 = 0;
+    bool any_panel_dirty = mux.force_full_redraw || any_exposed;
+    for (int i = 0; i < mux.panel_count; i++) {
+        if (panel_visible(i) && (mux.panel_dirty[i] || !mux.panel_chrome[i].valid)) {
+            any_panel_dirty = true;
+            break;
+        }
+    }
+    
+    if (any_panel_dirty) {
+        // If force_full_redraw, composite the cached background pattern;
+        // the panels and status line cover everything else
+        if (mux.force_full_redraw) {
+            draw_background_pattern();
+            mux.status_line_dirty = true;
+        }
+        
+        // An uncovered area gets the background back first, and every panel
+        // over it is composited again below
+        render_rect_t refreshed[MAX_PANELS + 1];
+        int refreshed_count = 0;
+        if (any_exposed && !mux.force_full_redraw) {
+            composite_background(exposed);
+            refreshed[refreshed_count++] = exposed;
+        }
+        
+        // Create array of panel indices sorted by z-order
+        int sorted_panels[MAX_PANELS];
+        for (int i = 0; i < mux.panel_count; i++) {
+            sorted_panels[i] = i;
+        }
+        
+        // Simple bubble sort by z-order (low to high)
+        for (int i = 0; i < mux.panel_count - 1; i++) {
+            for (int j = 0; j < mux.panel_count - 1 - i; j++) {
+                if (mux.panel_z_order[sorted_panels[j]] > mux.panel_z_order[sorted_panels[j + 1]]) {
+                    int temp = sorted_panels[j];
+                    sorted_panels[j] = sorted_panels[j + 1];
+                    sorted_panels[j + 1] = temp;
+                }
+            }
+        }
+        
+        // Draw panels in z-order, but only if dirty or force redraw
+        for (int i = 0; i < mux.panel_count; i++) {
+            int panel_idx = sorted_panels[i];
+            terminal_panel_t *panel = &mux.panels[panel_idx];
+            if (!panel_visible(panel_idx)) {
+                continue;
+            }
+            
+            render_rect_t rect = panel_rect(panel);
+            if (!wake_panel_screen(panel)) {
+                continue; // Hibernating and out of memory to unpack
+            }
+            if (mux.panel_dirty[panel_idx] || mux.force_full_redraw) {
+                draw_panel(panel, panel_idx);
+                mux.panel_dirty[panel_idx] = false; // Clear dirty flag
+                mux.stats.panels_drawn++;
+            } else if (!mux.panel_chrome[panel_idx].valid) {
+                draw_panel_chrome(panel, panel_idx);
+                composite_panel(panel_idx);
+            } else {
+                // Unchanged, but something below it was just refreshed over it
+                bool covered = false;
+                for (int j = 0; j < refreshed_count && !covered; j++) {
+                    covered = rects_overlap(rect, refreshed[j]);
+                }
+                if (!covered) {
+                    continue;
+                }
+                composite_panel(panel_idx);
+            }
+            refreshed[refreshed_count++] = rect;
+        }
+        
+        mux.force_full_redraw = false;
+    }
+    
+    // Status line - only redraw if dirty
+    bool status_was_dirty = mux.status_line_dirty;
+    if (mux.status_line_dirty) {
+        draw_status_line();
+        wnoutrefresh(stdscr); // Only the status line is drawn on stdscr
+    }
+    
+    // Only refresh if something was drawn or the cursor moved
+    bool cursor_only = !any_panel_dirty && !status_was_dirty && mux.cursor_dirty;
+    mux.cursor_dirty = false;
+    if (any_panel_dirty || status_was_dirty || cursor_only) {
+        place_cursor();
+        doupdate(); // More efficient than refresh() when using wnoutrefresh()
+        if (cursor_only) {
+            mux.stats.cursor_frames++;
+        } else {
+            mux.stats.frames++;
+        }
+        mux.stats.render_ns += toad_now_ns() - start;
+    }
+    
+    return any_panel_dirty || status_was_dirty || cursor_only;
+}
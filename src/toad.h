@@ -0,0 +1,244 @@
+#ifndef TOAD_H
+#define TOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/types.h>
+#include <ncurses.h>
+#include "vte/vte_parser.h"
+#include "vte/vte_capture.h"
+#include "vte/vte_grid.h"
+
+#define MAX_PANELS 8
+#define BUFFER_SIZE 1024
+#define TOAD_SCROLLBACK_LINES 10000
+#define TOAD_IDLE_SECONDS 300  // Quiet time before a panel hibernates
+#define TOAD_INPUT_RING_BYTES (64 * 1024)  // Unparsed output a panel can hold back
+#define TOAD_REWIND_BYTES (1024 * 1024)    // Output a panel keeps for rewinding
+#define TOAD_REWIND_INTERVAL (64 * 1024)   // Output between rewind keyframes
+#define CTRL_KEY(k) ((k) & 0x1f)
+
+typedef enum {
+    MODE_NORMAL,    // All input goes to terminal
+    MODE_COMMAND,   // Waiting for command key
+    MODE_REWIND     // Keys scrub through a panel's earlier screens
+} input_mode_t;
+
+typedef enum {
+    PANEL_TYPE_MAIN,    // Tiled panel, placed by the layout tree
+    PANEL_TYPE_OVERLAY  // Smaller overlay panel
+} panel_type_t;
+
+// Layout tree of tiled panels (layout.c)
+#define LAYOUT_MAX_NODES (2 * MAX_PANELS - 1)
+#define LAYOUT_MIN_WIDTH 10
+#define LAYOUT_MIN_HEIGHT 4
+
+typedef enum {
+    LAYOUT_LEAF,     // A tiled panel
+    LAYOUT_SPLIT_H,  // Two children side by side
+    LAYOUT_SPLIT_V   // Two children stacked
+} layout_kind_t;
+
+typedef struct {
+    bool in_use;
+    layout_kind_t kind;
+    int parent;               // -1 for the root
+    int child[2];             // Splits: left or top, right or bottom
+    int ratio;                // Splits: share of the first child, in 1/1000
+    int panel;                // Leaves: panel index
+    int x, y, width, height;
+    bool changed;             // Leaves: rectangle changed since last applied
+} layout_node_t;
+
+typedef struct {
+    layout_node_t nodes[LAYOUT_MAX_NODES];
+    int root;
+} layout_t;
+
+// Cached decorations of a panel, and what its window holds (render.c)
+typedef struct {
+    bool valid;              // Border and title in the panel window are current
+    WINDOW *shadow_right;    // Overlay drop shadow, composited after the panel
+    WINDOW *shadow_bottom;
+    vte_grid_t drawn;        // The screen rows as drawn into the window, an
+                             // adaptive grid; 0 rows until all have been
+} panel_chrome_t;
+
+// What the line discipline reports about a panel's pty in packet mode (main.c)
+typedef struct {
+    bool packet_mode;  // Reads start with a TIOCPKT status byte
+    bool stopped;      // The program's output is stopped (XOFF, Ctrl+S)
+    bool held_back;    // Output waits in the ring while the panel is hidden
+} pty_state_t;
+
+// Performance counters, served by the control socket "metrics" command
+typedef struct {
+    uint64_t pty_reads;          // pty reads that returned data
+    uint64_t pty_bytes;          // Bytes read from panel ptys
+    uint64_t parse_ns;           // Time spent parsing pty output
+    uint64_t pty_bytes_deferred; // Bytes of hidden panels held back unparsed
+    uint64_t catch_ups;          // Held back output parsed in one go
+    uint64_t pty_flushes;        // Output flushes reported by the line discipline
+    uint64_t pty_bytes_flushed;  // Unparsed bytes dropped by those flushes
+    uint64_t frames;             // render_frame() calls that drew something
+    uint64_t cursor_frames;      // Frames that only moved the cursor
+    uint64_t panels_drawn;       // draw_panel() calls
+    uint64_t rows_unchanged;     // Rows draw_panel() skipped, same as last drawn
+    uint64_t render_ns;          // Time spent in render_frame() when drawing
+    uint64_t control_commands;   // Control socket commands applied
+    uint64_t control_batches;    // Batches of commands applied between frames
+    uint64_t hibernations;       // Idle panels packed by hibernate_panel()
+    uint64_t rewind_seeks;       // Earlier screens rebuilt by rewind_panel()
+    uint64_t rewind_ns;          // Time spent rebuilding them
+} toad_stats_t;
+
+typedef struct {
+    terminal_panel_t panels[MAX_PANELS];
+    panel_type_t panel_types[MAX_PANELS];
+    int panel_z_order[MAX_PANELS];  // Z-order for rendering (higher index = front)
+    bool panel_dirty[MAX_PANELS];   // Track which panels need redrawing
+    panel_chrome_t panel_chrome[MAX_PANELS];
+    uint64_t panel_output_ns[MAX_PANELS];  // When each panel last had output
+    pty_state_t pty[MAX_PANELS];
+    bool lazy_parse;                // Hold back hidden panels' output (TOAD_LAZY_PARSE=0 disables)
+    int panel_count;
+    int active_panel;
+    layout_t layout;                // Where the tiled panels go
+    int zoomed_panel;               // Panel given the whole screen, or -1
+    int zoom_x, zoom_y, zoom_width, zoom_height;  // Its geometry before the zoom
+    int rewound_panel;              // Panel showing an earlier screen, or -1
+    uint64_t rewind_frame;          // Which one, a frame of its recording
+    terminal_panel_t rewind_view;   // That screen, drawn instead of the panel's
+    int screen_width, screen_height;
+    int should_quit;
+
+    // Input mode system
+    input_mode_t mode;
+    int ctrl_count;
+
+    // Rendering optimization
+    bool force_full_redraw;
+    bool status_line_dirty;
+    bool cursor_dirty;              // Active panel's cursor moved without cell damage
+    int exposed_x0, exposed_y0;     // Host area a moved or resized overlay
+    int exposed_x1, exposed_y1;     // uncovered (half-open, empty if x0 >= x1)
+    char status_message[320];  // Shown on the status line until replaced
+
+    toad_stats_t stats;
+} multiplexer_t;
+
+// Multiplexer state, defined by the program that links the renderer
+extern multiplexer_t mux;
+
+// Panel screen buffers (panel.c)
+void init_panel_screen(terminal_panel_t *panel);
+void free_panel_screen(terminal_panel_t *panel);
+
+// Resize a panel's screen buffer, keeping the cursor row on screen by moving
+// rows to and from the scrollback (panel.c)
+bool resize_panel_screen(terminal_panel_t *panel, int width, int height);
+
+// Hibernation of idle panels (panel.c): their history, and their screen
+// when hidden, are packed, their rewind recording is dropped and the freed
+// memory returned to the system. Waking unpacks them again, and the next
+// output starts a new recording; these return false only when out of
+// memory.
+bool hibernate_panel(terminal_panel_t *panel, bool pack_screen);
+bool wake_panel_screen(terminal_panel_t *panel);
+bool wake_panel_recording(terminal_panel_t *panel);
+bool wake_panel(terminal_panel_t *panel);
+
+// Capture a panel's scrollback and screen to a file (panel.c)
+bool capture_panel_to_file(terminal_panel_t *panel, vte_capture_format_t format, const char *path);
+
+// Layout tree (layout.c). Operations flag the leaves whose rectangle
+// changed; split, remove and resize return false when nothing was done.
+void layout_init(layout_t *layout, int panel_index, int x, int y, int width, int height);
+void layout_set_area(layout_t *layout, int x, int y, int width, int height);
+int layout_find(const layout_t *layout, int panel_index);
+bool layout_split(layout_t *layout, int panel_index, layout_kind_t kind, int new_panel_index);
+bool layout_remove(layout_t *layout, int panel_index);
+bool layout_resize(layout_t *layout, int panel_index, layout_kind_t kind, int delta);
+void layout_renumber(layout_t *layout, int old_index, int new_index);
+
+// Panel management (main.c)
+int create_overlay_panel(const char *command);
+int split_panel(int panel_index, layout_kind_t kind, const char *command);
+void bring_panel_to_front(int panel_index);
+void close_panel(int panel_index);
+bool resize_panel(int panel_index, int width, int height);
+bool move_panel(int panel_index, int x, int y);
+void focus_panel(int panel_index);
+void toggle_zoom(int panel_index);
+void unzoom_panel(void);
+void hibernate_idle_panel(int panel_index);
+void catch_up_panel(int panel_index);
+bool rewind_panel(int panel_index, uint64_t frame);
+void end_rewind(void);
+
+// Control socket (control.c)
+bool control_init(void);
+void control_shutdown(void);
+int control_add_fds(fd_set *read_fds, fd_set *write_fds, int max_fd);
+void control_handle_fds(fd_set *read_fds, fd_set *write_fds);
+void control_apply(void);
+
+// Event loop (reactor.c). Streams are ptys the reactor reads and writes.
+// Reads go straight into space the owner hands out (up to two segments, none
+// to skip a read); the read callback then gets the bytes stored there, or len
+// 0 (end of file) or -1 (read error) once when the stream ends. In packet
+// mode (TIOCPKT) every read starts with a status byte, which the reactor
+// keeps apart and passes along, 0 for data.
+//
+// reactor_wait() waits for the streams, the descriptors set in read_fds and
+// write_fds, or the timeout, and leaves the ready ones set, returning how
+// many. Descriptors passed in the sets must be forgotten before they are
+// closed.
+typedef enum {
+    REACTOR_SELECT,
+    REACTOR_EPOLL,
+    REACTOR_URING
+} reactor_backend_t;
+
+typedef int (*reactor_space_fn)(int fd, struct iovec *iov);
+typedef void (*reactor_read_fn)(int fd, ssize_t len, uint8_t status);
+
+bool reactor_init(reactor_backend_t backend, reactor_space_fn read_space, reactor_read_fn on_read);
+void reactor_shutdown(void);
+reactor_backend_t reactor_backend(void);
+const char *reactor_backend_name(reactor_backend_t backend);
+bool reactor_backend_from_name(const char *name, reactor_backend_t *backend);
+bool reactor_add_stream(int fd, bool packet_mode);
+void reactor_remove_stream(int fd);
+void reactor_forget_fd(int fd);
+bool reactor_write(int fd, const char *data, size_t len);
+int reactor_wait(fd_set *read_fds, fd_set *write_fds, int max_fd, int timeout_us);
+
+// Monotonic clock for the performance counters
+uint64_t toad_now_ns(void);
+
+// Color pairs used by the renderer (render.c)
+void init_render_colors(void);
+
+// Dirty tracking (render.c)
+void mark_panel_dirty(int panel_index);
+void mark_all_panels_dirty(void);
+void mark_status_dirty(void);
+void mark_panel_chrome_dirty(int panel_index);
+void mark_cursor_dirty(int panel_index);
+void mark_region_exposed(int x, int y, int width, int height);
+
+// Decoration caches (render.c)
+void free_panel_chrome(int panel_index);
+void free_render_cache(void);
+
+// Rendering (render.c)
+void draw_background_pattern(void);
+void draw_colorful_border(WINDOW *win, bool active, panel_type_t type);
+void draw_panel(terminal_panel_t *panel, int panel_index);
+void draw_status_line(void);
+bool render_frame(void);
+
+#endif // TOAD_H
@@ -0,0 +1,370 @@
+#include "vte_capture.h"
+#include "vte_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define CAPTURE_FLUSH_SIZE 65536
+
+// Output buffer: accumulates in memory, and when writing to a descriptor is
+// flushed every CAPTURE_FLUSH_SIZE bytes
+typedef struct {
+    char *data;
+    size_t len, cap;
+    int fd;       // -1 when capturing to a string
+    bool failed;
+} capture_out_t;
+
+typedef struct {
+    int fg_color, bg_color, attrs;
+} capture_style_t;
+
+static const capture_style_t default_style = {
+    VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL
+};
+
+static void out_flush(capture_out_t *out) {
+    size_t off = 0;
+    while (off < out->len && !out->failed) {
+        ssize_t n = write(out->fd, out->data + off, out->len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            out->failed = true;
+        } else {
+            off += n;
+        }
+    }
+    out->len = 0;
+}
+
+// Make room for n more bytes; returns false if the buffer cannot grow
+static bool out_reserve(capture_out_t *out, size_t n) {
+    if (out->len + n <= out->cap) {
+        return true;
+    }
+    if (out->fd >= 0 && out->len > 0) {
+        out_flush(out);
+        if (n <= out->cap) {
+            return !out->failed;
+        }
+    }
+    size_t cap = out->cap ? out->cap : CAPTURE_FLUSH_SIZE;
+    while (cap < out->len + n) {
+        cap *= 2;
+    }
+    char *data = realloc(out->data, cap);
+    if (!data) {
+        out->failed = true;
+        return false;
+    }
+    out->data = data;
+    out->cap = cap;
+    return true;
+}
+
+static void out_append(capture_out_t *out, const char *text, size_t len) {
+    if (out_reserve(out, len)) {
+        memcpy(out->data + out->len, text, len);
+        out->len += len;
+    }
+}
+
+static void out_str(capture_out_t *out, const char *text) {
+    out_append(out, text, strlen(text));
+}
+
+static void out_int(capture_out_t *out, int value) {
+    char digits[12];
+    int n = 0;
+    unsigned v = value < 0 ? -(unsigned)value : (unsigned)value;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (!out_reserve(out, n + 1)) {
+        return;
+    }
+    if (value < 0) {
+        out->data[out->len++] = '-';
+    }
+    while (n > 0) {
+        out->data[out->len++] = digits[--n];
+    }
+}
+
+static bool style_equal(capture_style_t a, capture_style_t b) {
+    return a.fg_color == b.fg_color && a.bg_color == b.bg_color && a.attrs == b.attrs;
+}
+
+static capture_style_t cell_style(const terminal_cell_t *cell) {
+    capture_style_t style = { cell->fg_color, cell->bg_color, cell->attrs };
+    return style;
+}
+
+// ANSI: reset, then set the attributes and colors of the new style
+static void ansi_style(capture_out_t *out, capture_style_t style) {
+    static const struct { int bit; const char *sgr; } attrs[] = {
+        { VTE_ATTR_BOLD, ";1" }, { VTE_ATTR_DIM, ";2" }, { VTE_ATTR_ITALIC, ";3" },
+        { VTE_ATTR_UNDERLINE, ";4" }, { VTE_ATTR_BLINK, ";5" }, { VTE_ATTR_REVERSE, ";7" },
+        { VTE_ATTR_HIDDEN, ";8" }, { VTE_ATTR_STRIKE, ";9" },
+    };
+
+    out_str(out, "\033[0");
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+        if (style.attrs & attrs[i].bit) {
+            out_str(out, attrs[i].sgr);
+        }
+    }
+    if (style.fg_color >= 0) {
+        if (style.fg_color < 8) {
+            out_str(out, ";");
+            out_int(out, 30 + style.fg_color);
+        } else {
+            out_str(out, ";38;5;");
+            out_int(out, style.fg_color);
+        }
+    }
+    if (style.bg_color >= 0) {
+        if (style.bg_color < 8) {
+            out_str(out, ";");
+            out_int(out, 40 + style.bg_color);
+        } else {
+            out_str(out, ";48;5;");
+            out_int(out, style.bg_color);
+        }
+    }
+    out_str(out, "m");
+}
+
+// xterm 256-color palette as #rrggbb
+static void html_color(capture_out_t *out, int color) {
+    static const char *basic[16] = {
+        "#000000", "#cd0000", "#00cd00", "#cdcd00", "#0000ee", "#cd00cd", "#00cdcd", "#e5e5e5",
+        "#7f7f7f", "#ff0000", "#00ff00", "#ffff00", "#5c5cff", "#ff00ff", "#00ffff", "#ffffff",
+    };
+    static const char hex[] = "0123456789abcdef";
+
+    if (color < 16) {
+        out_str(out, basic[color]);
+        return;
+    }
+
+    int r, g, b;
+    if (color < 232) {
+        static const int levels[6] = { 0, 95, 135, 175, 215, 255 };
+        int index = color - 16;
+        r = levels[index / 36];
+        g = levels[(index / 6) % 6];
+        b = levels[index % 6];
+    } else {
+        r = g = b = 8 + (color - 232) * 10;
+    }
+    char text[8] = { '#', hex[r >> 4], hex[r & 15], hex[g >> 4], hex[g & 15],
+                     hex[b >> 4], hex[b & 15], '\0' };
+    out_str(out, text);
+}
+
+static void html_open_span(capture_out_t *out, capture_style_t style) {
+    int fg = style.fg_color, bg = style.bg_color;
+    bool reverse = (style.attrs & VTE_ATTR_REVERSE) != 0;
+    if (reverse) {
+        int swap = fg;
+        fg = bg;
+        bg = swap;
+    }
+
+    out_str(out, "<span style=\"");
+    if (fg >= 0) {
+        out_str(out, "color:");
+        html_color(out, fg);
+        out_str(out, ";");
+    } else if (reverse) {
+        out_str(out, "color:var(--toad-bg,#fff);");
+    }
+    if (bg >= 0) {
+        out_str(out, "background:");
+        html_color(out, bg);
+        out_str(out, ";");
+    } else if (reverse) {
+        out_str(out, "background:var(--toad-fg,#000);");
+    }
+    if (style.attrs & VTE_ATTR_BOLD) out_str(out, "font-weight:bold;");
+    if (style.attrs & VTE_ATTR_DIM) out_str(out, "opacity:.6;");
+    if (style.attrs & VTE_ATTR_ITALIC) out_str(out, "font-style:italic;");
+    if (style.attrs & (VTE_ATTR_UNDERLINE | VTE_ATTR_STRIKE)) {
+        out_str(out, "text-decoration:");
+        if (style.attrs & VTE_ATTR_UNDERLINE) out_str(out, " underline");
+        if (style.attrs & VTE_ATTR_STRIKE) out_str(out, " line-through");
+        out_str(out, ";");
+    }
+    if (style.attrs & VTE_ATTR_HIDDEN) out_str(out, "visibility:hidden;");
+    out_str(out, "\">");
+}
+
+// Append one cell's character. The caller has reserved CAPTURE_CELL_MAX
+// bytes for it.
+#define CAPTURE_CELL_MAX 6
+static void put_cell_text(capture_out_t *out, uint32_t codepoint, vte_capture_format_t format) {
+    char *dst = out->data + out->len;
+    if (codepoint >= 0x80) {
+        out->len += vte_utf8_encode(codepoint, dst);
+        return;
+    }
+    if (codepoint < 0x20 || codepoint == 0x7F) {
+        codepoint = ' ';
+    }
+    if (format == VTE_CAPTURE_HTML) {
+        const char *entity = NULL;
+        switch (codepoint) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+        }
+        if (entity) {
+            size_t n = strlen(entity);
+            memcpy(dst, entity, n);
+            out->len += n;
+            return;
+        }
+    }
+    *dst = (char)codepoint;
+    out->len++;
+}
+
+static void capture_line(capture_out_t *out, const terminal_cell_t *cells, int len,
+                         vte_capture_format_t format) {
+    // Trailing blanks are dropped; in styled formats only unstyled ones
+    if (format == VTE_CAPTURE_TEXT) {
+        while (len > 0 && cells[len - 1].codepoint == ' ') {
+            len--;
+        }
+    } else {
+        len = (int)vte_kernel->trim_blank_cells(cells, len);
+    }
+
+    // Room for every character of the line up front; style changes reserve
+    // their own space as they are written
+    if (!out_reserve(out, (size_t)len * CAPTURE_CELL_MAX + 1)) {
+        return;
+    }
+
+    if (format == VTE_CAPTURE_TEXT) {
+        for (int x = 0; x < len; x++) {
+            put_cell_text(out, cells[x].codepoint, format);
+        }
+        out->data[out->len++] = '\n';
+        return;
+    }
+
+    capture_style_t current = default_style;
+    for (int x = 0; x < len; x++) {
+        capture_style_t style = cell_style(&cells[x]);
+        if (!style_equal(style, current)) {
+            if (format == VTE_CAPTURE_ANSI) {
+                ansi_style(out, style);
+            } else {
+                if (!style_equal(current, default_style)) {
+                    out_str(out, "</span>");
+                }
+                if (!style_equal(style, default_style)) {
+                    html_open_span(out, style);
+                }
+            }
+            current = style;
+            if (!out_reserve(out, (size_t)(len - x) * CAPTURE_CELL_MAX + 1)) {
+                return;
+            }
+        }
+        put_cell_text(out, cells[x].codepoint, format);
+    }
+
+    if (!style_equal(current, default_style)) {
+        out_str(out, format == VTE_CAPTURE_ANSI ? "\033[0m" : "</span>");
+    }
+    out_append(out, "\n", 1);
+}
+
+static void capture(const terminal_panel_t *panel, int first, int last,
+                    vte_capture_format_t format, capture_out_t *out) {
+    int history = (int)vte_scrollback_count(&panel->scrollback);
+    if (first < -history) {
+        first = -history;
+    }
+    if (last > panel->screen_height - 1) {
+        last = panel->screen_height - 1;
+    }
+
+    if (format == VTE_CAPTURE_HTML) {
+        out_str(out, "<pre class=\"toad-capture\">\n");
+    }
+    // History lines are copied out of the scrollback into one reused row
+    terminal_cell_t *row = NULL;
+    int row_allocated = 0;
+    for (int line = first; line <= last && !out->failed; line++) {
+        if (line < 0) {
+            size_t index = (size_t)(history + line);
+            int len = vte_scrollback_line(&panel->scrollback, index, row, row_allocated);
+            if (len > row_allocated) {
+                int count = len > panel->screen_width ? len : panel->screen_width;
+                terminal_cell_t *grown = realloc(row, count * sizeof(terminal_cell_t));
+                if (!grown) {
+                    out->failed = true;
+                    break;
+                }
+                row = grown;
+                row_allocated = count;
+                vte_scrollback_line(&panel->scrollback, index, row, row_allocated);
+            }
+            capture_line(out, row, len, format);
+        } else {
+            capture_line(out, panel->screen[line], panel->screen_width, format);
+        }
+    }
+    free(row);
+    if (format == VTE_CAPTURE_HTML) {
+        out_str(out, "</pre>\n");
+    }
+}
+
+bool vte_capture_fd(const terminal_panel_t *panel, int first, int last,
+                    vte_capture_format_t format, int fd) {
+    capture_out_t out = { NULL, 0, 0, fd, false };
+    capture(panel, first, last, format, &out);
+    if (out.len > 0) {
+        out_flush(&out);
+    }
+    free(out.data);
+    return !out.failed;
+}
+
+char *vte_capture_string(const terminal_panel_t *panel, int first, int last,
+                         vte_capture_format_t format, size_t *len) {
+    capture_out_t out = { NULL, 0, 0, -1, false };
+    capture(panel, first, last, format, &out);
+    if (out.failed || !out_reserve(&out, 1)) {
+        free(out.data);
+        return NULL;
+    }
+    out.data[out.len] = '\0';
+    if (len) {
+        *len = out.len;
+    }
+    return out.data;
+}
+
+bool vte_capture_parse_format(const char *name, vte_capture_format_t *format) {
+    if (strcmp(name, "text") == 0) {
+        *format = VTE_CAPTURE_TEXT;
+    } else if (strcmp(name, "ansi") == 0) {
+        *format = VTE_CAPTURE_ANSI;
+    } else if (strcmp(name, "html") == 0) {
+        *format = VTE_CAPTURE_HTML;
+    } else {
+        return false;
+    }
+    return true;
+}
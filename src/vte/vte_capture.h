@@ -0,0 +1,37 @@
+#ifndef VTE_CAPTURE_H
+#define VTE_CAPTURE_H
+
+#include "vte_parser.h"
+
+// Capture (like tmux capture-pane): export a range of a panel's scrollback and
+// screen as plain text, text with ANSI SGR styles, or HTML. Each line is
+// written in a single pass over its cells, switching styles where a style run
+// changes, into one output buffer.
+//
+// Lines are numbered like tmux: 0 is the top row of the screen and negative
+// numbers count back into the scrollback, -1 being the newest history line.
+// Ranges are clamped to what exists, so VTE_CAPTURE_FIRST..VTE_CAPTURE_LAST
+// selects the whole history and screen.
+
+#define VTE_CAPTURE_FIRST (-0x7FFFFFFF)
+#define VTE_CAPTURE_LAST  0x7FFFFFFF
+
+typedef enum {
+    VTE_CAPTURE_TEXT,  // Plain text, trailing blanks trimmed
+    VTE_CAPTURE_ANSI,  // Text with SGR sequences for colors and attributes
+    VTE_CAPTURE_HTML   // A <pre> block with styled spans
+} vte_capture_format_t;
+
+// Write lines first..last to fd. Returns false if a write failed.
+bool vte_capture_fd(const terminal_panel_t *panel, int first, int last,
+                    vte_capture_format_t format, int fd);
+
+// Capture lines first..last into a malloc'd, NUL-terminated string. Returns
+// NULL on allocation failure; *len (if not NULL) receives the length.
+char *vte_capture_string(const terminal_panel_t *panel, int first, int last,
+                         vte_capture_format_t format, size_t *len);
+
+// Parse a format name ("text", "ansi", "html"); returns false if unknown
+bool vte_capture_parse_format(const char *name, vte_capture_format_t *format);
+
+#endif // VTE_CAPTURE_H
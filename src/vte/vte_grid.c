@@ -0,0 +1,596 @@
+#include "vte_grid.h"
+#include "vte_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Style word: fg_color + 1 in bits 0-8, bg_color + 1 in bits 9-17, attrs in
+// bits 18-25
+#define STYLE_COLOR_MASK 0x1FF
+#define STYLE_BG_SHIFT 9
+#define STYLE_ATTRS_SHIFT 18
+#define STYLE_ATTRS_MASK 0xFF
+
+uint32_t vte_grid_style(int fg_color, int bg_color, int attrs) {
+    return ((uint32_t)(fg_color + 1) & STYLE_COLOR_MASK) |
+           (((uint32_t)(bg_color + 1) & STYLE_COLOR_MASK) << STYLE_BG_SHIFT) |
+           (((uint32_t)attrs & STYLE_ATTRS_MASK) << STYLE_ATTRS_SHIFT);
+}
+
+void vte_grid_unpack_style(uint32_t style, int *fg_color, int *bg_color, int *attrs) {
+    *fg_color = (int)(style & STYLE_COLOR_MASK) - 1;
+    *bg_color = (int)((style >> STYLE_BG_SHIFT) & STYLE_COLOR_MASK) - 1;
+    *attrs = (int)((style >> STYLE_ATTRS_SHIFT) & STYLE_ATTRS_MASK);
+}
+
+static uint32_t cell_style(const terminal_cell_t *cell) {
+    return vte_grid_style(cell->fg_color, cell->bg_color, cell->attrs);
+}
+
+// Byte size of a row, of one plane for soa
+static size_t row_bytes(const vte_grid_t *grid) {
+    return grid->columns * (grid->layout == VTE_GRID_AOS ? sizeof(terminal_cell_t) : sizeof(uint32_t));
+}
+
+// Adaptive rows
+
+static uint32_t run_style(const vte_grid_row_t *row, int x) {
+    int r = row->run_count - 1;
+    while (r > 0 && row->runs[r].start > x) {
+        r--;
+    }
+    return row->runs[r].style;
+}
+
+// Append a run, merging it into the last one when the style is the same so
+// equal rows have equal run lists
+static void add_run(vte_grid_run_t *runs, int *count, int start, uint32_t style) {
+    if (*count > 0 && runs[*count - 1].start == start) {
+        (*count)--;
+    }
+    if (*count > 0 && runs[*count - 1].style == style) {
+        return;
+    }
+    runs[(*count)++] = (vte_grid_run_t){ start, style };
+}
+
+// Give columns x0..x1-1 of a compact row one style. Returns false, leaving
+// the row alone, if that takes more runs than fit.
+static bool set_run(vte_grid_row_t *row, int columns, int x0, int x1, uint32_t style) {
+    vte_grid_run_t runs[VTE_GRID_RUNS + 2];
+    int count = 0;
+    int r = 0;
+    for (; r < row->run_count && row->runs[r].start < x0; r++) {
+        add_run(runs, &count, row->runs[r].start, row->runs[r].style);
+    }
+    add_run(runs, &count, x0, style);
+    if (x1 < columns) {
+        add_run(runs, &count, x1, run_style(row, x1));
+    }
+    for (; r < row->run_count; r++) {
+        if (row->runs[r].start > x1) {
+            add_run(runs, &count, row->runs[r].start, row->runs[r].style);
+        }
+    }
+    if (count > VTE_GRID_RUNS) {
+        return false;
+    }
+    memcpy(row->runs, runs, count * sizeof(vte_grid_run_t));
+    row->run_count = count;
+    return true;
+}
+
+// Make a row compact and blank, freeing its full cells
+static void reset_row(vte_grid_t *grid, vte_grid_row_t *row) {
+    free(row->cells);
+    row->cells = NULL;
+    row->encoding = VTE_ROW_COMPACT;
+    memcpy(row->chars, grid->blank, grid->columns);
+    row->run_count = 1;
+    row->runs[0] = (vte_grid_run_t){ 0, 0 };
+}
+
+static void expand_row(const vte_grid_row_t *row, int columns, terminal_cell_t *cells) {
+    for (int r = 0; r < row->run_count; r++) {
+        int end = r + 1 < row->run_count ? row->runs[r + 1].start : columns;
+        terminal_cell_t cell;
+        vte_grid_unpack_style(row->runs[r].style, &cell.fg_color, &cell.bg_color, &cell.attrs);
+        for (int x = row->runs[r].start; x < end; x++) {
+            cell.codepoint = row->chars[x];
+            cells[x] = cell;
+        }
+    }
+}
+
+// Switch a compact row to full cells; false if they cannot be allocated
+static bool upgrade_row(const vte_grid_t *grid, vte_grid_row_t *row) {
+    if (row->encoding == VTE_ROW_FULL) {
+        return true;
+    }
+    row->cells = malloc(grid->columns * sizeof(terminal_cell_t));
+    if (!row->cells) {
+        return false;
+    }
+    expand_row(row, grid->columns, row->cells);
+    row->encoding = VTE_ROW_FULL;
+    return true;
+}
+
+bool vte_grid_init(vte_grid_t *grid, vte_grid_layout_t layout, int columns, int rows) {
+    memset(grid, 0, sizeof(*grid));
+    if (columns <= 0 || rows <= 0) {
+        return false;
+    }
+    size_t cells = (size_t)columns * rows;
+    grid->layout = layout;
+    grid->columns = columns;
+    grid->rows = rows;
+    grid->spare = malloc(rows * sizeof(*grid->spare));
+    if (!grid->spare) {
+        return false;
+    }
+
+    if (layout == VTE_GRID_AOS) {
+        grid->storage = malloc(cells * sizeof(terminal_cell_t));
+        grid->cells = malloc(rows * sizeof(*grid->cells));
+        grid->blank = malloc(columns * sizeof(terminal_cell_t));
+        if (!grid->storage || !grid->cells || !grid->blank) {
+            vte_grid_free(grid);
+            return false;
+        }
+        vte_kernel->fill_cells(grid->blank, columns, VTE_BLANK_CELL);
+        for (int y = 0; y < rows; y++) {
+            grid->cells[y] = (terminal_cell_t *)grid->storage + (size_t)y * columns;
+        }
+    } else if (layout == VTE_GRID_ADAPTIVE) {
+        // Row headers and their compact characters in one block; the blank
+        // row is a row of spaces
+        grid->storage = malloc(rows * (sizeof(vte_grid_row_t) + columns));
+        grid->lines = calloc(rows, sizeof(*grid->lines));
+        grid->blank = malloc(columns);
+        if (!grid->storage || !grid->lines || !grid->blank) {
+            vte_grid_free(grid);
+            return false;
+        }
+        memset(grid->blank, ' ', columns);
+        uint8_t *chars = (uint8_t *)((vte_grid_row_t *)grid->storage + rows);
+        for (int y = 0; y < rows; y++) {
+            grid->lines[y] = (vte_grid_row_t *)grid->storage + y;
+            grid->lines[y]->cells = NULL;
+            grid->lines[y]->chars = chars + (size_t)y * columns;
+        }
+    } else {
+        // Both planes in one block, codepoints first; the blank row the same
+        grid->storage = malloc(cells * 2 * sizeof(uint32_t));
+        grid->codepoints = malloc(rows * sizeof(*grid->codepoints));
+        grid->styles = malloc(rows * sizeof(*grid->styles));
+        grid->blank = calloc((size_t)columns * 2, sizeof(uint32_t));
+        if (!grid->storage || !grid->codepoints || !grid->styles || !grid->blank) {
+            vte_grid_free(grid);
+            return false;
+        }
+        vte_kernel->fill_u32(grid->blank, columns, ' ');
+        for (int y = 0; y < rows; y++) {
+            grid->codepoints[y] = (uint32_t *)grid->storage + (size_t)y * columns;
+            grid->styles[y] = (uint32_t *)grid->storage + cells + (size_t)y * columns;
+        }
+    }
+
+    for (int y = 0; y < rows; y++) {
+        vte_grid_fill(grid, y, 0, columns, ' ', 0);
+    }
+    return true;
+}
+
+void vte_grid_free(vte_grid_t *grid) {
+    for (int y = 0; grid->lines && grid->lines[y] && y < grid->rows; y++) {
+        free(grid->lines[y]->cells);
+    }
+    free(grid->lines);
+    free(grid->storage);
+    free(grid->cells);
+    free(grid->codepoints);
+    free(grid->styles);
+    free(grid->blank);
+    free(grid->spare);
+    memset(grid, 0, sizeof(*grid));
+}
+
+size_t vte_grid_memory(const vte_grid_t *grid) {
+    size_t cells = (size_t)grid->columns * grid->rows;
+    if (grid->layout == VTE_GRID_AOS) {
+        return cells * sizeof(terminal_cell_t);
+    }
+    if (grid->layout == VTE_GRID_SOA) {
+        return cells * 2 * sizeof(uint32_t);
+    }
+    size_t bytes = grid->rows * sizeof(vte_grid_row_t) + cells;
+    for (int y = 0; y < grid->rows; y++) {
+        if (grid->lines[y]->encoding == VTE_ROW_FULL) {
+            bytes += grid->columns * sizeof(terminal_cell_t);
+        }
+    }
+    return bytes;
+}
+
+bool vte_grid_row_compact(const vte_grid_t *grid, int y) {
+    return grid->layout == VTE_GRID_ADAPTIVE && grid->lines[y]->encoding == VTE_ROW_COMPACT;
+}
+
+void vte_grid_get(const vte_grid_t *grid, int x, int y, terminal_cell_t *cell) {
+    if (grid->layout == VTE_GRID_AOS) {
+        *cell = grid->cells[y][x];
+        return;
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        const vte_grid_row_t *row = grid->lines[y];
+        if (row->encoding == VTE_ROW_FULL) {
+            *cell = row->cells[x];
+            return;
+        }
+        cell->codepoint = row->chars[x];
+        vte_grid_unpack_style(run_style(row, x), &cell->fg_color, &cell->bg_color, &cell->attrs);
+        return;
+    }
+    cell->codepoint = grid->codepoints[y][x];
+    vte_grid_unpack_style(grid->styles[y][x], &cell->fg_color, &cell->bg_color, &cell->attrs);
+}
+
+void vte_grid_set(vte_grid_t *grid, int x, int y, const terminal_cell_t *cell) {
+    if (grid->layout == VTE_GRID_AOS) {
+        grid->cells[y][x] = *cell;
+        return;
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        vte_grid_row_t *row = grid->lines[y];
+        if (row->encoding == VTE_ROW_COMPACT && cell->codepoint < 0x80 &&
+            set_run(row, grid->columns, x, x + 1, cell_style(cell))) {
+            row->chars[x] = (uint8_t)cell->codepoint;
+        } else if (upgrade_row(grid, row)) {
+            row->cells[x] = *cell;
+        }
+        return;
+    }
+    grid->codepoints[y][x] = cell->codepoint;
+    grid->styles[y][x] = cell_style(cell);
+}
+
+// Store a row compact if it fits, full otherwise
+static void store_adaptive_row(vte_grid_t *grid, vte_grid_row_t *row, const terminal_cell_t *cells) {
+    vte_grid_run_t runs[VTE_GRID_RUNS + 1];
+    int count = 0;
+    bool compact = vte_kernel->ascii_only(cells, grid->columns);
+    for (int x = 0; compact && x < grid->columns; x++) {
+        if (x > 0 && cells[x].fg_color == cells[x - 1].fg_color &&
+            cells[x].bg_color == cells[x - 1].bg_color && cells[x].attrs == cells[x - 1].attrs) {
+            continue;
+        }
+        add_run(runs, &count, x, cell_style(&cells[x]));
+        compact = count <= VTE_GRID_RUNS;
+    }
+    if (!compact) {
+        if (upgrade_row(grid, row)) {
+            memcpy(row->cells, cells, grid->columns * sizeof(terminal_cell_t));
+        }
+        return;
+    }
+    free(row->cells);
+    row->cells = NULL;
+    row->encoding = VTE_ROW_COMPACT;
+    for (int x = 0; x < grid->columns; x++) {
+        row->chars[x] = (uint8_t)cells[x].codepoint;
+    }
+    memcpy(row->runs, runs, count * sizeof(vte_grid_run_t));
+    row->run_count = count;
+}
+
+void vte_grid_store_row(vte_grid_t *grid, int y, const terminal_cell_t *cells) {
+    if (grid->layout == VTE_GRID_AOS) {
+        memcpy(grid->cells[y], cells, grid->columns * sizeof(terminal_cell_t));
+        return;
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        store_adaptive_row(grid, grid->lines[y], cells);
+        return;
+    }
+    uint32_t *codepoints = grid->codepoints[y];
+    uint32_t *styles = grid->styles[y];
+    for (int x = 0; x < grid->columns; x++) {
+        codepoints[x] = cells[x].codepoint;
+    }
+    for (int x = 0; x < grid->columns; x++) {
+        styles[x] = cell_style(&cells[x]);
+    }
+}
+
+void vte_grid_load_row(const vte_grid_t *grid, int y, terminal_cell_t *cells) {
+    if (grid->layout == VTE_GRID_AOS) {
+        memcpy(cells, grid->cells[y], grid->columns * sizeof(terminal_cell_t));
+        return;
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        const vte_grid_row_t *row = grid->lines[y];
+        if (row->encoding == VTE_ROW_FULL) {
+            memcpy(cells, row->cells, grid->columns * sizeof(terminal_cell_t));
+        } else {
+            expand_row(row, grid->columns, cells);
+        }
+        return;
+    }
+    for (int x = 0; x < grid->columns; x++) {
+        vte_grid_get(grid, x, y, &cells[x]);
+    }
+}
+
+static void fill_adaptive_row(vte_grid_t *grid, vte_grid_row_t *row, int x0, int x1,
+                              uint32_t codepoint, uint32_t style) {
+    if (codepoint < 0x80) {
+        if (x0 == 0 && x1 == grid->columns) {
+            // A whole row of one cell is compact whatever it was
+            reset_row(grid, row);
+            row->runs[0].style = style;
+            if (codepoint != ' ') {
+                memset(row->chars, (int)codepoint, grid->columns);
+            }
+            return;
+        }
+        if (row->encoding == VTE_ROW_COMPACT && set_run(row, grid->columns, x0, x1, style)) {
+            memset(row->chars + x0, (int)codepoint, x1 - x0);
+            return;
+        }
+    }
+    if (upgrade_row(grid, row)) {
+        terminal_cell_t cell = { .codepoint = codepoint };
+        vte_grid_unpack_style(style, &cell.fg_color, &cell.bg_color, &cell.attrs);
+        vte_kernel->fill_cells(&row->cells[x0], x1 - x0, cell);
+    }
+}
+
+void vte_grid_fill(vte_grid_t *grid, int y, int x0, int x1, uint32_t codepoint, uint32_t style) {
+    if (x0 >= x1) {
+        return;
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        fill_adaptive_row(grid, grid->lines[y], x0, x1, codepoint, style);
+        return;
+    }
+    if (x0 == 0 && x1 == grid->columns && codepoint == ' ' && style == 0) {
+        // Clearing a whole row copies the blank row
+        if (grid->layout == VTE_GRID_AOS) {
+            memcpy(grid->cells[y], grid->blank, row_bytes(grid));
+        } else {
+            memcpy(grid->codepoints[y], grid->blank, row_bytes(grid));
+            memset(grid->styles[y], 0, row_bytes(grid));
+        }
+        return;
+    }
+    if (grid->layout == VTE_GRID_AOS) {
+        terminal_cell_t cell = { .codepoint = codepoint };
+        vte_grid_unpack_style(style, &cell.fg_color, &cell.bg_color, &cell.attrs);
+        vte_kernel->fill_cells(&grid->cells[y][x0], x1 - x0, cell);
+        return;
+    }
+    vte_kernel->fill_u32(&grid->codepoints[y][x0], x1 - x0, codepoint);
+    vte_kernel->fill_u32(&grid->styles[y][x0], x1 - x0, style);
+}
+
+bool vte_grid_row_blank(const vte_grid_t *grid, int y) {
+    if (grid->layout == VTE_GRID_ADAPTIVE) {
+        const vte_grid_row_t *row = grid->lines[y];
+        if (row->encoding == VTE_ROW_FULL) {
+            return vte_kernel->find_nonblank_cells(row->cells, grid->columns) == (size_t)grid->columns;
+        }
+        return row->run_count == 1 && row->runs[0].style == 0 &&
+               memcmp(row->chars, grid->blank, grid->columns) == 0;
+    }
+    if (grid->layout == VTE_GRID_AOS) {
+        return memcmp(grid->cells[y], grid->blank, row_bytes(grid)) == 0;
+    }
+    // Each plane against its half of the blank row
+    return memcmp(grid->codepoints[y], grid->blank, row_bytes(grid)) == 0 &&
+           memcmp(grid->styles[y], (const uint32_t *)grid->blank + grid->columns, row_bytes(grid)) == 0;
+}
+
+// Row y as terminal cells if it is stored that way, else NULL
+static const terminal_cell_t *full_row(const vte_grid_t *grid, int y) {
+    if (grid->layout == VTE_GRID_AOS) {
+        return grid->cells[y];
+    }
+    if (grid->layout == VTE_GRID_ADAPTIVE && grid->lines[y]->encoding == VTE_ROW_FULL) {
+        return grid->lines[y]->cells;
+    }
+    return NULL;
+}
+
+bool vte_grid_rows_equal(const vte_grid_t *a, int ay, const vte_grid_t *b, int by) {
+    size_t columns = a->columns;
+    if (a->layout == VTE_GRID_SOA && b->layout == VTE_GRID_SOA) {
+        return memcmp(a->codepoints[ay], b->codepoints[by], columns * sizeof(uint32_t)) == 0 &&
+               memcmp(a->styles[ay], b->styles[by], columns * sizeof(uint32_t)) == 0;
+    }
+    const terminal_cell_t *cells_a = full_row(a, ay), *cells_b = full_row(b, by);
+    if (cells_a && cells_b) {
+        return memcmp(cells_a, cells_b, columns * sizeof(terminal_cell_t)) == 0;
+    }
+    if (vte_grid_row_compact(a, ay) && vte_grid_row_compact(b, by)) {
+        // Run lists are merged, so equal rows have equal ones
+        const vte_grid_row_t *ra = a->lines[ay], *rb = b->lines[by];
+        return ra->run_count == rb->run_count &&
+               memcmp(ra->runs, rb->runs, ra->run_count * sizeof(vte_grid_run_t)) == 0 &&
+               memcmp(ra->chars, rb->chars, columns) == 0;
+    }
+    for (size_t x = 0; x < columns; x++) {
+        terminal_cell_t ca, cb;
+        vte_grid_get(a, (int)x, ay, &ca);
+        vte_grid_get(b, (int)x, by, &cb);
+        if (memcmp(&ca, &cb, sizeof(ca)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool same_cell(const terminal_cell_t *a, const terminal_cell_t *b) {
+    return a->codepoint == b->codepoint && a->fg_color == b->fg_color &&
+           a->bg_color == b->bg_color && a->attrs == b->attrs;
+}
+
+// Whether column x of a compact row holds cell, the run's style unpacked
+// into style
+static bool compact_cell_is(const vte_grid_row_t *line, const terminal_cell_t *style, int x,
+                            const terminal_cell_t *cell) {
+    return cell->codepoint == line->chars[x] && cell->fg_color == style->fg_color &&
+           cell->bg_color == style->bg_color && cell->attrs == style->attrs;
+}
+
+static void run_cell_style(const vte_grid_row_t *line, int r, terminal_cell_t *style) {
+    vte_grid_unpack_style(line->runs[r].style, &style->fg_color, &style->bg_color, &style->attrs);
+}
+
+static bool grid_cell_is(const vte_grid_t *grid, int x, int y, const terminal_cell_t *cell) {
+    terminal_cell_t stored;
+    vte_grid_get(grid, x, y, &stored);
+    return same_cell(&stored, cell);
+}
+
+bool vte_grid_row_diff(const vte_grid_t *grid, int y, const terminal_cell_t *cells, int *x0, int *x1) {
+    int columns = grid->columns;
+    int first = columns, last = columns;
+    const terminal_cell_t *row = full_row(grid, y);
+    if (row) {
+        first = (int)vte_kernel->first_diff_cells(row, cells, columns);
+        while (last > first && same_cell(&row[last - 1], &cells[last - 1])) {
+            last--;
+        }
+    } else if (vte_grid_row_compact(grid, y)) {
+        // Run by run from either end, against the run's style unpacked once
+        const vte_grid_row_t *line = grid->lines[y];
+        terminal_cell_t style;
+        for (int r = 0; r < line->run_count && first == columns; r++) {
+            int end = r + 1 < line->run_count ? line->runs[r + 1].start : columns;
+            int x = line->runs[r].start;
+            run_cell_style(line, r, &style);
+            while (x < end && compact_cell_is(line, &style, x, &cells[x])) {
+                x++;
+            }
+            first = x < end ? x : columns;
+        }
+        for (int r = line->run_count; r-- > 0 && last > first;) {
+            int start = line->runs[r].start > first ? line->runs[r].start : first;
+            run_cell_style(line, r, &style);
+            while (last > start && compact_cell_is(line, &style, last - 1, &cells[last - 1])) {
+                last--;
+            }
+            if (last > start) {
+                break;
+            }
+        }
+    } else {
+        first = 0;
+        while (first < columns && grid_cell_is(grid, first, y, &cells[first])) {
+            first++;
+        }
+        while (last > first && grid_cell_is(grid, last - 1, y, &cells[last - 1])) {
+            last--;
+        }
+    }
+    if (first == columns) {
+        return false;
+    }
+    *x0 = first;
+    *x1 = last;
+    return true;
+}
+
+// Search compact characters, where text outside ASCII cannot be
+static int find_compact(const uint8_t *chars, int start, int last, const uint32_t *text, int len) {
+    for (int i = 0; i < len; i++) {
+        if (text[i] >= 0x80) {
+            return -1;
+        }
+    }
+    for (int x = start; x <= last; x++) {
+        const uint8_t *hit = memchr(&chars[x], (int)text[0], last + 1 - x);
+        if (!hit) {
+            break;
+        }
+        x = (int)(hit - chars);
+        int i = 1;
+        while (i < len && chars[x + i] == text[i]) {
+            i++;
+        }
+        if (i == len) {
+            return x;
+        }
+    }
+    return -1;
+}
+
+int vte_grid_find(const vte_grid_t *grid, int y, int start, const uint32_t *text, int len) {
+    if (len <= 0 || start < 0) {
+        return -1;
+    }
+    int last = grid->columns - len;
+    if (vte_grid_row_compact(grid, y)) {
+        return find_compact(grid->lines[y]->chars, start, last, text, len);
+    }
+    const terminal_cell_t *row = full_row(grid, y);
+    if (row) {
+        for (int x = start; x <= last; x++) {
+            int i = 0;
+            while (i < len && row[x + i].codepoint == text[i]) {
+                i++;
+            }
+            if (i == len) {
+                return x;
+            }
+        }
+        return -1;
+    }
+    // Jump between candidates for the first codepoint
+    const uint32_t *codepoints = grid->codepoints[y];
+    for (int x = start; x <= last; x++) {
+        x += (int)vte_kernel->find_u32(&codepoints[x], last + 1 - x, text[0]);
+        if (x > last) {
+            break;
+        }
+        if (memcmp(&codepoints[x], text, len * sizeof(uint32_t)) == 0) {
+            return x;
+        }
+    }
+    return -1;
+}
+
+// Rotate row pointers top..bottom up by lines, through the spare array
+static void rotate_rows(vte_grid_t *grid, void *rows, size_t size, int top, int bottom, int lines) {
+    char *base = rows;
+    memcpy(grid->spare, base + top * size, lines * size);
+    memmove(base + top * size, base + (top + lines) * size, (bottom + 1 - top - lines) * size);
+    memcpy(base + (bottom + 1 - lines) * size, grid->spare, lines * size);
+}
+
+void vte_grid_scroll(vte_grid_t *grid, int top, int bottom, int lines) {
+    int count = bottom - top + 1;
+    if (count <= 0 || lines == 0) {
+        return;
+    }
+    int shift = lines > 0 ? lines : -lines;
+    if (shift > count) {
+        shift = count;
+    }
+    // Scrolling down by n is rotating up by count - n
+    int up = lines > 0 ? shift : count - shift;
+    if (up > 0 && up < count) {
+        if (grid->layout == VTE_GRID_AOS) {
+            rotate_rows(grid, grid->cells, sizeof(*grid->cells), top, bottom, up);
+        } else if (grid->layout == VTE_GRID_ADAPTIVE) {
+            rotate_rows(grid, grid->lines, sizeof(*grid->lines), top, bottom, up);
+        } else {
+            rotate_rows(grid, grid->codepoints, sizeof(*grid->codepoints), top, bottom, up);
+            rotate_rows(grid, grid->styles, sizeof(*grid->styles), top, bottom, up);
+        }
+    }
+    int first = lines > 0 ? bottom - shift + 1 : top;
+    for (int y = first; y < first + shift; y++) {
+        vte_grid_fill(grid, y, 0, grid->columns, ' ', 0);
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef VTE_GRID_H
+#define VTE_GRID_H
+
+#include "vte_parser.h"
+
+// Cell grids in three layouts behind one accessor API, for front ends that
+// keep their own copy of a screen (the renderer's copy of what it drew, a
+// search buffer).
+//
+//   VTE_GRID_AOS       rows of terminal_cell_t, as panel->screen stores them
+//   VTE_GRID_SOA       per row a plane of codepoints and a plane of style words
+//   VTE_GRID_ADAPTIVE  rows tagged compact or full, see vte_grid_row_t
+//
+// A style word packs fg_color, bg_color and attrs, so the default style is 0
+// and words compare equal exactly when the styles do. Scanning text, diffing
+// rows or checking for blanks then loads 4 or 8 bytes per cell instead of 16,
+// and each plane can be compared, searched or filled on its own.
+//
+// Rows are reached through row pointers in every layout, so scrolling rotates
+// pointers and only clears the rows that come in.
+
+typedef enum {
+    VTE_GRID_AOS,
+    VTE_GRID_SOA,
+    VTE_GRID_ADAPTIVE
+} vte_grid_layout_t;
+
+// Most rows are plain ASCII in a style or two. An adaptive row starts
+// compact, one byte per column plus a short list of style runs, and is
+// upgraded to full terminal_cell_t cells by the first write of a non-ASCII
+// codepoint or of a style that needs more runs than fit. Storing a row that
+// fits, or clearing it whole, makes it compact again. A write that needs
+// the full form is dropped if its cells cannot be allocated.
+#define VTE_GRID_RUNS 4
+
+typedef enum {
+    VTE_ROW_COMPACT,
+    VTE_ROW_FULL
+} vte_grid_encoding_t;
+
+typedef struct {
+    int start;       // First column of the run, which ends where the next starts
+    uint32_t style;  // Style word
+} vte_grid_run_t;
+
+typedef struct {
+    vte_grid_encoding_t encoding;
+    uint8_t *chars;          // Compact: a codepoint below 0x80 per column
+    int run_count;           // Compact: runs in use, the first starting at 0
+    vte_grid_run_t runs[VTE_GRID_RUNS];
+    terminal_cell_t *cells;  // Full: allocated on upgrade, NULL while compact
+} vte_grid_row_t;
+
+typedef struct {
+    vte_grid_layout_t layout;
+    int columns, rows;
+    terminal_cell_t **cells;  // AoS rows
+    uint32_t **codepoints;    // SoA planes
+    uint32_t **styles;
+    vte_grid_row_t **lines;   // Adaptive rows
+    void *storage;            // One block behind all rows
+    void *blank;              // A blank row in the grid's layout (both planes
+                              // for soa), compared and copied whole
+    void **spare;             // Row pointers set aside while scrolling
+} vte_grid_t;
+
+// A grid of blanks; returns false on allocation failure
+bool vte_grid_init(vte_grid_t *grid, vte_grid_layout_t layout, int columns, int rows);
+void vte_grid_free(vte_grid_t *grid);
+
+// Bytes holding the cells, for comparing layouts
+size_t vte_grid_memory(const vte_grid_t *grid);
+
+// True if row y is stored compact (always false outside VTE_GRID_ADAPTIVE)
+bool vte_grid_row_compact(const vte_grid_t *grid, int y);
+
+// Style words: colors from VTE_COLOR_DEFAULT to 255, attrs VTE_ATTR_* bits
+uint32_t vte_grid_style(int fg_color, int bg_color, int attrs);
+void vte_grid_unpack_style(uint32_t style, int *fg_color, int *bg_color, int *attrs);
+
+void vte_grid_get(const vte_grid_t *grid, int x, int y, terminal_cell_t *cell);
+void vte_grid_set(vte_grid_t *grid, int x, int y, const terminal_cell_t *cell);
+
+// Copy a whole row in from or out to terminal cells
+void vte_grid_store_row(vte_grid_t *grid, int y, const terminal_cell_t *cells);
+void vte_grid_load_row(const vte_grid_t *grid, int y, terminal_cell_t *cells);
+
+// Fill columns x0..x1-1 of row y with one codepoint and style word
+void vte_grid_fill(vte_grid_t *grid, int y, int x0, int x1, uint32_t codepoint, uint32_t style);
+
+// True if row y holds only default-styled spaces
+bool vte_grid_row_blank(const vte_grid_t *grid, int y);
+
+// Compare row ay of a with row by of b; the grids need the same width but
+// not the same layout
+bool vte_grid_rows_equal(const vte_grid_t *a, int ay, const vte_grid_t *b, int by);
+
+// Compare row y with a row of terminal cells, as a renderer checks a panel
+// row against what it drew: the columns from *x0 up to *x1 hold every cell
+// that differs. Returns false, leaving them alone, if none does.
+bool vte_grid_row_diff(const vte_grid_t *grid, int y, const terminal_cell_t *cells, int *x0, int *x1);
+
+// First column at or after start of row y where text (len codepoints)
+// begins, or -1
+int vte_grid_find(const vte_grid_t *grid, int y, int start, const uint32_t *text, int len);
+
+// Scroll rows top..bottom (inclusive) up by lines, blanking the rows that
+// come in at the bottom; negative lines scroll down
+void vte_grid_scroll(vte_grid_t *grid, int top, int bottom, int lines);
+
+#endif // VTE_GRID_H
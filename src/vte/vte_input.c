@@ -0,0 +1,74 @@
+#include "vte_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Input ring: positions are byte counts since the ring was created, so
+// head == tail is empty and tail - head == size is full without a spare slot;
+// only their offsets modulo size index the buffer.
+
+bool vte_input_init(vte_input_t *input, size_t size) {
+    memset(input, 0, sizeof(*input));
+    size_t capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    input->data = malloc(capacity);
+    if (!input->data) {
+        return false;
+    }
+    input->size = capacity;
+    return true;
+}
+
+void vte_input_free(vte_input_t *input) {
+    free(input->data);
+    memset(input, 0, sizeof(*input));
+}
+
+size_t vte_input_pending(const vte_input_t *input) {
+    return input->tail - input->head;
+}
+
+int vte_input_span(const vte_input_t *input, size_t start, size_t end, struct iovec iov[2]) {
+    if (end <= start) {
+        return 0;
+    }
+    size_t offset = start & (input->size - 1);
+    size_t len = end - start;
+    size_t first = input->size - offset < len ? input->size - offset : len;
+    iov[0].iov_base = input->data + offset;
+    iov[0].iov_len = first;
+    if (first == len) {
+        return 1;
+    }
+    iov[1].iov_base = input->data;
+    iov[1].iov_len = len - first;
+    return 2;
+}
+
+int vte_input_space(vte_input_t *input, size_t max, struct iovec iov[2]) {
+    size_t free_bytes = input->size - vte_input_pending(input);
+    if (!input->data || free_bytes == 0 || max == 0) {
+        return 0;
+    }
+    size_t len = free_bytes < max ? free_bytes : max;
+    return vte_input_span(input, input->tail, input->tail + len, iov);
+}
+
+void vte_input_commit(vte_input_t *input, size_t len) {
+    input->tail += len;
+}
+
+size_t vte_input_parse(vte_input_t *input, terminal_panel_t *panel) {
+    struct iovec iov[2];
+    size_t len = vte_input_pending(input);
+    int count = vte_input_span(input, input->head, input->tail, iov);
+    vte_recording_append(&panel->recording, panel, iov, count);
+    vte_parser_advance_iov(&panel->parser, panel, iov, count);
+    input->head = input->tail;
+    return len;
+}
+
+void vte_input_discard(vte_input_t *input) {
+    input->head = input->tail;
+}
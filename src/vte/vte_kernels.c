@@ -0,0 +1,503 @@
+#include "vte_kernels.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#define VTE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+#endif
+
+// Scalar implementations, also the tails of the vector ones
+
+static bool blank_cell(const terminal_cell_t *cell) {
+    return cell->codepoint == ' ' && cell->fg_color == VTE_COLOR_DEFAULT &&
+           cell->bg_color == VTE_COLOR_DEFAULT && cell->attrs == VTE_ATTR_NORMAL;
+}
+
+static bool same_cell(const terminal_cell_t *a, const terminal_cell_t *b) {
+    return a->codepoint == b->codepoint && a->fg_color == b->fg_color &&
+           a->bg_color == b->bg_color && a->attrs == b->attrs;
+}
+
+static void scalar_fill_cells(terminal_cell_t *cells, size_t count, terminal_cell_t cell) {
+    for (size_t i = 0; i < count; i++) {
+        cells[i] = cell;
+    }
+}
+
+static size_t scalar_first_diff_cells(const terminal_cell_t *a, const terminal_cell_t *b, size_t count) {
+    size_t i = 0;
+    while (i < count && same_cell(&a[i], &b[i])) {
+        i++;
+    }
+    return i;
+}
+
+static size_t scalar_find_nonblank_cells(const terminal_cell_t *cells, size_t count) {
+    size_t i = 0;
+    while (i < count && blank_cell(&cells[i])) {
+        i++;
+    }
+    return i;
+}
+
+static size_t scalar_trim_blank_cells(const terminal_cell_t *cells, size_t count) {
+    while (count > 0 && blank_cell(&cells[count - 1])) {
+        count--;
+    }
+    return count;
+}
+
+static bool scalar_ascii_only(const terminal_cell_t *cells, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (cells[i].codepoint >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void scalar_fill_u32(uint32_t *values, size_t count, uint32_t value) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = value;
+    }
+}
+
+static size_t scalar_first_diff_u32(const uint32_t *a, const uint32_t *b, size_t count) {
+    size_t i = 0;
+    while (i < count && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+static size_t scalar_find_u32(const uint32_t *values, size_t count, uint32_t value) {
+    size_t i = 0;
+    while (i < count && values[i] != value) {
+        i++;
+    }
+    return i;
+}
+
+static size_t scalar_find_string_stop(const uint8_t *bytes, size_t len) {
+    size_t i = 0;
+    while (i < len && bytes[i] >= 0x20 && bytes[i] != ';' && bytes[i] != 0x7F && bytes[i] != 0x9C) {
+        i++;
+    }
+    return i;
+}
+
+
+static const vte_kernels_t scalar_kernels = {
+    "scalar",
+    scalar_fill_cells,
+    scalar_first_diff_cells,
+    scalar_find_nonblank_cells,
+    scalar_trim_blank_cells,
+    scalar_ascii_only,
+    scalar_fill_u32,
+    scalar_first_diff_u32,
+    scalar_find_u32,
+    scalar_find_string_stop,
+};
+
+#ifdef VTE_KERNELS_X86
+
+// A cell is 16 bytes, one SSE2 register; the vector loops load cells,
+// 32-bit values and string bytes unaligned and leave the remainder to the
+// scalar code. Byte masks from _mm_movemask_epi8 locate the first mismatch.
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+static SSE2 __m128i sse2_cell(terminal_cell_t cell) {
+    return _mm_setr_epi32((int)cell.codepoint, cell.fg_color, cell.bg_color, cell.attrs);
+}
+
+static SSE2 void sse2_fill_cells(terminal_cell_t *cells, size_t count, terminal_cell_t cell) {
+    __m128i value = sse2_cell(cell);
+    for (size_t i = 0; i < count; i++) {
+        _mm_storeu_si128((__m128i *)&cells[i], value);
+    }
+}
+
+static SSE2 size_t sse2_first_diff_cells(const terminal_cell_t *a, const terminal_cell_t *b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&a[i]);
+        __m128i y = _mm_loadu_si128((const __m128i *)&b[i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) != 0xFFFF) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static SSE2 size_t sse2_find_nonblank_cells(const terminal_cell_t *cells, size_t count) {
+    __m128i blank = sse2_cell(VTE_BLANK_CELL);
+    for (size_t i = 0; i < count; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&cells[i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, blank)) != 0xFFFF) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static SSE2 size_t sse2_trim_blank_cells(const terminal_cell_t *cells, size_t count) {
+    __m128i blank = sse2_cell(VTE_BLANK_CELL);
+    while (count > 0) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&cells[count - 1]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, blank)) != 0xFFFF) {
+            break;
+        }
+        count--;
+    }
+    return count;
+}
+
+// Codepoint bits above ASCII, in the first lane of each cell; four cells
+// are ORed together before the test
+static SSE2 bool sse2_ascii_only(const terminal_cell_t *cells, size_t count) {
+    __m128i high = _mm_setr_epi32(~0x7F, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i *)&cells[i]),
+                                 _mm_loadu_si128((const __m128i *)&cells[i + 1]));
+        __m128i y = _mm_or_si128(_mm_loadu_si128((const __m128i *)&cells[i + 2]),
+                                 _mm_loadu_si128((const __m128i *)&cells[i + 3]));
+        __m128i bits = _mm_and_si128(_mm_or_si128(x, y), high);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(bits, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+    }
+    return scalar_ascii_only(cells + i, count - i);
+}
+
+static SSE2 void sse2_fill_u32(uint32_t *values, size_t count, uint32_t value) {
+    __m128i v = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *)&values[i], v);
+    }
+    scalar_fill_u32(values + i, count - i, value);
+}
+
+static SSE2 size_t sse2_first_diff_u32(const uint32_t *a, const uint32_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&a[i]);
+        __m128i y = _mm_loadu_si128((const __m128i *)&b[i]);
+        int equal = _mm_movemask_epi8(_mm_cmpeq_epi32(x, y));
+        if (equal != 0xFFFF) {
+            return i + __builtin_ctz(~equal) / 4;
+        }
+    }
+    return i + scalar_first_diff_u32(a + i, b + i, count - i);
+}
+
+static SSE2 size_t sse2_find_u32(const uint32_t *values, size_t count, uint32_t value) {
+    __m128i v = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&values[i]);
+        int found = _mm_movemask_epi8(_mm_cmpeq_epi32(x, v));
+        if (found) {
+            return i + __builtin_ctz(found) / 4;
+        }
+    }
+    return i + scalar_find_u32(values + i, count - i, value);
+}
+
+// Bytes up to 0x1F are the ones min(x, 0x1F) leaves alone; SSE2 has no
+// unsigned byte compare
+static SSE2 size_t sse2_find_string_stop(const uint8_t *bytes, size_t len) {
+    __m128i controls = _mm_set1_epi8(0x1F);
+    __m128i semicolon = _mm_set1_epi8(';');
+    __m128i del = _mm_set1_epi8(0x7F);
+    __m128i st = _mm_set1_epi8((char)0x9C);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&bytes[i]);
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(x, controls), x),
+                                    _mm_cmpeq_epi8(x, semicolon));
+        stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi8(x, del), _mm_cmpeq_epi8(x, st)));
+        int found = _mm_movemask_epi8(stop);
+        if (found) {
+            return i + __builtin_ctz(found);
+        }
+    }
+    return i + scalar_find_string_stop(bytes + i, len - i);
+}
+
+
+static const vte_kernels_t sse2_kernels = {
+    "sse2",
+    sse2_fill_cells,
+    sse2_first_diff_cells,
+    sse2_find_nonblank_cells,
+    sse2_trim_blank_cells,
+    sse2_ascii_only,
+    sse2_fill_u32,
+    sse2_first_diff_u32,
+    sse2_find_u32,
+    sse2_find_string_stop,
+};
+
+// AVX2: two cells or eight values per register, the odd cell or the
+// remainder through SSE2. Every function clears the upper halves of the
+// registers before SSE code runs again: the compiler only adds vzeroupper
+// when optimizing, and without it each later SSE instruction in the caller
+// (libc, ncurses) pays for the dirty upper state.
+
+static AVX2 __m256i avx2_cells(terminal_cell_t cell) {
+    return _mm256_setr_epi32((int)cell.codepoint, cell.fg_color, cell.bg_color, cell.attrs,
+                             (int)cell.codepoint, cell.fg_color, cell.bg_color, cell.attrs);
+}
+
+static AVX2 void avx2_fill_cells(terminal_cell_t *cells, size_t count, terminal_cell_t cell) {
+    __m256i value = avx2_cells(cell);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm256_storeu_si256((__m256i *)&cells[i], value);
+    }
+    _mm256_zeroupper();
+    sse2_fill_cells(cells + i, count - i, cell);
+}
+
+static AVX2 size_t avx2_first_diff_cells(const terminal_cell_t *a, const terminal_cell_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&a[i]);
+        __m256i y = _mm256_loadu_si256((const __m256i *)&b[i]);
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y));
+        if (equal != 0xFFFFFFFFu) {
+            _mm256_zeroupper();
+            return i + ((equal & 0xFFFF) == 0xFFFF ? 1 : 0);
+        }
+    }
+    _mm256_zeroupper();
+    return i + sse2_first_diff_cells(a + i, b + i, count - i);
+}
+
+static AVX2 size_t avx2_find_nonblank_cells(const terminal_cell_t *cells, size_t count) {
+    __m256i blank = avx2_cells(VTE_BLANK_CELL);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&cells[i]);
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, blank));
+        if (equal != 0xFFFFFFFFu) {
+            _mm256_zeroupper();
+            return i + ((equal & 0xFFFF) == 0xFFFF ? 1 : 0);
+        }
+    }
+    _mm256_zeroupper();
+    return i + sse2_find_nonblank_cells(cells + i, count - i);
+}
+
+static AVX2 size_t avx2_trim_blank_cells(const terminal_cell_t *cells, size_t count) {
+    __m256i blank = avx2_cells(VTE_BLANK_CELL);
+    while (count >= 2) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&cells[count - 2]);
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, blank));
+        if (equal != 0xFFFFFFFFu) {
+            _mm256_zeroupper();
+            return (equal >> 16) == 0xFFFF ? count - 1 : count;
+        }
+        count -= 2;
+    }
+    _mm256_zeroupper();
+    return sse2_trim_blank_cells(cells, count);
+}
+
+static AVX2 bool avx2_ascii_only(const terminal_cell_t *cells, size_t count) {
+    __m256i high = _mm256_setr_epi32(~0x7F, 0, 0, 0, ~0x7F, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)&cells[i]),
+                                    _mm256_loadu_si256((const __m256i *)&cells[i + 2]));
+        __m256i y = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)&cells[i + 4]),
+                                    _mm256_loadu_si256((const __m256i *)&cells[i + 6]));
+        if (!_mm256_testz_si256(_mm256_or_si256(x, y), high)) {
+            _mm256_zeroupper();
+            return false;
+        }
+    }
+    _mm256_zeroupper();
+    return sse2_ascii_only(cells + i, count - i);
+}
+
+static AVX2 void avx2_fill_u32(uint32_t *values, size_t count, uint32_t value) {
+    __m256i v = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i *)&values[i], v);
+    }
+    _mm256_zeroupper();
+    sse2_fill_u32(values + i, count - i, value);
+}
+
+static AVX2 size_t avx2_first_diff_u32(const uint32_t *a, const uint32_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&a[i]);
+        __m256i y = _mm256_loadu_si256((const __m256i *)&b[i]);
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y));
+        if (equal != 0xFFFFFFFFu) {
+            _mm256_zeroupper();
+            return i + __builtin_ctz(~equal) / 4;
+        }
+    }
+    _mm256_zeroupper();
+    return i + sse2_first_diff_u32(a + i, b + i, count - i);
+}
+
+static AVX2 size_t avx2_find_u32(const uint32_t *values, size_t count, uint32_t value) {
+    __m256i v = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&values[i]);
+        uint32_t found = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, v));
+        if (found) {
+            _mm256_zeroupper();
+            return i + __builtin_ctz(found) / 4;
+        }
+    }
+    _mm256_zeroupper();
+    return i + sse2_find_u32(values + i, count - i, value);
+}
+
+static AVX2 size_t avx2_find_string_stop(const uint8_t *bytes, size_t len) {
+    __m256i controls = _mm256_set1_epi8(0x1F);
+    __m256i semicolon = _mm256_set1_epi8(';');
+    __m256i del = _mm256_set1_epi8(0x7F);
+    __m256i st = _mm256_set1_epi8((char)0x9C);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(x, controls), x),
+                                       _mm256_cmpeq_epi8(x, semicolon));
+        stop = _mm256_or_si256(stop, _mm256_or_si256(_mm256_cmpeq_epi8(x, del),
+                                                     _mm256_cmpeq_epi8(x, st)));
+        uint32_t found = (uint32_t)_mm256_movemask_epi8(stop);
+        if (found) {
+            _mm256_zeroupper();
+            return i + __builtin_ctz(found);
+        }
+    }
+    _mm256_zeroupper();
+    return i + sse2_find_string_stop(bytes + i, len - i);
+}
+
+static const vte_kernels_t avx2_kernels = {
+    "avx2",
+    avx2_fill_cells,
+    avx2_first_diff_cells,
+    avx2_find_nonblank_cells,
+    avx2_trim_blank_cells,
+    avx2_ascii_only,
+    avx2_fill_u32,
+    avx2_first_diff_u32,
+    avx2_find_u32,
+    avx2_find_string_stop,
+};
+
+#endif // VTE_KERNELS_X86
+
+// Implementations this CPU supports, best last
+static const vte_kernels_t *supported[4];
+static const char *supported_names[4];
+static int supported_count = 0;
+
+static void detect_kernels(void) {
+    if (supported_count > 0) {
+        return;
+    }
+    int count = 0;
+    supported[count++] = &scalar_kernels;
+#ifdef VTE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        supported[count++] = &sse2_kernels;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        supported[count++] = &avx2_kernels;
+    }
+#endif
+    for (int i = 0; i < count; i++) {
+        supported_names[i] = supported[i]->name;
+    }
+    supported_names[count] = NULL;
+    supported_count = count;
+}
+
+// Until vte_kernels_init() calls go to the scalar set, which every CPU runs
+const vte_kernels_t *vte_kernel = &scalar_kernels;
+static bool selected = false;
+
+void vte_kernels_init(void) {
+    if (selected) {
+        return;
+    }
+    detect_kernels();
+    vte_kernel = supported[supported_count - 1];
+    selected = true;
+}
+
+bool vte_kernels_select(const char *name) {
+    detect_kernels();
+    for (int i = 0; i < supported_count; i++) {
+        if (strcmp(supported[i]->name, name) == 0) {
+            vte_kernel = supported[i];
+            selected = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *const *vte_kernels_available(void) {
+    detect_kernels();
+    return supported_names;
+}
+
+// Rows are hashed as 64-bit words, two per cell, spread over four
+// independent lanes (the xxHash64 round) so the multiplies overlap
+#define HASH_PRIME1 0x9E3779B185EBCA87ull
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define HASH_PRIME3 0x165667B19E3779F9ull
+
+static uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t hash_round(uint64_t lane, uint64_t word) {
+    return rotl64(lane + word * HASH_PRIME2, 31) * HASH_PRIME1;
+}
+
+uint64_t vte_hash_cells(const terminal_cell_t *cells, size_t count) {
+    uint64_t lanes[4] = { HASH_PRIME1 + HASH_PRIME2, HASH_PRIME2, 0, -HASH_PRIME1 };
+    uint64_t words[4];
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        memcpy(words, &cells[i], sizeof(words));
+        lanes[0] = hash_round(lanes[0], words[0]);
+        lanes[1] = hash_round(lanes[1], words[1]);
+        lanes[2] = hash_round(lanes[2], words[2]);
+        lanes[3] = hash_round(lanes[3], words[3]);
+    }
+    if (i < count) {
+        memcpy(words, &cells[i], sizeof(terminal_cell_t));
+        lanes[0] = hash_round(lanes[0], words[0]);
+        lanes[1] = hash_round(lanes[1], words[1]);
+    }
+
+    uint64_t hash = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) +
+                    rotl64(lanes[3], 18) + count;
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
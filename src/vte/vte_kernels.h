@@ -0,0 +1,62 @@
+#ifndef VTE_KERNELS_H
+#define VTE_KERNELS_H
+
+#include "vte_parser.h"
+
+// Cell kernels: the loops over cells that erase, scrollback trimming,
+// rendering and grids share, and the parser's scan through control string
+// payloads, with scalar, SSE2 and AVX2 implementations. The best one the
+// CPU supports is picked once by vte_kernels_init(), which toad's main() and
+// terminal_panel_init() call; calls go through vte_kernel, e.g.
+//
+//   vte_kernel->fill_cells(&row[x], count, VTE_BLANK_CELL);
+//
+// A blank cell is a space in the default style, what erase leaves behind.
+
+#define VTE_BLANK_CELL ((terminal_cell_t){ ' ', VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL })
+
+typedef struct {
+    const char *name;
+
+    // Set count cells to cell
+    void (*fill_cells)(terminal_cell_t *cells, size_t count, terminal_cell_t cell);
+    // Index of the first cell that differs between a and b, or count
+    size_t (*first_diff_cells)(const terminal_cell_t *a, const terminal_cell_t *b, size_t count);
+    // Index of the first cell that is not blank, or count
+    size_t (*find_nonblank_cells)(const terminal_cell_t *cells, size_t count);
+    // Length of cells without its trailing blanks
+    size_t (*trim_blank_cells)(const terminal_cell_t *cells, size_t count);
+    // True if every codepoint is ASCII (below 0x80)
+    bool (*ascii_only)(const terminal_cell_t *cells, size_t count);
+
+    // The same on planes of 32-bit values (see vte_grid.h)
+    void (*fill_u32)(uint32_t *values, size_t count, uint32_t value);
+    size_t (*first_diff_u32)(const uint32_t *a, const uint32_t *b, size_t count);
+    // Index of the first value equal to value, or count
+    size_t (*find_u32)(const uint32_t *values, size_t count, uint32_t value);
+
+    // Index of the first byte that can end or split an OSC, DCS or SOS/PM/APC
+    // string (a C0 control, ';', DEL or the 8-bit ST), or len
+    size_t (*find_string_stop)(const uint8_t *bytes, size_t len);
+} vte_kernels_t;
+
+extern const vte_kernels_t *vte_kernel;
+
+// Detect the CPU and select the best implementation. Only the first call
+// does anything, and none after vte_kernels_select(); until then vte_kernel
+// is the scalar implementation.
+void vte_kernels_init(void);
+
+// Use the named implementation ("scalar", "sse2", "avx2") from now on, for
+// tests and benchmarks. Returns false if this CPU or build lacks it.
+bool vte_kernels_select(const char *name);
+
+// Every implementation this CPU and build support, best last; NULL-terminated
+const char *const *vte_kernels_available(void);
+
+// 64-bit hash of count cells, codepoints and styles. Not dispatched: the
+// value is the same whichever implementation is selected, so hashes can be
+// kept and compared later.
+uint64_t vte_hash_cells(const terminal_cell_t *cells, size_t count);
+
+#endif // VTE_KERNELS_H
@@ -1,7 +1,7 @@
 #include "vte_parser.h"
+#include "vte_kernels.h"
 #include <string.h>
 #include <stdlib.h>
-#include <ncurses.h>
 
 // UTF-8 utilities
 bool vte_is_utf8_continuation(uint8_t byte) {
@@ -49,6 +49,34 @@ uint32_t vte_utf8_decode(const uint8_t *bytes, size_t len) {
     return 0xFFFD;
 }
 
+// Encode a codepoint as UTF-8 into out (at least 4 bytes), returns the length.
+// Invalid codepoints are written as U+FFFD.
+size_t vte_utf8_encode(uint32_t codepoint, char *out) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        codepoint = 0xFFFD;
+    }
+    if (codepoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
 // Parameter utilities
 void vte_params_init(vte_params_t *params) {
     memset(params, 0, sizeof(vte_params_t));
@@ -185,6 +213,7 @@ uint32_t map_charset_char(charset_t charset, uint8_t ch) {
 
 // Terminal initialization
 void terminal_panel_init(terminal_panel_t *panel, int width, int height) {
+    vte_kernels_init();
     panel->screen_width = width;
     panel->screen_height = height;
     panel->cursor_x = 0;
@@ -248,13 +277,12 @@ void terminal_clear_screen(terminal_panel_t *panel, int mode) {
         int col_start = (row == start_row) ? start_col : 0;
         int col_end = (row == end_row - 1) ? end_col : panel->screen_width;
         
-        for (int col = col_start; col < col_end && col < panel->screen_width; col++) {
-            if (panel->screen && panel->screen[row]) {
-                panel->screen[row][col].codepoint = ' ';
-                panel->screen[row][col].fg_color = panel->fg_color;
-                panel->screen[row][col].bg_color = panel->bg_color;
-                panel->screen[row][col].attrs = panel->attrs;
-            }
+        terminal_cell_t *cells = panel->screen && panel->screen[row] ? vte_row_writable(panel, row) : NULL;
+        for (int col = col_start; cells && col < col_end && col < panel->screen_width; col++) {
+            cells[col].codepoint = ' ';
+            cells[col].fg_color = panel->fg_color;
+            cells[col].bg_color = panel->bg_color;
+            cells[col].attrs = panel->attrs;
         }
     }
 }
@@ -262,6 +290,8 @@ void terminal_clear_screen(terminal_panel_t *panel, int mode) {
 void terminal_clear_line(terminal_panel_t *panel, int mode) {
     if (panel->cursor_y < 0 || panel->cursor_y >= panel->screen_height) return;
     if (!panel->screen || !panel->screen[panel->cursor_y]) return;
+    terminal_cell_t *cells = vte_row_writable(panel, panel->cursor_y);
+    if (!cells) return;
     
     int start_col = 0, end_col = panel->screen_width;
     
@@ -277,13 +307,40 @@ void terminal_clear_line(terminal_panel_t *panel, int mode) {
     }
     
     for (int col = start_col; col < end_col && col < panel->screen_width; col++) {
-        panel->screen[panel->cursor_y][col].codepoint = ' ';
-        panel->screen[panel->cursor_y][col].fg_color = panel->fg_color;
-        panel->screen[panel->cursor_y][col].bg_color = panel->bg_color;
-        panel->screen[panel->cursor_y][col].attrs = panel->attrs;
+        cells[col].codepoint = ' ';
+        cells[col].fg_color = panel->fg_color;
+        cells[col].bg_color = panel->bg_color;
+        cells[col].attrs = panel->attrs;
     }
 }
 
+// Blank row y in the current colors, as lines scrolled in are
+static void blank_line(terminal_panel_t *panel, int y) {
+    terminal_cell_t *cells = panel->screen[y] ? vte_row_writable(panel, y) : NULL;
+    if (cells) {
+        terminal_cell_t blank = { ' ', panel->fg_color, panel->bg_color, panel->attrs };
+        vte_kernel->fill_cells(cells, panel->screen_width, blank);
+    }
+}
+
+// Move rows top..bottom up one line and blank the row that comes in at the
+// bottom. Rows move by pointer, so rows a snapshot shares stay shared.
+static void rotate_lines_up(terminal_panel_t *panel, int top, int bottom) {
+    terminal_cell_t *row = panel->screen[top];
+    memmove(&panel->screen[top], &panel->screen[top + 1], (bottom - top) * sizeof(terminal_cell_t *));
+    panel->screen[bottom] = row;
+    blank_line(panel, bottom);
+}
+
+// Move rows top..bottom down one line and blank the row that comes in at
+// the top
+static void rotate_lines_down(terminal_panel_t *panel, int top, int bottom) {
+    terminal_cell_t *row = panel->screen[bottom];
+    memmove(&panel->screen[top + 1], &panel->screen[top], (bottom - top) * sizeof(terminal_cell_t *));
+    panel->screen[top] = row;
+    blank_line(panel, top);
+}
+
 void terminal_scroll_up(terminal_panel_t *panel, int lines) {
     if (lines <= 0 || !panel->screen) return;
     
@@ -292,25 +349,12 @@ void terminal_scroll_up(terminal_panel_t *panel, int lines) {
     
     if (top >= bottom || top < 0 || bottom >= panel->screen_height) return;
     
-    // Move lines up (scroll content up)
     for (int i = 0; i < lines; i++) {
-        // Move each line up by one
-        for (int row = top; row < bottom; row++) {
-            if (row + 1 <= bottom && panel->screen[row] && panel->screen[row + 1]) {
-                memcpy(panel->screen[row], panel->screen[row + 1], 
-                       panel->screen_width * sizeof(terminal_cell_t));
-            }
-        }
-        
-        // Clear the bottom line
-        if (panel->screen[bottom]) {
-            for (int col = 0; col < panel->screen_width; col++) {
-                panel->screen[bottom][col].codepoint = ' ';
-                panel->screen[bottom][col].fg_color = panel->fg_color;
-                panel->screen[bottom][col].bg_color = panel->bg_color;
-                panel->screen[bottom][col].attrs = panel->attrs;
-            }
+        // Lines leaving the top of the screen go to the scrollback
+        if (top == 0 && panel->screen[0]) {
+            vte_scrollback_push(&panel->scrollback, panel->screen[0], panel->screen_width);
         }
+        rotate_lines_up(panel, top, bottom);
     }
 }
 
@@ -322,25 +366,8 @@ void terminal_scroll_down(terminal_panel_t *panel, int lines) {
     
     if (top >= bottom || top < 0 || bottom >= panel->screen_height) return;
     
-    // Move lines down (scroll content down)
     for (int i = 0; i < lines; i++) {
-        // Move each line down by one (start from bottom)
-        for (int row = bottom; row > top; row--) {
-            if (row - 1 >= top && panel->screen[row] && panel->screen[row - 1]) {
-                memcpy(panel->screen[row], panel->screen[row - 1], 
-                       panel->screen_width * sizeof(terminal_cell_t));
-            }
-        }
-        
-        // Clear the top line
-        if (panel->screen[top]) {
-            for (int col = 0; col < panel->screen_width; col++) {
-                panel->screen[top][col].codepoint = ' ';
-                panel->screen[top][col].fg_color = panel->fg_color;
-                panel->screen[top][col].bg_color = panel->bg_color;
-                panel->screen[top][col].attrs = panel->attrs;
-            }
-        }
+        rotate_lines_down(panel, top, bottom);
     }
 }
 
@@ -354,25 +381,9 @@ void terminal_insert_lines(terminal_panel_t *panel, int count) {
     // Insert lines only works within the scrolling region
     if (current_row < top || current_row > bottom) return;
     
-    // Move existing lines down
+    // Lines from the cursor down move down, blank ones come in at the cursor
     for (int i = 0; i < count; i++) {
-        // Move lines down from bottom to current position
-        for (int row = bottom; row > current_row; row--) {
-            if (panel->screen[row] && panel->screen[row - 1]) {
-                memcpy(panel->screen[row], panel->screen[row - 1], 
-                       panel->screen_width * sizeof(terminal_cell_t));
-            }
-        }
-        
-        // Clear the inserted line
-        if (panel->screen[current_row]) {
-            for (int col = 0; col < panel->screen_width; col++) {
-                panel->screen[current_row][col].codepoint = ' ';
-                panel->screen[current_row][col].fg_color = panel->fg_color;
-                panel->screen[current_row][col].bg_color = panel->bg_color;
-                panel->screen[current_row][col].attrs = panel->attrs;
-            }
-        }
+        rotate_lines_down(panel, current_row, bottom);
     }
 }
 
@@ -386,25 +397,9 @@ void terminal_delete_lines(terminal_panel_t *panel, int count) {
     // Delete lines only works within the scrolling region
     if (current_row < top || current_row > bottom) return;
     
-    // Move lines up to delete current lines
+    // Lines below the cursor move up, blank ones come in at the bottom
     for (int i = 0; i < count; i++) {
-        // Move lines up from current position to bottom
-        for (int row = current_row; row < bottom; row++) {
-            if (panel->screen[row] && panel->screen[row + 1]) {
-                memcpy(panel->screen[row], panel->screen[row + 1], 
-                       panel->screen_width * sizeof(terminal_cell_t));
-            }
-        }
-        
-        // Clear the bottom line
-        if (panel->screen[bottom]) {
-            for (int col = 0; col < panel->screen_width; col++) {
-                panel->screen[bottom][col].codepoint = ' ';
-                panel->screen[bottom][col].fg_color = panel->fg_color;
-                panel->screen[bottom][col].bg_color = panel->bg_color;
-                panel->screen[bottom][col].attrs = panel->attrs;
-            }
-        }
+        rotate_lines_up(panel, current_row, bottom);
     }
 }
 
@@ -412,22 +407,23 @@ void terminal_insert_chars(terminal_panel_t *panel, int count) {
     if (count <= 0 || panel->cursor_y < 0 || panel->cursor_y >= panel->screen_height) return;
     if (!panel->screen || !panel->screen[panel->cursor_y]) return;
     
-    int row = panel->cursor_y;
+    terminal_cell_t *cells = vte_row_writable(panel, panel->cursor_y);
+    if (!cells) return;
     int start_col = panel->cursor_x;
     
     // Shift characters to the right
     for (int col = panel->screen_width - 1; col >= start_col + count; col--) {
         if (col - count >= start_col) {
-            panel->screen[row][col] = panel->screen[row][col - count];
+            cells[col] = cells[col - count];
         }
     }
     
     // Clear the inserted positions
     for (int col = start_col; col < start_col + count && col < panel->screen_width; col++) {
-        panel->screen[row][col].codepoint = ' ';
-        panel->screen[row][col].fg_color = panel->fg_color;
-        panel->screen[row][col].bg_color = panel->bg_color;
-        panel->screen[row][col].attrs = panel->attrs;
+        cells[col].codepoint = ' ';
+        cells[col].fg_color = panel->fg_color;
+        cells[col].bg_color = panel->bg_color;
+        cells[col].attrs = panel->attrs;
     }
 }
 
@@ -435,23 +431,24 @@ void terminal_delete_chars(terminal_panel_t *panel, int count) {
     if (count <= 0 || panel->cursor_y < 0 || panel->cursor_y >= panel->screen_height) return;
     if (!panel->screen || !panel->screen[panel->cursor_y]) return;
     
-    int row = panel->cursor_y;
+    terminal_cell_t *cells = vte_row_writable(panel, panel->cursor_y);
+    if (!cells) return;
     int start_col = panel->cursor_x;
     
     // Shift characters to the left
     for (int col = start_col; col < panel->screen_width - count; col++) {
         if (col + count < panel->screen_width) {
-            panel->screen[row][col] = panel->screen[row][col + count];
+            cells[col] = cells[col + count];
         }
     }
     
     // Clear the end positions
     for (int col = panel->screen_width - count; col < panel->screen_width; col++) {
         if (col >= 0) {
-            panel->screen[row][col].codepoint = ' ';
-            panel->screen[row][col].fg_color = panel->fg_color;
-            panel->screen[row][col].bg_color = panel->bg_color;
-            panel->screen[row][col].attrs = panel->attrs;
+            cells[col].codepoint = ' ';
+            cells[col].fg_color = panel->fg_color;
+            cells[col].bg_color = panel->bg_color;
+            cells[col].attrs = panel->attrs;
         }
     }
 }
@@ -680,11 +677,42 @@ static void vte_anywhere(vte_parser_t *parser, terminal_panel_t *panel, uint8_t
     }
 }
 
+// Finish a UTF-8 sequence cut off at the end of the previous input. Returns
+// the bytes of this input it took; a byte that cannot continue it ends it as
+// a replacement character and is left for the caller.
+static size_t vte_finish_partial_utf8(vte_parser_t *parser, terminal_panel_t *panel,
+                                      const uint8_t *bytes, size_t len) {
+    size_t need = vte_utf8_char_len(parser->partial_utf8[0]);
+    size_t i = 0;
+    while (parser->partial_utf8_len < need && i < len) {
+        if (!vte_is_utf8_continuation(bytes[i])) {
+            parser->partial_utf8_len = 0;
+            if (panel->perform.print) {
+                panel->perform.print(panel, 0xFFFD);
+            }
+            return i;
+        }
+        parser->partial_utf8[parser->partial_utf8_len++] = bytes[i++];
+    }
+    if (parser->partial_utf8_len == need) {
+        uint32_t codepoint = vte_utf8_decode(parser->partial_utf8, need);
+        parser->partial_utf8_len = 0;
+        if (panel->perform.print) {
+            panel->perform.print(panel, codepoint);
+        }
+    }
+    return i;
+}
+
 // State machine implementation
 static void vte_advance_ground(vte_parser_t *parser, terminal_panel_t *panel, 
                               const uint8_t *bytes, size_t len, size_t *processed) {
     size_t i = 0;
     
+    if (parser->partial_utf8_len > 0) {
+        i = vte_finish_partial_utf8(parser, panel, bytes, len);
+    }
+    
     while (i < len) {
         uint8_t byte = bytes[i];
         
@@ -698,6 +726,20 @@ static void vte_advance_ground(vte_parser_t *parser, terminal_panel_t *panel,
         // Handle UTF-8 sequences
         if (byte >= 0x80) {
             size_t char_len = vte_utf8_char_len(byte);
+            if (char_len > 1 && i + char_len > len) {
+                // Cut off by the end of the input: the rest comes with the
+                // next call, unless what is here already cannot continue it
+                size_t have = 1;
+                while (i + have < len && vte_is_utf8_continuation(bytes[i + have])) {
+                    have++;
+                }
+                if (i + have == len) {
+                    memcpy(parser->partial_utf8, &bytes[i], have);
+                    parser->partial_utf8_len = have;
+                    *processed = len;
+                    return;
+                }
+            }
             if (char_len == 0 || i + char_len > len) {
                 // Invalid or incomplete UTF-8
                 if (panel->perform.print) {
@@ -1136,6 +1178,37 @@ static void vte_advance_osc_string(vte_parser_t *parser, terminal_panel_t *panel
     }
 }
 
+// Payload of an OSC, DCS or SOS/PM/APC string (base64 clipboard contents,
+// images) in one go, up to the next byte the state switch has to see: one
+// that can end the string, or a ';' between OSC parameters. The bytes in
+// between are all stored, passed through or ignored alike. Returns how many
+// were taken, 0 if the first is such a byte.
+static size_t vte_advance_string_span(vte_parser_t *parser, terminal_panel_t *panel,
+                                      const uint8_t *bytes, size_t len) {
+    size_t span = vte_kernel->find_string_stop(bytes, len);
+    switch (parser->state) {
+        case VTE_STATE_OSC_STRING: {
+            // What does not fit is dropped, as by vte_action_osc_put()
+            size_t room = VTE_MAX_OSC_RAW - parser->osc_raw_len;
+            size_t stored = span < room ? span : room;
+            memcpy(&parser->osc_raw[parser->osc_raw_len], bytes, stored);
+            parser->osc_raw_len += stored;
+            break;
+        }
+        case VTE_STATE_DCS_PASSTHROUGH:
+            if (panel->perform.put) {
+                for (size_t i = 0; i < span; i++) {
+                    panel->perform.put(panel, bytes[i]);
+                }
+            }
+            break;
+        default:
+            // DCS ignore and SOS/PM/APC strings
+            break;
+    }
+    return span;
+}
+
 // Main parser advance function
 void vte_parser_advance(vte_parser_t *parser, terminal_panel_t *panel, 
                        const uint8_t *data, size_t len) {
@@ -1147,6 +1220,13 @@ void vte_parser_advance(vte_parser_t *parser, terminal_panel_t *panel,
             vte_advance_ground(parser, panel, &data[i], len - i, &processed);
             i += processed;
         } else {
+            if (parser->state == VTE_STATE_OSC_STRING || parser->state == VTE_STATE_DCS_PASSTHROUGH ||
+                parser->state == VTE_STATE_DCS_IGNORE || parser->state == VTE_STATE_SOS_PM_APC_STRING) {
+                i += vte_advance_string_span(parser, panel, &data[i], len - i);
+                if (i == len) {
+                    break;
+                }
+            }
             uint8_t byte = data[i];
             
             switch (parser->state) {
@@ -1198,6 +1278,16 @@ void vte_parser_advance(vte_parser_t *parser, terminal_panel_t *panel,
     }
 }
 
+// Segments are not joined: text in each still goes through the ground loop
+// in one run, and whatever a segment ends in the middle of is carried in
+// the parser state, partial UTF-8 included, into the next one
+void vte_parser_advance_iov(vte_parser_t *parser, terminal_panel_t *panel,
+                            const struct iovec *iov, int count) {
+    for (int i = 0; i < count; i++) {
+        vte_parser_advance(parser, panel, iov[i].iov_base, iov[i].iov_len);
+    }
+}
+
 // Default perform implementation stubs
 static void default_print(terminal_panel_t *panel, uint32_t codepoint) {
     // Default implementation - could be overridden
@@ -1344,11 +1434,12 @@ void enhanced_csi_dispatch(terminal_panel_t *panel, const vte_params_t *params,
             int count = vte_params_get_single(params, 0, 1);
             if (panel->cursor_y >= 0 && panel->cursor_y < panel->screen_height &&
                 panel->screen && panel->screen[panel->cursor_y]) {
-                for (int i = 0; i < count && panel->cursor_x + i < panel->screen_width; i++) {
-                    panel->screen[panel->cursor_y][panel->cursor_x + i].codepoint = ' ';
-                    panel->screen[panel->cursor_y][panel->cursor_x + i].fg_color = panel->fg_color;
-                    panel->screen[panel->cursor_y][panel->cursor_x + i].bg_color = panel->bg_color;
-                    panel->screen[panel->cursor_y][panel->cursor_x + i].attrs = panel->attrs;
+                terminal_cell_t *cells = vte_row_writable(panel, panel->cursor_y);
+                for (int i = 0; cells && i < count && panel->cursor_x + i < panel->screen_width; i++) {
+                    cells[panel->cursor_x + i].codepoint = ' ';
+                    cells[panel->cursor_x + i].fg_color = panel->fg_color;
+                    cells[panel->cursor_x + i].bg_color = panel->bg_color;
+                    cells[panel->cursor_x + i].attrs = panel->attrs;
                 }
             }
             break;
@@ -1443,21 +1534,21 @@ void enhanced_csi_dispatch(terminal_panel_t *panel, const vte_params_t *params,
                         panel->bg_color = -1;
                         panel->attrs = 0;
                         break;
-                    case 1: panel->attrs |= 1; break;  // Bold
-                    case 2: panel->attrs |= 8; break;  // Dim
-                    case 3: panel->attrs |= 16; break; // Italic
-                    case 4: panel->attrs |= 2; break;  // Underline
-                    case 5: panel->attrs |= 32; break; // Blink
-                    case 7: panel->attrs |= 4; break;  // Reverse
-                    case 8: panel->attrs |= 64; break; // Hidden
-                    case 9: panel->attrs |= 128; break; // Strikethrough
-                    case 22: panel->attrs &= ~(1|8); break; // No bold/dim
-                    case 23: panel->attrs &= ~16; break; // No italic
-                    case 24: panel->attrs &= ~2; break;  // No underline
-                    case 25: panel->attrs &= ~32; break; // No blink
-                    case 27: panel->attrs &= ~4; break;  // No reverse
-                    case 28: panel->attrs &= ~64; break; // No hidden
-                    case 29: panel->attrs &= ~128; break; // No strikethrough
+                    case 1: panel->attrs |= VTE_ATTR_BOLD; break;
+                    case 2: panel->attrs |= VTE_ATTR_DIM; break;
+                    case 3: panel->attrs |= VTE_ATTR_ITALIC; break;
+                    case 4: panel->attrs |= VTE_ATTR_UNDERLINE; break;
+                    case 5: panel->attrs |= VTE_ATTR_BLINK; break;
+                    case 7: panel->attrs |= VTE_ATTR_REVERSE; break;
+                    case 8: panel->attrs |= VTE_ATTR_HIDDEN; break;
+                    case 9: panel->attrs |= VTE_ATTR_STRIKE; break;
+                    case 22: panel->attrs &= ~(VTE_ATTR_BOLD | VTE_ATTR_DIM); break;
+                    case 23: panel->attrs &= ~VTE_ATTR_ITALIC; break;
+                    case 24: panel->attrs &= ~VTE_ATTR_UNDERLINE; break;
+                    case 25: panel->attrs &= ~VTE_ATTR_BLINK; break;
+                    case 27: panel->attrs &= ~VTE_ATTR_REVERSE; break;
+                    case 28: panel->attrs &= ~VTE_ATTR_HIDDEN; break;
+                    case 29: panel->attrs &= ~VTE_ATTR_STRIKE; break;
                     case 30: case 31: case 32: case 33:
                     case 34: case 35: case 36: case 37:
                         panel->fg_color = param - 30;
@@ -1512,7 +1603,7 @@ void enhanced_csi_dispatch(terminal_panel_t *panel, const vte_params_t *params,
                     case 90: case 91: case 92: case 93:
                     case 94: case 95: case 96: case 97:
                         panel->fg_color = param - 90;
-                        panel->attrs |= 1; // Bright colors are bold
+                        panel->attrs |= VTE_ATTR_BOLD; // Bright colors are bold
                         break;
                     case 100: case 101: case 102: case 103:
                     case 104: case 105: case 106: case 107:
@@ -1648,11 +1739,14 @@ void enhanced_print(terminal_panel_t *panel, uint32_t codepoint) {
             terminal_insert_chars(panel, 1);
         }
         
-        terminal_cell_t *cell = &panel->screen[panel->cursor_y][panel->cursor_x];
-        cell->codepoint = codepoint;
-        cell->fg_color = panel->fg_color;
-        cell->bg_color = panel->bg_color;
-        cell->attrs = panel->attrs;
+        terminal_cell_t *row = vte_row_writable(panel, panel->cursor_y);
+        if (row) {
+            terminal_cell_t *cell = &row[panel->cursor_x];
+            cell->codepoint = codepoint;
+            cell->fg_color = panel->fg_color;
+            cell->bg_color = panel->bg_color;
+            cell->attrs = panel->attrs;
+        }
         
         panel->cursor_x++;
         
@@ -1744,17 +1838,17 @@ void enhanced_execute(terminal_panel_t *panel, uint8_t byte) {
 }
 
 // Color mapping
-int ansi_to_ncurses_color(int ansi_color) {
+int vte_ansi_color(int ansi_color) {
     switch (ansi_color) {
-        case 0: return COLOR_BLACK;
-        case 1: return COLOR_RED;
-        case 2: return COLOR_GREEN;
-        case 3: return COLOR_YELLOW;
-        case 4: return COLOR_BLUE;
-        case 5: return COLOR_MAGENTA;
-        case 6: return COLOR_CYAN;
-        case 7: return COLOR_WHITE;
-        default: return -1;
+        case 0: return VTE_COLOR_BLACK;
+        case 1: return VTE_COLOR_RED;
+        case 2: return VTE_COLOR_GREEN;
+        case 3: return VTE_COLOR_YELLOW;
+        case 4: return VTE_COLOR_BLUE;
+        case 5: return VTE_COLOR_MAGENTA;
+        case 6: return VTE_COLOR_CYAN;
+        case 7: return VTE_COLOR_WHITE;
+        default: return VTE_COLOR_DEFAULT;
     }
 }
 
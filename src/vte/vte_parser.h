@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
 #define VTE_MAX_PARAMS 32
 #define VTE_MAX_INTERMEDIATES 2
@@ -100,6 +101,30 @@ typedef struct {
     void (*unhook)(terminal_panel_t *panel);
 } vte_perform_t;
 
+// Cell attributes (terminal_cell_t.attrs). The library has no ncurses
+// dependency; front ends translate these to their own attribute types.
+#define VTE_ATTR_NORMAL    0
+#define VTE_ATTR_BOLD      (1 << 0)
+#define VTE_ATTR_UNDERLINE (1 << 1)
+#define VTE_ATTR_REVERSE   (1 << 2)
+#define VTE_ATTR_DIM       (1 << 3)
+#define VTE_ATTR_ITALIC    (1 << 4)
+#define VTE_ATTR_BLINK     (1 << 5)
+#define VTE_ATTR_HIDDEN    (1 << 6)
+#define VTE_ATTR_STRIKE    (1 << 7)
+
+// Cell colors (terminal_cell_t.fg_color/bg_color): the eight ANSI colors in
+// SGR order, 8-255 from the 256-color palette, or the terminal default
+#define VTE_COLOR_DEFAULT (-1)
+#define VTE_COLOR_BLACK   0
+#define VTE_COLOR_RED     1
+#define VTE_COLOR_GREEN   2
+#define VTE_COLOR_YELLOW  3
+#define VTE_COLOR_BLUE    4
+#define VTE_COLOR_MAGENTA 5
+#define VTE_COLOR_CYAN    6
+#define VTE_COLOR_WHITE   7
+
 // Terminal cell structure
 typedef struct {
     uint32_t codepoint;
@@ -108,6 +133,85 @@ typedef struct {
     int attrs;
 } terminal_cell_t;
 
+// Scrollback history: a ring of the lines that scrolled off the top of the
+// screen, oldest first. Lines are stored with trailing default-styled blanks
+// trimmed, so short lines cost little whatever the panel width. Identical
+// lines (blank lines, separators, a warning repeated a thousand times) are
+// stored once: the ring holds ids of distinct lines, which are found by their
+// vte_hash_cells() and freed when the last slot holding them is reused. A
+// capacity of 0 disables the history.
+//
+// Most history is plain ASCII in a style or two, so a distinct line that is
+// ASCII in at most VTE_SCROLLBACK_RUNS style runs is stored compact, as the
+// runs followed by one byte per cell, the way VTE_GRID_ADAPTIVE rows are.
+// Other lines keep their terminal_cell_t cells.
+#define VTE_SCROLLBACK_RUNS 4
+
+typedef struct {
+    void *data;          // The cells, or the runs and bytes of a compact line
+    int len;             // Cells in use
+    int allocated;       // Bytes allocated, reused by the next line stored here
+    bool compact;
+    uint8_t run_count;   // Compact: style runs, the first starting at 0
+    uint32_t refs;       // Ring slots holding the line, 0 while free
+    uint32_t next;       // Next line in its hash bucket, or in the free list
+    uint64_t hash;
+} vte_scrollback_line_t;
+
+typedef struct {
+    vte_scrollback_line_t *lines;  // Distinct lines, grown on demand
+    size_t lines_allocated;
+    size_t lines_used;             // Entries of lines handed out so far
+    uint32_t free_line;            // First freed entry, reused before new ones
+    uint32_t *buckets;             // Hash table heads, a power of two of them
+    size_t bucket_count;
+    uint32_t *ids;    // Ring of line ids, NULL while packed
+    size_t capacity;  // Maximum number of lines kept
+    size_t start;     // Ring index of the oldest line
+    size_t count;
+    size_t unique;            // Distinct lines in use
+    size_t bytes_stored;      // Bytes of the distinct lines as stored
+    size_t cells_referenced;  // Cells of every line in the ring
+    uint8_t *packed;  // Lines oldest first in packed form, see vte_pack_rows()
+    size_t packed_size;
+} vte_scrollback_t;
+
+// Input ring: program output waiting to be parsed. Reads fill its free space
+// in place (vte_input_space() hands it out as iovecs for readv()) and the
+// parser consumes it in place on both sides of the wrap point, so bytes are
+// not copied between the read and the screen. head and tail count bytes
+// parsed and stored since the ring was created.
+typedef struct {
+    uint8_t *data;
+    size_t size;  // Capacity, a power of two
+    size_t head;
+    size_t tail;
+} vte_input_t;
+
+// Recording of the output a panel parsed, for rewinding its screen: the last
+// size bytes, where each vte_input_parse() call ended (a frame, a screen the
+// user may have seen) and every interval bytes a keyframe, a snapshot of the
+// screen with the rest of the panel's state. Seeking to a frame restores the
+// nearest keyframe before it and parses the bytes in between again, so it
+// costs at most interval bytes of parsing. Positions count bytes recorded,
+// frames are numbered from the first one recorded. All zero is disabled.
+typedef struct vte_keyframe vte_keyframe_t;
+
+typedef struct {
+    uint8_t *data;      // Ring of recorded bytes
+    size_t size;        // Its capacity, a power of two
+    uint64_t end;       // Bytes recorded
+    size_t interval;    // Recorded bytes between keyframes
+    vte_keyframe_t *keyframes;  // Ring, oldest first
+    size_t keyframe_capacity;
+    size_t keyframe_start;
+    size_t keyframe_count;
+    uint64_t *frames;   // Position where each frame ends, by frame number
+    size_t frame_capacity;  // modulo this
+    uint64_t frame_end;     // Frames recorded; the last frame_count are kept
+    size_t frame_count;
+} vte_recording_t;
+
 // Terminal modes
 typedef struct {
     bool application_cursor_keys;
@@ -170,12 +274,44 @@ struct terminal_panel {
     
     // Tab stops
     bool tab_stops[256];  // Tab stop positions
+    
+    // Lines scrolled off the top of the screen
+    vte_scrollback_t scrollback;
+    
+    // Set by terminal_perform whenever screen cells change, so a front end
+    // can tell cell damage from cursor-only movement; the front end clears it
+    bool cells_damaged;
+    
+    // Set once a snapshot has shared the screen rows; from then on writes
+    // check whether a row is shared first (see vte_snapshot_take())
+    bool rows_shared;
+    
+    // Answers to queries (DSR, DA) are sent to the program through this;
+    // queries go unanswered when it is NULL
+    void (*reply)(terminal_panel_t *panel, const char *data, size_t len);
+    
+    // Screen rows in packed form while a front end has set the panel aside
+    // (screen is NULL then); see vte_pack_rows()
+    uint8_t *packed_screen;
+    size_t packed_screen_size;
+    
+    // Output read from the program and not parsed yet, for front ends that
+    // read into it directly; see vte_input_t
+    vte_input_t input;
+    
+    // What vte_input_parse() parsed lately, for rewinding; see
+    // vte_recording_t
+    vte_recording_t recording;
 };
 
 // Function declarations
 void vte_parser_init(vte_parser_t *parser);
 void vte_parser_advance(vte_parser_t *parser, terminal_panel_t *panel, 
                        const uint8_t *data, size_t len);
+// Parse count segments as if they were one buffer: sequences and UTF-8
+// characters may be split anywhere between them
+void vte_parser_advance_iov(vte_parser_t *parser, terminal_panel_t *panel,
+                            const struct iovec *iov, int count);
 size_t vte_parser_advance_until_terminated(vte_parser_t *parser, terminal_panel_t *panel,
                                           const uint8_t *data, size_t len);
 
@@ -193,6 +329,7 @@ uint16_t vte_params_get_single(const vte_params_t *params, size_t index, uint16_
 bool vte_is_utf8_continuation(uint8_t byte);
 size_t vte_utf8_char_len(uint8_t first_byte);
 uint32_t vte_utf8_decode(const uint8_t *bytes, size_t len);
+size_t vte_utf8_encode(uint32_t codepoint, char *out);
 
 // Default perform implementation
 extern const vte_perform_t vte_default_perform;
@@ -215,8 +352,8 @@ extern const vte_perform_t terminal_perform;
 // Compatibility function for existing code
 void vte_parser_feed(terminal_panel_t *panel, const char *data, size_t len);
 
-// Color mapping
-int ansi_to_ncurses_color(int ansi_color);
+// Color mapping (ANSI color index to VTE_COLOR_*)
+int vte_ansi_color(int ansi_color);
 
 // Character set mapping
 uint32_t map_charset_char(charset_t charset, uint8_t ch);
@@ -240,6 +377,100 @@ void terminal_save_cursor(terminal_panel_t *panel);
 void terminal_restore_cursor(terminal_panel_t *panel);
 void terminal_set_cursor_visible(terminal_panel_t *panel, bool visible);
 
+// Scrollback history (vte_scrollback.c)
+bool vte_scrollback_init(vte_scrollback_t *scrollback, size_t capacity);
+void vte_scrollback_free(vte_scrollback_t *scrollback);
+void vte_scrollback_clear(vte_scrollback_t *scrollback);
+void vte_scrollback_push(vte_scrollback_t *scrollback, const terminal_cell_t *row, int width);
+size_t vte_scrollback_count(const vte_scrollback_t *scrollback);
+// Bytes of cells the history would hold without sharing identical lines,
+// and what it holds; both 0 while packed
+void vte_scrollback_memory(const vte_scrollback_t *scrollback, size_t *referenced, size_t *stored);
+// Copy the cells of line index (0 is the oldest), at most max of them, to
+// cells. Returns the number of cells in the line, which may be more than
+// max; 0 for an empty line, an index past the end or a packed history.
+int vte_scrollback_line(const vte_scrollback_t *scrollback, size_t index, terminal_cell_t *cells, int max);
+bool vte_scrollback_pop(vte_scrollback_t *scrollback, terminal_cell_t *row, int width);
+// Pack the history into a single compact buffer, freeing the line storage,
+// and back. Pushing or popping unpacks it again; vte_scrollback_line() sees
+// no lines while it is packed. Both return false if out of memory, leaving
+// the history as it was.
+bool vte_scrollback_pack(vte_scrollback_t *scrollback);
+bool vte_scrollback_unpack(vte_scrollback_t *scrollback);
+bool vte_scrollback_is_packed(const vte_scrollback_t *scrollback);
+
+// Counted rows and snapshots (vte_snapshot.c). The screen rows of toad's
+// panels and of vte_screen_t come from vte_row_new() and carry a reference
+// count. A snapshot copies the row pointers and takes a reference to each,
+// so taking one costs O(rows); the engine gets each row it writes through
+// vte_row_writable(), which gives the panel its own copy of a row a
+// snapshot still shares. Rows nobody writes stay shared.
+typedef struct {
+    terminal_cell_t **rows;  // Counted rows, not to be written
+    int width, height;
+    int cursor_x, cursor_y;
+} vte_snapshot_t;
+
+// A row of width cells, not initialized, with one reference; NULL if out of
+// memory
+terminal_cell_t *vte_row_new(int width);
+// Drop a reference, freeing the row with the last; NULL is ignored
+void vte_row_unref(terminal_cell_t *row);
+// Row y of the panel's screen for writing, copied first if a snapshot shares
+// it; NULL if out of memory
+terminal_cell_t *vte_row_writable(terminal_panel_t *panel, int y);
+// Share the screen and cursor of a panel whose rows come from vte_row_new();
+// false if the screen is packed or out of memory
+bool vte_snapshot_take(vte_snapshot_t *snapshot, terminal_panel_t *panel);
+// Screen rows for a panel that start out as the snapshot's, for the panel's
+// screen with rows_shared set; NULL if out of memory
+terminal_cell_t **vte_snapshot_share(const vte_snapshot_t *snapshot);
+void vte_snapshot_free(vte_snapshot_t *snapshot);
+
+// Compact byte form of count rows of width cells, trailing blanks dropped,
+// for screens kept but not in use: about a byte per cell for plain text.
+// Returns a malloc'd buffer and its size, or NULL if out of memory.
+uint8_t *vte_pack_rows(terminal_cell_t *const *rows, int count, int width, size_t *size);
+// Fill count rows of width cells from vte_pack_rows() output
+bool vte_unpack_rows(const uint8_t *data, size_t size, terminal_cell_t **rows, int count, int width);
+
+// Input ring (vte_input.c). The size is rounded up to a power of two.
+bool vte_input_init(vte_input_t *input, size_t size);
+void vte_input_free(vte_input_t *input);
+size_t vte_input_pending(const vte_input_t *input);
+// Up to max bytes of free space in ring order, as at most two iovecs;
+// returns how many, 0 when the ring is full
+int vte_input_space(vte_input_t *input, size_t max, struct iovec iov[2]);
+// A read stored len bytes at the start of that space
+void vte_input_commit(vte_input_t *input, size_t len);
+// Stored bytes [start, end) by position, as at most two iovecs
+int vte_input_span(const vte_input_t *input, size_t start, size_t end, struct iovec iov[2]);
+// Parse everything pending into the panel; returns the byte count
+size_t vte_input_parse(vte_input_t *input, terminal_panel_t *panel);
+// Drop everything pending unparsed
+void vte_input_discard(vte_input_t *input);
+
+// Rewind recording (vte_rewind.c). Once a panel's recording is set up,
+// vte_input_parse() records what it parses; a seek builds the screen of a
+// recorded frame in a view panel of its own, which the recording does not
+// touch again. A view starts out zeroed, is reused by later seeks and freed
+// with vte_recording_view_free().
+bool vte_recording_init(vte_recording_t *recording, size_t size, size_t interval);
+void vte_recording_free(vte_recording_t *recording);
+// Forget what was recorded, e.g. when the screen is resized and the output
+// so far no longer fits it; frame numbers go on from where they were
+void vte_recording_clear(vte_recording_t *recording);
+// Record count segments the panel is about to parse, as one frame
+void vte_recording_append(vte_recording_t *recording, terminal_panel_t *panel,
+                          const struct iovec *iov, int count);
+// Frames that can be sought are [vte_recording_first_frame(), frame_end);
+// the last one is the screen as it is now
+uint64_t vte_recording_first_frame(const vte_recording_t *recording);
+// Screen, cursor and modes after frame in view; false if the frame is no
+// longer recorded or out of memory
+bool vte_recording_seek(const vte_recording_t *recording, uint64_t frame, terminal_panel_t *view);
+void vte_recording_view_free(terminal_panel_t *view);
+
 // Tab operations
 void terminal_set_tab_stop(terminal_panel_t *panel);
 void terminal_clear_tab_stop(terminal_panel_t *panel, int mode);
@@ -0,0 +1,220 @@
+#include "vte_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Recording for rewinding. The byte ring works like the input ring: end
+// counts bytes recorded and its offset modulo size indexes the buffer. A
+// keyframe is only kept while the bytes after it are, so every kept frame
+// has a keyframe at or before it and the bytes to replay from there.
+
+// Frames kept, however small the parses were
+#define FRAME_CAPACITY 4096
+
+struct vte_keyframe {
+    uint64_t position;         // Bytes recorded before it
+    vte_snapshot_t snapshot;   // The screen rows
+    terminal_panel_t state;    // The rest: cursor, modes, parser, ...
+};
+
+bool vte_recording_init(vte_recording_t *recording, size_t size, size_t interval) {
+    memset(recording, 0, sizeof(*recording));
+    size_t capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    if (interval == 0 || interval > capacity) {
+        interval = capacity;
+    }
+    recording->size = capacity;
+    recording->interval = interval;
+    recording->keyframe_capacity = capacity / interval + 2;
+    recording->frame_capacity = FRAME_CAPACITY;
+    recording->data = malloc(capacity);
+    recording->keyframes = calloc(recording->keyframe_capacity, sizeof(vte_keyframe_t));
+    recording->frames = malloc(FRAME_CAPACITY * sizeof(uint64_t));
+    if (!recording->data || !recording->keyframes || !recording->frames) {
+        vte_recording_free(recording);
+        return false;
+    }
+    return true;
+}
+
+static vte_keyframe_t *keyframe_at(const vte_recording_t *recording, size_t index) {
+    return &recording->keyframes[(recording->keyframe_start + index) % recording->keyframe_capacity];
+}
+
+static void drop_oldest_keyframe(vte_recording_t *recording) {
+    vte_snapshot_free(&keyframe_at(recording, 0)->snapshot);
+    recording->keyframe_start = (recording->keyframe_start + 1) % recording->keyframe_capacity;
+    recording->keyframe_count--;
+}
+
+// Frames before the oldest keyframe cannot be rebuilt any more
+static void drop_unreachable_frames(vte_recording_t *recording) {
+    while (recording->frame_count > 0) {
+        uint64_t first = recording->frame_end - recording->frame_count;
+        if (recording->keyframe_count > 0 &&
+            recording->frames[first % recording->frame_capacity] >= keyframe_at(recording, 0)->position) {
+            break;
+        }
+        recording->frame_count--;
+    }
+}
+
+void vte_recording_free(vte_recording_t *recording) {
+    if (recording->keyframes) {
+        vte_recording_clear(recording);
+    }
+    free(recording->data);
+    free(recording->keyframes);
+    free(recording->frames);
+    memset(recording, 0, sizeof(*recording));
+}
+
+void vte_recording_clear(vte_recording_t *recording) {
+    while (recording->keyframe_count > 0) {
+        drop_oldest_keyframe(recording);
+    }
+    recording->frame_count = 0;
+}
+
+// A keyframe keeps the panel's state without anything the panel owns: the
+// view a seek builds gets its own screen and no history, window, pty or
+// replies
+static void take_keyframe(vte_recording_t *recording, terminal_panel_t *panel) {
+    if (recording->keyframe_count == recording->keyframe_capacity) {
+        drop_oldest_keyframe(recording);
+    }
+    vte_keyframe_t *keyframe = keyframe_at(recording, recording->keyframe_count);
+    if (!vte_snapshot_take(&keyframe->snapshot, panel)) {
+        return;
+    }
+    keyframe->position = recording->end;
+    keyframe->state = *panel;
+    terminal_panel_t *state = &keyframe->state;
+    state->win = NULL;
+    state->master_fd = -1;
+    state->child_pid = -1;
+    state->screen = NULL;
+    state->rows_shared = false;
+    state->reply = NULL;
+    state->packed_screen = NULL;
+    state->packed_screen_size = 0;
+    memset(&state->scrollback, 0, sizeof(state->scrollback));
+    memset(&state->input, 0, sizeof(state->input));
+    memset(&state->recording, 0, sizeof(state->recording));
+    recording->keyframe_count++;
+}
+
+void vte_recording_append(vte_recording_t *recording, terminal_panel_t *panel,
+                          const struct iovec *iov, int count) {
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        len += iov[i].iov_len;
+    }
+    if (!recording->data || len == 0) {
+        return;
+    }
+    if (len > recording->size) {
+        // Nothing recorded could be replayed up to the end of this; the next
+        // parse starts over with a keyframe
+        vte_recording_clear(recording);
+        recording->end += len;
+        return;
+    }
+
+    // Keyframes whose bytes this overwrites cannot be replayed from
+    uint64_t kept = recording->end + len > recording->size ? recording->end + len - recording->size : 0;
+    while (recording->keyframe_count > 0 && keyframe_at(recording, 0)->position < kept) {
+        drop_oldest_keyframe(recording);
+    }
+    if (recording->keyframe_count == 0 ||
+        recording->end - keyframe_at(recording, recording->keyframe_count - 1)->position >=
+            recording->interval) {
+        take_keyframe(recording, panel);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *bytes = iov[i].iov_base;
+        size_t left = iov[i].iov_len;
+        while (left > 0) {
+            size_t offset = recording->end & (recording->size - 1);
+            size_t chunk = recording->size - offset < left ? recording->size - offset : left;
+            memcpy(recording->data + offset, bytes, chunk);
+            recording->end += chunk;
+            bytes += chunk;
+            left -= chunk;
+        }
+    }
+
+    recording->frames[recording->frame_end % recording->frame_capacity] = recording->end;
+    recording->frame_end++;
+    if (recording->frame_count < recording->frame_capacity) {
+        recording->frame_count++;
+    }
+    drop_unreachable_frames(recording);
+}
+
+uint64_t vte_recording_first_frame(const vte_recording_t *recording) {
+    return recording->frame_end - recording->frame_count;
+}
+
+// Recorded bytes [start, end) as at most two iovecs
+static int recorded_span(const vte_recording_t *recording, uint64_t start, uint64_t end,
+                         struct iovec iov[2]) {
+    if (end <= start) {
+        return 0;
+    }
+    size_t offset = start & (recording->size - 1);
+    size_t len = end - start;
+    size_t first = recording->size - offset < len ? recording->size - offset : len;
+    iov[0].iov_base = recording->data + offset;
+    iov[0].iov_len = first;
+    if (first == len) {
+        return 1;
+    }
+    iov[1].iov_base = recording->data;
+    iov[1].iov_len = len - first;
+    return 2;
+}
+
+bool vte_recording_seek(const vte_recording_t *recording, uint64_t frame, terminal_panel_t *view) {
+    if (frame < vte_recording_first_frame(recording) || frame >= recording->frame_end) {
+        return false;
+    }
+    uint64_t target = recording->frames[frame % recording->frame_capacity];
+
+    // The newest keyframe at or before the frame
+    const vte_keyframe_t *keyframe = NULL;
+    for (size_t i = recording->keyframe_count; i-- > 0;) {
+        if (keyframe_at(recording, i)->position <= target) {
+            keyframe = keyframe_at(recording, i);
+            break;
+        }
+    }
+    if (!keyframe) {
+        return false;
+    }
+    terminal_cell_t **rows = vte_snapshot_share(&keyframe->snapshot);
+    if (!rows) {
+        return false;
+    }
+
+    vte_recording_view_free(view);
+    *view = keyframe->state;
+    view->screen = rows;
+    view->rows_shared = true;
+
+    struct iovec iov[2];
+    int count = recorded_span(recording, keyframe->position, target, iov);
+    vte_parser_advance_iov(&view->parser, view, iov, count);
+    return true;
+}
+
+void vte_recording_view_free(terminal_panel_t *view) {
+    for (int y = 0; view->screen && y < view->screen_height; y++) {
+        vte_row_unref(view->screen[y]);
+    }
+    free(view->screen);
+    memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,179 @@
+#include "vte_screen.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct vte_screen {
+    terminal_panel_t panel;  // Rows from vte_row_new() in panel.screen
+};
+
+static void clear_cells(terminal_cell_t *cells, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        cells[i].codepoint = ' ';
+        cells[i].fg_color = VTE_COLOR_DEFAULT;
+        cells[i].bg_color = VTE_COLOR_DEFAULT;
+        cells[i].attrs = VTE_ATTR_NORMAL;
+    }
+}
+
+vte_screen_t *vte_screen_new(int columns, int rows) {
+    if (columns <= 0 || rows <= 0) {
+        return NULL;
+    }
+
+    vte_screen_t *screen = calloc(1, sizeof(*screen));
+    if (!screen) {
+        return NULL;
+    }
+
+    screen->panel.screen = calloc(rows, sizeof(terminal_cell_t *));
+    if (!screen->panel.screen) {
+        free(screen);
+        return NULL;
+    }
+    for (int y = 0; y < rows; y++) {
+        screen->panel.screen[y] = vte_row_new(columns);
+        if (!screen->panel.screen[y]) {
+            while (y-- > 0) {
+                vte_row_unref(screen->panel.screen[y]);
+            }
+            free(screen->panel.screen);
+            free(screen);
+            return NULL;
+        }
+        clear_cells(screen->panel.screen[y], columns);
+    }
+
+    // No window or pty behind a library screen
+    screen->panel.master_fd = -1;
+    screen->panel.child_pid = -1;
+    screen->panel.width = columns;
+    screen->panel.height = rows;
+    vte_parser_init(&screen->panel.parser);
+    screen->panel.perform = terminal_perform;
+    terminal_panel_init(&screen->panel, columns, rows);
+    return screen;
+}
+
+void vte_screen_free(vte_screen_t *screen) {
+    if (!screen) {
+        return;
+    }
+    vte_scrollback_free(&screen->panel.scrollback);
+    for (int y = 0; y < screen->panel.screen_height; y++) {
+        vte_row_unref(screen->panel.screen[y]);
+    }
+    free(screen->panel.screen);
+    free(screen);
+}
+
+bool vte_screen_set_scrollback(vte_screen_t *screen, size_t lines) {
+    vte_scrollback_free(&screen->panel.scrollback);
+    return vte_scrollback_init(&screen->panel.scrollback, lines);
+}
+
+void vte_screen_reset(vte_screen_t *screen) {
+    terminal_panel_t *panel = &screen->panel;
+    vte_parser_init(&panel->parser);
+    terminal_panel_init(panel, panel->screen_width, panel->screen_height);
+    vte_scrollback_clear(&panel->scrollback);
+    for (int y = 0; y < panel->screen_height; y++) {
+        terminal_cell_t *row = vte_row_writable(panel, y);
+        if (row) {
+            clear_cells(row, panel->screen_width);
+        }
+    }
+}
+
+void vte_screen_feed(vte_screen_t *screen, const void *data, size_t len) {
+    vte_parser_advance(&screen->panel.parser, &screen->panel, data, len);
+}
+
+void vte_screen_feed_iov(vte_screen_t *screen, const struct iovec *iov, int count) {
+    vte_parser_advance_iov(&screen->panel.parser, &screen->panel, iov, count);
+}
+
+int vte_screen_columns(const vte_screen_t *screen) {
+    return screen->panel.screen_width;
+}
+
+int vte_screen_rows(const vte_screen_t *screen) {
+    return screen->panel.screen_height;
+}
+
+void vte_screen_cursor(const vte_screen_t *screen, int *x, int *y) {
+    *x = screen->panel.cursor_x;
+    *y = screen->panel.cursor_y;
+}
+
+const terminal_cell_t *vte_screen_row(const vte_screen_t *screen, int y) {
+    if (y < 0 || y >= screen->panel.screen_height) {
+        return NULL;
+    }
+    return screen->panel.screen[y];
+}
+
+size_t vte_screen_row_text(const vte_screen_t *screen, int y, char *out, size_t size) {
+    const terminal_cell_t *row = vte_screen_row(screen, y);
+    if (!row || size == 0) {
+        if (size > 0) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+
+    int end = screen->panel.screen_width;
+    while (end > 0 && row[end - 1].codepoint == ' ') {
+        end--;
+    }
+
+    size_t len = 0;
+    char utf8[4];
+    for (int x = 0; x < end; x++) {
+        uint32_t codepoint = row[x].codepoint;
+        size_t n = 1;
+        if (codepoint < 0x20) {
+            utf8[0] = ' ';
+        } else {
+            n = vte_utf8_encode(codepoint, utf8);
+        }
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(out + len, utf8, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+size_t vte_screen_row_runs(const vte_screen_t *screen, int y,
+                           vte_style_run_t *runs, size_t max_runs) {
+    const terminal_cell_t *row = vte_screen_row(screen, y);
+    if (!row) {
+        return 0;
+    }
+
+    size_t count = 0;
+    int columns = screen->panel.screen_width;
+    int x = 0;
+    while (x < columns) {
+        int start = x;
+        while (x < columns && row[x].fg_color == row[start].fg_color &&
+               row[x].bg_color == row[start].bg_color && row[x].attrs == row[start].attrs) {
+            x++;
+        }
+        if (count < max_runs) {
+            runs[count].start = start;
+            runs[count].end = x;
+            runs[count].fg_color = row[start].fg_color;
+            runs[count].bg_color = row[start].bg_color;
+            runs[count].attrs = row[start].attrs;
+        }
+        count++;
+    }
+    return count;
+}
+
+terminal_panel_t *vte_screen_panel(vte_screen_t *screen) {
+    return &screen->panel;
+}
@@ -0,0 +1,51 @@
+#ifndef VTE_SCREEN_H
+#define VTE_SCREEN_H
+
+#include "vte_parser.h"
+
+// Screen API for embedding the parser and screen model without toad's
+// ncurses front end (libtoadvte). A screen owns a grid of terminal_cell_t,
+// is driven by the same terminal perform implementation as toad's panels, and
+// exposes its contents as rows of cells, UTF-8 text and style runs.
+
+typedef struct vte_screen vte_screen_t;
+
+// A run of cells [start, end) in one row sharing colors and attributes
+typedef struct {
+    int start, end;
+    int fg_color;
+    int bg_color;
+    int attrs;
+} vte_style_run_t;
+
+vte_screen_t *vte_screen_new(int columns, int rows);
+void vte_screen_free(vte_screen_t *screen);
+void vte_screen_reset(vte_screen_t *screen);
+
+// Keep up to lines lines of scrollback (none by default); drops any history
+bool vte_screen_set_scrollback(vte_screen_t *screen, size_t lines);
+
+void vte_screen_feed(vte_screen_t *screen, const void *data, size_t len);
+// Feed count segments as one stream, e.g. records of a session log
+void vte_screen_feed_iov(vte_screen_t *screen, const struct iovec *iov, int count);
+
+int vte_screen_columns(const vte_screen_t *screen);
+int vte_screen_rows(const vte_screen_t *screen);
+void vte_screen_cursor(const vte_screen_t *screen, int *x, int *y);
+
+// Cells of row y, or NULL when y is out of range
+const terminal_cell_t *vte_screen_row(const vte_screen_t *screen, int y);
+
+// Row y as UTF-8 with trailing blanks trimmed. Writes at most size - 1 bytes
+// plus a terminator and returns the text length.
+size_t vte_screen_row_text(const vte_screen_t *screen, int y, char *out, size_t size);
+
+// Style runs of row y covering the whole row, default-styled cells included.
+// Returns the number of runs in the row; only the first max_runs are stored.
+size_t vte_screen_row_runs(const vte_screen_t *screen, int y,
+                           vte_style_run_t *runs, size_t max_runs);
+
+// The underlying panel, for callers that need the full terminal state
+terminal_panel_t *vte_screen_panel(vte_screen_t *screen);
+
+#endif // VTE_SCREEN_H
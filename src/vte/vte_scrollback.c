@@ -0,0 +1,592 @@
+#include "vte_parser.h"
+#include "vte_grid.h"
+#include "vte_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_LINE UINT32_MAX
+
+bool vte_scrollback_init(vte_scrollback_t *scrollback, size_t capacity) {
+    memset(scrollback, 0, sizeof(*scrollback));
+    scrollback->free_line = NO_LINE;
+    if (capacity == 0) {
+        return true;
+    }
+    // Distinct lines and the hash table grow with use; only the ring of ids
+    // is sized for a full history up front
+    scrollback->ids = malloc(capacity * sizeof(uint32_t));
+    if (!scrollback->ids) {
+        return false;
+    }
+    scrollback->capacity = capacity;
+    return true;
+}
+
+// Free the distinct lines and the table, keeping the ring and its count
+static void free_lines(vte_scrollback_t *scrollback) {
+    for (size_t i = 0; i < scrollback->lines_used; i++) {
+        free(scrollback->lines[i].data);
+    }
+    free(scrollback->lines);
+    free(scrollback->buckets);
+    scrollback->lines = NULL;
+    scrollback->lines_allocated = 0;
+    scrollback->lines_used = 0;
+    scrollback->free_line = NO_LINE;
+    scrollback->buckets = NULL;
+    scrollback->bucket_count = 0;
+    scrollback->unique = 0;
+    scrollback->bytes_stored = 0;
+    scrollback->cells_referenced = 0;
+}
+
+void vte_scrollback_free(vte_scrollback_t *scrollback) {
+    free_lines(scrollback);
+    free(scrollback->ids);
+    free(scrollback->packed);
+    memset(scrollback, 0, sizeof(*scrollback));
+    scrollback->free_line = NO_LINE;
+}
+
+// Forget the history but keep the line allocations for reuse
+void vte_scrollback_clear(vte_scrollback_t *scrollback) {
+    scrollback->free_line = NO_LINE;
+    for (size_t i = scrollback->lines_used; i-- > 0;) {
+        scrollback->lines[i].refs = 0;
+        scrollback->lines[i].next = scrollback->free_line;
+        scrollback->free_line = (uint32_t)i;
+    }
+    for (size_t b = 0; b < scrollback->bucket_count; b++) {
+        scrollback->buckets[b] = NO_LINE;
+    }
+    scrollback->unique = 0;
+    scrollback->bytes_stored = 0;
+    scrollback->cells_referenced = 0;
+    scrollback->start = 0;
+    scrollback->count = 0;
+    free(scrollback->packed);
+    scrollback->packed = NULL;
+    scrollback->packed_size = 0;
+}
+
+static uint32_t *bucket_of(vte_scrollback_t *scrollback, uint64_t hash) {
+    return &scrollback->buckets[hash & (scrollback->bucket_count - 1)];
+}
+
+// Make room for one more distinct line, doubling the entries up to the
+// capacity and the table with them so chains stay short
+static bool grow_lines(vte_scrollback_t *scrollback) {
+    size_t count = scrollback->lines_allocated ? scrollback->lines_allocated * 2 : 64;
+    if (count > scrollback->capacity) {
+        count = scrollback->capacity;
+    }
+    vte_scrollback_line_t *lines = realloc(scrollback->lines, count * sizeof(vte_scrollback_line_t));
+    if (!lines) {
+        return false;
+    }
+    memset(lines + scrollback->lines_allocated, 0,
+           (count - scrollback->lines_allocated) * sizeof(vte_scrollback_line_t));
+    scrollback->lines = lines;
+    scrollback->lines_allocated = count;
+
+    if (scrollback->bucket_count >= count) {
+        return true;
+    }
+    size_t bucket_count = scrollback->bucket_count ? scrollback->bucket_count : 64;
+    while (bucket_count < count) {
+        bucket_count *= 2;
+    }
+    uint32_t *buckets = malloc(bucket_count * sizeof(uint32_t));
+    if (!buckets) {
+        return true;  // The old table still works, with longer chains
+    }
+    free(scrollback->buckets);
+    scrollback->buckets = buckets;
+    scrollback->bucket_count = bucket_count;
+    for (size_t b = 0; b < bucket_count; b++) {
+        buckets[b] = NO_LINE;
+    }
+    for (size_t i = 0; i < scrollback->lines_used; i++) {
+        if (lines[i].refs > 0) {
+            uint32_t *bucket = bucket_of(scrollback, lines[i].hash);
+            lines[i].next = *bucket;
+            *bucket = (uint32_t)i;
+        }
+    }
+    return true;
+}
+
+// Style runs of cells if the line can be stored compact: ASCII, in at most
+// VTE_SCROLLBACK_RUNS runs of styles a style word holds exactly. Returns
+// the number of runs, or -1 to keep the cells.
+static int compact_runs(const terminal_cell_t *cells, int len, vte_grid_run_t *runs) {
+    if (!vte_kernel->ascii_only(cells, len)) {
+        return -1;
+    }
+    int count = 0;
+    for (int x = 0; x < len; x++) {
+        if (x > 0 && cells[x].fg_color == cells[x - 1].fg_color &&
+            cells[x].bg_color == cells[x - 1].bg_color && cells[x].attrs == cells[x - 1].attrs) {
+            continue;
+        }
+        uint32_t style = vte_grid_style(cells[x].fg_color, cells[x].bg_color, cells[x].attrs);
+        terminal_cell_t check;
+        vte_grid_unpack_style(style, &check.fg_color, &check.bg_color, &check.attrs);
+        if (count == VTE_SCROLLBACK_RUNS || check.fg_color != cells[x].fg_color ||
+            check.bg_color != cells[x].bg_color || check.attrs != cells[x].attrs) {
+            return -1;
+        }
+        runs[count++] = (vte_grid_run_t){ x, style };
+    }
+    return count;
+}
+
+static const uint8_t *compact_chars(const vte_scrollback_line_t *line) {
+    return (const uint8_t *)line->data + line->run_count * sizeof(vte_grid_run_t);
+}
+
+// Write the first keep cells of a stored line to cells
+static void expand_line(const vte_scrollback_line_t *line, terminal_cell_t *cells, int keep) {
+    int len = line->len < keep ? line->len : keep;
+    if (!line->compact) {
+        if (len > 0) {
+            memcpy(cells, line->data, len * sizeof(terminal_cell_t));
+        }
+        return;
+    }
+    const vte_grid_run_t *runs = line->data;
+    const uint8_t *chars = compact_chars(line);
+    for (int r = 0; r < line->run_count && runs[r].start < len; r++) {
+        int end = r + 1 < line->run_count ? runs[r + 1].start : line->len;
+        if (end > len) {
+            end = len;
+        }
+        terminal_cell_t cell = { ' ', 0, 0, 0 };
+        vte_grid_unpack_style(runs[r].style, &cell.fg_color, &cell.bg_color, &cell.attrs);
+        vte_kernel->fill_cells(cells + runs[r].start, end - runs[r].start, cell);
+    }
+    for (int x = 0; x < len; x++) {
+        cells[x].codepoint = chars[x];
+    }
+}
+
+// Whether a stored line holds exactly cells. The encoding depends only on
+// the cells, so a compact line can only equal cells that encode the same.
+static bool line_equals(const vte_scrollback_line_t *line, const terminal_cell_t *cells, int len,
+                        const vte_grid_run_t *runs, int run_count) {
+    if (line->len != len || line->compact != (run_count >= 0)) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+    if (!line->compact) {
+        return memcmp(line->data, cells, len * sizeof(terminal_cell_t)) == 0;
+    }
+    if (line->run_count != run_count ||
+        memcmp(line->data, runs, run_count * sizeof(vte_grid_run_t)) != 0) {
+        return false;
+    }
+    const uint8_t *chars = compact_chars(line);
+    for (int x = 0; x < len; x++) {
+        if (chars[x] != cells[x].codepoint) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Id of a line holding cells, shared with an identical line already stored;
+// NO_LINE if out of memory
+static uint32_t intern_line(vte_scrollback_t *scrollback, const terminal_cell_t *cells, int len) {
+    uint64_t hash = vte_hash_cells(cells, len);
+    vte_grid_run_t runs[VTE_SCROLLBACK_RUNS];
+    int run_count = compact_runs(cells, len, runs);
+    vte_scrollback_line_t *lines = scrollback->lines;
+    if (scrollback->bucket_count > 0) {
+        for (uint32_t id = *bucket_of(scrollback, hash); id != NO_LINE; id = lines[id].next) {
+            if (lines[id].hash == hash && line_equals(&lines[id], cells, len, runs, run_count)) {
+                lines[id].refs++;
+                scrollback->cells_referenced += len;
+                return id;
+            }
+        }
+    }
+
+    // A freed entry keeps its allocation for the next line
+    size_t bytes = run_count >= 0 ? run_count * sizeof(vte_grid_run_t) + len
+                                  : len * sizeof(terminal_cell_t);
+    uint32_t id = scrollback->free_line;
+    if (id == NO_LINE) {
+        if (scrollback->lines_used == scrollback->lines_allocated && !grow_lines(scrollback)) {
+            return NO_LINE;
+        }
+        id = (uint32_t)scrollback->lines_used;
+    }
+    vte_scrollback_line_t *line = &scrollback->lines[id];
+    if (bytes > (size_t)line->allocated) {
+        void *grown = realloc(line->data, bytes);
+        if (!grown) {
+            return NO_LINE;
+        }
+        line->data = grown;
+        line->allocated = (int)bytes;
+    }
+    if (id == scrollback->free_line) {
+        scrollback->free_line = line->next;
+    } else {
+        scrollback->lines_used++;
+    }
+    line->compact = run_count >= 0;
+    line->run_count = 0;
+    if (line->compact && len > 0) {
+        memcpy(line->data, runs, run_count * sizeof(vte_grid_run_t));
+        uint8_t *chars = (uint8_t *)line->data + run_count * sizeof(vte_grid_run_t);
+        for (int x = 0; x < len; x++) {
+            chars[x] = (uint8_t)cells[x].codepoint;
+        }
+        line->run_count = (uint8_t)run_count;
+    } else if (len > 0) {
+        memcpy(line->data, cells, len * sizeof(terminal_cell_t));
+    }
+    line->len = len;
+    line->hash = hash;
+    line->refs = 1;
+    uint32_t *bucket = bucket_of(scrollback, hash);
+    line->next = *bucket;
+    *bucket = id;
+    scrollback->unique++;
+    scrollback->bytes_stored += bytes;
+    scrollback->cells_referenced += len;
+    return id;
+}
+
+// Drop one reference to a line, freeing it with the last
+static void release_line(vte_scrollback_t *scrollback, uint32_t id) {
+    vte_scrollback_line_t *line = &scrollback->lines[id];
+    scrollback->cells_referenced -= line->len;
+    if (--line->refs > 0) {
+        return;
+    }
+    uint32_t *link = bucket_of(scrollback, line->hash);
+    while (*link != id) {
+        link = &scrollback->lines[*link].next;
+    }
+    *link = line->next;
+    line->next = scrollback->free_line;
+    scrollback->free_line = id;
+    scrollback->unique--;
+    scrollback->bytes_stored -= line->compact ? line->run_count * sizeof(vte_grid_run_t) + line->len
+                                              : line->len * sizeof(terminal_cell_t);
+}
+
+void vte_scrollback_push(vte_scrollback_t *scrollback, const terminal_cell_t *row, int width) {
+    if (scrollback->capacity == 0 || !vte_scrollback_unpack(scrollback)) {
+        return;
+    }
+
+    int len = (int)vte_kernel->trim_blank_cells(row, width);
+
+    // Take the next free slot, or recycle the oldest line once the ring is
+    // full; it is released first so a line it shares can be found again
+    size_t slot;
+    if (scrollback->count < scrollback->capacity) {
+        slot = (scrollback->start + scrollback->count) % scrollback->capacity;
+        scrollback->count++;
+    } else {
+        slot = scrollback->start;
+        scrollback->start = (scrollback->start + 1) % scrollback->capacity;
+        release_line(scrollback, scrollback->ids[slot]);
+    }
+
+    uint32_t id = intern_line(scrollback, row, len);
+    if (id == NO_LINE) {
+        scrollback->count--;  // Out of memory: the line is lost
+        return;
+    }
+    scrollback->ids[slot] = id;
+}
+
+size_t vte_scrollback_count(const vte_scrollback_t *scrollback) {
+    return scrollback->count;
+}
+
+void vte_scrollback_memory(const vte_scrollback_t *scrollback, size_t *referenced, size_t *stored) {
+    *referenced = scrollback->cells_referenced * sizeof(terminal_cell_t);
+    *stored = scrollback->bytes_stored;
+}
+
+int vte_scrollback_line(const vte_scrollback_t *scrollback, size_t index, terminal_cell_t *cells, int max) {
+    if (index >= scrollback->count || vte_scrollback_is_packed(scrollback)) {
+        return 0;
+    }
+    const vte_scrollback_line_t *line =
+        &scrollback->lines[scrollback->ids[(scrollback->start + index) % scrollback->capacity]];
+    expand_line(line, cells, max);
+    return line->len;
+}
+
+// Take the newest line back out of the history into row, padded with blank
+// cells or cut to width. Returns false when the history is empty.
+bool vte_scrollback_pop(vte_scrollback_t *scrollback, terminal_cell_t *row, int width) {
+    if (scrollback->count == 0 || !vte_scrollback_unpack(scrollback)) {
+        return false;
+    }
+    scrollback->count--;
+    uint32_t id = scrollback->ids[(scrollback->start + scrollback->count) % scrollback->capacity];
+    const vte_scrollback_line_t *line = &scrollback->lines[id];
+
+    int len = line->len < width ? line->len : width;
+    expand_line(line, row, width);
+    if (len < width) {
+        vte_kernel->fill_cells(row + len, width - len, VTE_BLANK_CELL);
+    }
+    release_line(scrollback, id);
+    return true;
+}
+
+// Packed form: each line is its cell count followed by runs of cells that
+// share a style, each run its length, colors and attributes and then its
+// codepoints. Numbers are LEB128 varints and colors are zigzag-encoded so
+// the default (-1) takes one byte, which makes a plain text cell one byte
+// instead of sizeof(terminal_cell_t).
+
+typedef struct {
+    uint8_t *data;
+    size_t len, cap;
+    bool failed;
+} pack_buffer_t;
+
+static void put_varint(pack_buffer_t *buf, uint32_t value) {
+    if (buf->failed) {
+        return;
+    }
+    if (buf->cap - buf->len < 5) {
+        size_t cap = buf->cap ? buf->cap * 2 : 4096;
+        uint8_t *data = realloc(buf->data, cap);
+        if (!data) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+    while (value >= 0x80) {
+        buf->data[buf->len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf->data[buf->len++] = (uint8_t)value;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t byte = *(*p)++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag(int value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int unzigzag(uint32_t value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static bool same_style(const terminal_cell_t *a, const terminal_cell_t *b) {
+    return a->fg_color == b->fg_color && a->bg_color == b->bg_color && a->attrs == b->attrs;
+}
+
+static void pack_line(pack_buffer_t *buf, const terminal_cell_t *cells, int len) {
+    put_varint(buf, (uint32_t)len);
+    for (int x = 0; x < len;) {
+        int run = 1;
+        while (x + run < len && same_style(&cells[x + run], &cells[x])) {
+            run++;
+        }
+        put_varint(buf, (uint32_t)run);
+        put_varint(buf, zigzag(cells[x].fg_color));
+        put_varint(buf, zigzag(cells[x].bg_color));
+        put_varint(buf, (uint32_t)cells[x].attrs);
+        for (int i = 0; i < run; i++) {
+            put_varint(buf, cells[x + i].codepoint);
+        }
+        x += run;
+    }
+}
+
+// Decode the runs of a line of len cells, keeping the first keep of them
+static bool unpack_line(const uint8_t **p, const uint8_t *end, terminal_cell_t *cells,
+                        int len, int keep) {
+    for (int x = 0; x < len;) {
+        uint32_t run, fg, bg, attrs;
+        if (!get_varint(p, end, &run) || run == 0 || run > (uint32_t)(len - x) ||
+            !get_varint(p, end, &fg) || !get_varint(p, end, &bg) || !get_varint(p, end, &attrs)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < run; i++, x++) {
+            uint32_t codepoint;
+            if (!get_varint(p, end, &codepoint)) {
+                return false;
+            }
+            if (x < keep) {
+                cells[x].codepoint = codepoint;
+                cells[x].fg_color = unzigzag(fg);
+                cells[x].bg_color = unzigzag(bg);
+                cells[x].attrs = (int)attrs;
+            }
+        }
+    }
+    return true;
+}
+
+// Shrink a finished buffer to its contents
+static uint8_t *pack_finish(pack_buffer_t *buf, size_t *size) {
+    if (buf->failed) {
+        free(buf->data);
+        return NULL;
+    }
+    uint8_t *data = realloc(buf->data, buf->len ? buf->len : 1);
+    *size = buf->len;
+    return data ? data : buf->data;
+}
+
+uint8_t *vte_pack_rows(terminal_cell_t *const *rows, int count, int width, size_t *size) {
+    pack_buffer_t buf = {0};
+    for (int y = 0; y < count; y++) {
+        int len = (int)vte_kernel->trim_blank_cells(rows[y], width);
+        pack_line(&buf, rows[y], len);
+    }
+    return pack_finish(&buf, size);
+}
+
+bool vte_unpack_rows(const uint8_t *data, size_t size, terminal_cell_t **rows, int count, int width) {
+    const uint8_t *p = data, *end = data + size;
+    for (int y = 0; y < count; y++) {
+        uint32_t len;
+        if (!get_varint(&p, end, &len) || len > 0x7FFFFFFF ||
+            !unpack_line(&p, end, rows[y], (int)len, width)) {
+            return false;
+        }
+        if ((int)len < width) {
+            vte_kernel->fill_cells(&rows[y][len], width - len, VTE_BLANK_CELL);
+        }
+    }
+    return true;
+}
+
+bool vte_scrollback_is_packed(const vte_scrollback_t *scrollback) {
+    return scrollback->capacity > 0 && !scrollback->ids;
+}
+
+bool vte_scrollback_pack(vte_scrollback_t *scrollback) {
+    if (scrollback->capacity == 0 || vte_scrollback_is_packed(scrollback)) {
+        return true;
+    }
+
+    // Shared lines are packed once per slot, so unpacking shares them again
+    pack_buffer_t buf = {0};
+    terminal_cell_t *row = NULL;
+    int row_allocated = 0;
+    for (size_t i = 0; i < scrollback->count && !buf.failed; i++) {
+        const vte_scrollback_line_t *line =
+            &scrollback->lines[scrollback->ids[(scrollback->start + i) % scrollback->capacity]];
+        if (!line->compact) {
+            pack_line(&buf, line->data, line->len);
+            continue;
+        }
+        if (line->len > row_allocated) {
+            terminal_cell_t *grown = realloc(row, line->len * sizeof(terminal_cell_t));
+            if (!grown) {
+                buf.failed = true;
+                break;
+            }
+            row = grown;
+            row_allocated = line->len;
+        }
+        expand_line(line, row, line->len);
+        pack_line(&buf, row, line->len);
+    }
+    free(row);
+    size_t size = 0;
+    uint8_t *packed = pack_finish(&buf, &size);
+    if (!packed) {
+        return false;
+    }
+
+    free_lines(scrollback);
+    free(scrollback->ids);
+    scrollback->ids = NULL;
+    scrollback->start = 0;
+    scrollback->packed = packed;
+    scrollback->packed_size = size;
+    return true;
+}
+
+// Decode the packed lines into the pool, sharing as push does. Returns the
+// number decoded before any damage, or -1 if out of memory.
+static long unpack_lines(vte_scrollback_t *scrollback) {
+    terminal_cell_t *row = NULL;
+    uint32_t row_allocated = 0;
+    const uint8_t *p = scrollback->packed, *end = p + scrollback->packed_size;
+    size_t count = 0;
+    for (; count < scrollback->count; count++) {
+        uint32_t len;
+        if (!get_varint(&p, end, &len) || len > 0x7FFFFFFF) {
+            break;
+        }
+        if (len > row_allocated) {
+            terminal_cell_t *grown = realloc(row, len * sizeof(terminal_cell_t));
+            if (!grown) {
+                free(row);
+                return -1;
+            }
+            row = grown;
+            row_allocated = len;
+        }
+        if (!unpack_line(&p, end, row, (int)len, (int)len)) {
+            break;
+        }
+        uint32_t id = intern_line(scrollback, row, (int)len);
+        if (id == NO_LINE) {
+            free(row);
+            return -1;
+        }
+        scrollback->ids[count] = id;
+    }
+    free(row);
+    return (long)count;
+}
+
+bool vte_scrollback_unpack(vte_scrollback_t *scrollback) {
+    if (!vte_scrollback_is_packed(scrollback)) {
+        return true;
+    }
+
+    // Lines come back oldest first from slot 0
+    scrollback->ids = malloc(scrollback->capacity * sizeof(uint32_t));
+    if (!scrollback->ids) {
+        return false;
+    }
+    long count = unpack_lines(scrollback);
+    if (count < 0) {
+        free_lines(scrollback);
+        free(scrollback->ids);
+        scrollback->ids = NULL;
+        return false;
+    }
+
+    // A damaged buffer keeps the lines decoded before the damage
+    free(scrollback->packed);
+    scrollback->packed = NULL;
+    scrollback->packed_size = 0;
+    scrollback->start = 0;
+    scrollback->count = (size_t)count;
+    return true;
+}
@@ -0,0 +1,89 @@
+#include "vte_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A counted row is its header followed by the cells; the row pointer points
+// at the cells, so the rest of the engine sees a plain terminal_cell_t array.
+// The header is 16 bytes to keep the cells as aligned as malloc() makes them.
+typedef struct {
+    size_t refs;
+    size_t width;
+} row_header_t;
+
+static row_header_t *header_of(const terminal_cell_t *row) {
+    return (row_header_t *)row - 1;
+}
+
+terminal_cell_t *vte_row_new(int width) {
+    row_header_t *header = malloc(sizeof(row_header_t) + width * sizeof(terminal_cell_t));
+    if (!header) {
+        return NULL;
+    }
+    header->refs = 1;
+    header->width = (size_t)width;
+    return (terminal_cell_t *)(header + 1);
+}
+
+void vte_row_unref(terminal_cell_t *row) {
+    if (row && --header_of(row)->refs == 0) {
+        free(header_of(row));
+    }
+}
+
+terminal_cell_t *vte_row_writable(terminal_panel_t *panel, int y) {
+    terminal_cell_t *row = panel->screen[y];
+    if (!panel->rows_shared || header_of(row)->refs == 1) {
+        return row;
+    }
+    // The snapshots keep the old row, the panel continues with a copy
+    size_t width = header_of(row)->width;
+    terminal_cell_t *copy = vte_row_new((int)width);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, row, width * sizeof(terminal_cell_t));
+    vte_row_unref(row);
+    panel->screen[y] = copy;
+    return copy;
+}
+
+bool vte_snapshot_take(vte_snapshot_t *snapshot, terminal_panel_t *panel) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!panel->screen) {
+        return false;
+    }
+    snapshot->rows = malloc(panel->screen_height * sizeof(terminal_cell_t *));
+    if (!snapshot->rows) {
+        return false;
+    }
+    for (int y = 0; y < panel->screen_height; y++) {
+        snapshot->rows[y] = panel->screen[y];
+        header_of(panel->screen[y])->refs++;
+    }
+    panel->rows_shared = true;
+    snapshot->width = panel->screen_width;
+    snapshot->height = panel->screen_height;
+    snapshot->cursor_x = panel->cursor_x;
+    snapshot->cursor_y = panel->cursor_y;
+    return true;
+}
+
+terminal_cell_t **vte_snapshot_share(const vte_snapshot_t *snapshot) {
+    terminal_cell_t **rows = malloc(snapshot->height * sizeof(terminal_cell_t *));
+    if (!rows) {
+        return NULL;
+    }
+    for (int y = 0; y < snapshot->height; y++) {
+        rows[y] = snapshot->rows[y];
+        header_of(rows[y])->refs++;
+    }
+    return rows;
+}
+
+void vte_snapshot_free(vte_snapshot_t *snapshot) {
+    for (int y = 0; snapshot->rows && y < snapshot->height; y++) {
+        vte_row_unref(snapshot->rows[y]);
+    }
+    free(snapshot->rows);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
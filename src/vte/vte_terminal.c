@@ -1,13 +1,46 @@
 #include "vte_parser.h"
-#include <ncurses.h>
+#include "vte_kernels.h"
+#include <stdio.h>
 #include <string.h>
 
+// Blank columns x0..x1-1 of row y in the default style
+static void erase_cells(terminal_panel_t *panel, int y, int x0, int x1) {
+    if (x1 > panel->screen_width) {
+        x1 = panel->screen_width;
+    }
+    terminal_cell_t *row = x0 < x1 ? vte_row_writable(panel, y) : NULL;
+    if (row) {
+        vte_kernel->fill_cells(&row[x0], x1 - x0, VTE_BLANK_CELL);
+    }
+}
+
+// Scroll the whole screen up one line, saving the top line in the scrollback
+// and clearing the bottom line to the default style. Rows move by pointer,
+// so rows a snapshot shares stay shared.
+static void scroll_screen_up(terminal_panel_t *panel) {
+    panel->cells_damaged = true;
+    terminal_cell_t *top = panel->screen[0];
+    vte_scrollback_push(&panel->scrollback, top, panel->screen_width);
+    memmove(&panel->screen[0], &panel->screen[1], (panel->screen_height - 1) * sizeof(terminal_cell_t *));
+    panel->screen[panel->screen_height - 1] = top;
+    erase_cells(panel, panel->screen_height - 1, 0, panel->screen_width);
+}
+
+// Scroll the whole screen down one line, clearing the top line
+static void scroll_screen_down(terminal_panel_t *panel) {
+    panel->cells_damaged = true;
+    terminal_cell_t *bottom = panel->screen[panel->screen_height - 1];
+    memmove(&panel->screen[1], &panel->screen[0], (panel->screen_height - 1) * sizeof(terminal_cell_t *));
+    panel->screen[0] = bottom;
+    erase_cells(panel, 0, 0, panel->screen_width);
+}
+
 // Terminal-specific perform implementation
 static void terminal_print(terminal_panel_t *panel, uint32_t codepoint) {
     if (panel->cursor_y >= 0 && panel->cursor_y < panel->screen_height &&
         panel->cursor_x >= 0 && panel->cursor_x < panel->screen_width) {
         
-        terminal_cell_t *cell = &panel->screen[panel->cursor_y][panel->cursor_x];
+        terminal_cell_t *row = vte_row_writable(panel, panel->cursor_y);
         
         // Handle DEC special character set
         if (panel->g0_charset == CHARSET_DEC_SPECIAL && !panel->using_g1 && codepoint >= 0x60 && codepoint <= 0x7E) {
@@ -28,28 +61,21 @@ static void terminal_print(terminal_panel_t *panel, uint32_t codepoint) {
             }
         }
         
-        cell->codepoint = codepoint;
-        cell->fg_color = panel->fg_color;
-        cell->bg_color = panel->bg_color;
-        cell->attrs = panel->attrs;
+        if (row) {
+            terminal_cell_t *cell = &row[panel->cursor_x];
+            cell->codepoint = codepoint;
+            cell->fg_color = panel->fg_color;
+            cell->bg_color = panel->bg_color;
+            cell->attrs = panel->attrs;
+            panel->cells_damaged = true;
+        }
         
         panel->cursor_x++;
         if (panel->cursor_x >= panel->screen_width) {
             panel->cursor_x = 0;
             panel->cursor_y++;
             if (panel->cursor_y >= panel->screen_height) {
-                // Scroll up
-                for (int y = 0; y < panel->screen_height - 1; y++) {
-                    memcpy(panel->screen[y], panel->screen[y + 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear last line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[panel->screen_height - 1][x].codepoint = ' ';
-                    panel->screen[panel->screen_height - 1][x].fg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].bg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].attrs = A_NORMAL;
-                }
+                scroll_screen_up(panel);
                 panel->cursor_y = panel->screen_height - 1;
             }
         }
@@ -62,18 +88,7 @@ static void terminal_execute(terminal_panel_t *panel, uint8_t byte) {
             panel->cursor_x = 0;
             panel->cursor_y++;
             if (panel->cursor_y >= panel->screen_height) {
-                // Scroll up
-                for (int y = 0; y < panel->screen_height - 1; y++) {
-                    memcpy(panel->screen[y], panel->screen[y + 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear last line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[panel->screen_height - 1][x].codepoint = ' ';
-                    panel->screen[panel->screen_height - 1][x].fg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].bg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].attrs = A_NORMAL;
-                }
+                scroll_screen_up(panel);
                 panel->cursor_y = panel->screen_height - 1;
             }
             break;
@@ -95,6 +110,12 @@ static void terminal_execute(terminal_panel_t *panel, uint8_t byte) {
     }
 }
 
+static void terminal_reply(terminal_panel_t *panel, const char *data) {
+    if (panel->reply) {
+        panel->reply(panel, data, strlen(data));
+    }
+}
+
 static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *params,
                                  const uint8_t *intermediates, size_t intermediate_len,
                                  bool ignore, char action) {
@@ -106,7 +127,7 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
                 // Reset to defaults
                 panel->fg_color = -1;
                 panel->bg_color = -1;
-                panel->attrs = A_NORMAL;
+                panel->attrs = VTE_ATTR_NORMAL;
                 break;
             }
             
@@ -122,25 +143,25 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
                         case 0: // Reset
                             panel->fg_color = -1;
                             panel->bg_color = -1;
-                            panel->attrs = A_NORMAL;
+                            panel->attrs = VTE_ATTR_NORMAL;
                             break;
                         case 1: // Bold
-                            panel->attrs |= A_BOLD;
+                            panel->attrs |= VTE_ATTR_BOLD;
                             break;
                         case 4: // Underline
-                            panel->attrs |= A_UNDERLINE;
+                            panel->attrs |= VTE_ATTR_UNDERLINE;
                             break;
                         case 7: // Reverse
-                            panel->attrs |= A_REVERSE;
+                            panel->attrs |= VTE_ATTR_REVERSE;
                             break;
                         case 22: // Normal intensity
-                            panel->attrs &= ~A_BOLD;
+                            panel->attrs &= ~VTE_ATTR_BOLD;
                             break;
                         case 24: // No underline
-                            panel->attrs &= ~A_UNDERLINE;
+                            panel->attrs &= ~VTE_ATTR_UNDERLINE;
                             break;
                         case 27: // No reverse
-                            panel->attrs &= ~A_REVERSE;
+                            panel->attrs &= ~VTE_ATTR_REVERSE;
                             break;
                         case 39: // Default foreground color
                             panel->fg_color = -1;
@@ -150,14 +171,14 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
                             break;
                         default:
                             if (param >= 30 && param <= 37) {
-                                panel->fg_color = ansi_to_ncurses_color(param - 30);
+                                panel->fg_color = vte_ansi_color(param - 30);
                             } else if (param >= 40 && param <= 47) {
-                                panel->bg_color = ansi_to_ncurses_color(param - 40);
+                                panel->bg_color = vte_ansi_color(param - 40);
                             } else if (param >= 90 && param <= 97) {
-                                panel->fg_color = ansi_to_ncurses_color(param - 90);
-                                panel->attrs |= A_BOLD;
+                                panel->fg_color = vte_ansi_color(param - 90);
+                                panel->attrs |= VTE_ATTR_BOLD;
                             } else if (param >= 100 && param <= 107) {
-                                panel->bg_color = ansi_to_ncurses_color(param - 100);
+                                panel->bg_color = vte_ansi_color(param - 100);
                             }
                             break;
                     }
@@ -202,52 +223,30 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
         }
         case 'J': { // ED - Erase in Display
             uint16_t param = vte_params_get_single(params, 0, 0);
+            panel->cells_damaged = true;
             switch (param) {
                 case 0: // Clear from cursor to end of screen
                     // Clear from cursor to end of line
-                    for (int x = panel->cursor_x; x < panel->screen_width; x++) {
-                        panel->screen[panel->cursor_y][x].codepoint = ' ';
-                        panel->screen[panel->cursor_y][x].fg_color = -1;
-                        panel->screen[panel->cursor_y][x].bg_color = -1;
-                        panel->screen[panel->cursor_y][x].attrs = A_NORMAL;
-                    }
+                    erase_cells(panel, panel->cursor_y, panel->cursor_x, panel->screen_width);
                     // Clear all lines below
                     for (int y = panel->cursor_y + 1; y < panel->screen_height; y++) {
-                        for (int x = 0; x < panel->screen_width; x++) {
-                            panel->screen[y][x].codepoint = ' ';
-                            panel->screen[y][x].fg_color = -1;
-                            panel->screen[y][x].bg_color = -1;
-                            panel->screen[y][x].attrs = A_NORMAL;
-                        }
+                        erase_cells(panel, y, 0, panel->screen_width);
                     }
                     break;
                 case 1: // Clear from beginning of screen to cursor
                     // Clear all lines above
                     for (int y = 0; y < panel->cursor_y; y++) {
-                        for (int x = 0; x < panel->screen_width; x++) {
-                            panel->screen[y][x].codepoint = ' ';
-                            panel->screen[y][x].fg_color = -1;
-                            panel->screen[y][x].bg_color = -1;
-                            panel->screen[y][x].attrs = A_NORMAL;
-                        }
+                        erase_cells(panel, y, 0, panel->screen_width);
                     }
                     // Clear from beginning of line to cursor
-                    for (int x = 0; x <= panel->cursor_x; x++) {
-                        panel->screen[panel->cursor_y][x].codepoint = ' ';
-                        panel->screen[panel->cursor_y][x].fg_color = -1;
-                        panel->screen[panel->cursor_y][x].bg_color = -1;
-                        panel->screen[panel->cursor_y][x].attrs = A_NORMAL;
-                    }
+                    erase_cells(panel, panel->cursor_y, 0, panel->cursor_x + 1);
                     break;
-                case 2: // Clear entire screen
                 case 3: // Clear entire screen and scrollback
+                    vte_scrollback_clear(&panel->scrollback);
+                    // Fall through
+                case 2: // Clear entire screen
                     for (int y = 0; y < panel->screen_height; y++) {
-                        for (int x = 0; x < panel->screen_width; x++) {
-                            panel->screen[y][x].codepoint = ' ';
-                            panel->screen[y][x].fg_color = -1;
-                            panel->screen[y][x].bg_color = -1;
-                            panel->screen[y][x].attrs = A_NORMAL;
-                        }
+                        erase_cells(panel, y, 0, panel->screen_width);
                     }
                     // Move cursor to home position (0,0) after clearing screen
                     panel->cursor_x = 0;
@@ -258,30 +257,16 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
         }
         case 'K': { // EL - Erase in Line
             uint16_t param = vte_params_get_single(params, 0, 0);
+            panel->cells_damaged = true;
             switch (param) {
                 case 0: // Clear from cursor to end of line
-                    for (int x = panel->cursor_x; x < panel->screen_width; x++) {
-                        panel->screen[panel->cursor_y][x].codepoint = ' ';
-                        panel->screen[panel->cursor_y][x].fg_color = -1;
-                        panel->screen[panel->cursor_y][x].bg_color = -1;
-                        panel->screen[panel->cursor_y][x].attrs = A_NORMAL;
-                    }
+                    erase_cells(panel, panel->cursor_y, panel->cursor_x, panel->screen_width);
                     break;
                 case 1: // Clear from beginning of line to cursor
-                    for (int x = 0; x <= panel->cursor_x; x++) {
-                        panel->screen[panel->cursor_y][x].codepoint = ' ';
-                        panel->screen[panel->cursor_y][x].fg_color = -1;
-                        panel->screen[panel->cursor_y][x].bg_color = -1;
-                        panel->screen[panel->cursor_y][x].attrs = A_NORMAL;
-                    }
+                    erase_cells(panel, panel->cursor_y, 0, panel->cursor_x + 1);
                     break;
                 case 2: // Clear entire line
-                    for (int x = 0; x < panel->screen_width; x++) {
-                        panel->screen[panel->cursor_y][x].codepoint = ' ';
-                        panel->screen[panel->cursor_y][x].fg_color = -1;
-                        panel->screen[panel->cursor_y][x].bg_color = -1;
-                        panel->screen[panel->cursor_y][x].attrs = A_NORMAL;
-                    }
+                    erase_cells(panel, panel->cursor_y, 0, panel->screen_width);
                     break;
             }
             break;
@@ -289,36 +274,39 @@ static void terminal_csi_dispatch(terminal_panel_t *panel, const vte_params_t *p
         case 'S': { // SU - Scroll Up
             uint16_t count = vte_params_get_single(params, 0, 1);
             for (uint16_t i = 0; i < count && i < panel->screen_height; i++) {
-                // Scroll up one line
-                for (int y = 0; y < panel->screen_height - 1; y++) {
-                    memcpy(panel->screen[y], panel->screen[y + 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear last line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[panel->screen_height - 1][x].codepoint = ' ';
-                    panel->screen[panel->screen_height - 1][x].fg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].bg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].attrs = A_NORMAL;
-                }
+                scroll_screen_up(panel);
+            }
+            break;
+        }
+        case 'n': { // DSR - Device Status Report
+            uint16_t report = vte_params_get_single(params, 0, 0);
+            if (intermediate_len != 0) {
+                break;
+            }
+            if (report == 5) {
+                terminal_reply(panel, "\033[0n"); // Operating normally
+            } else if (report == 6) { // CPR - Cursor Position Report
+                char cpr[32];
+                snprintf(cpr, sizeof(cpr), "\033[%d;%dR", panel->cursor_y + 1, panel->cursor_x + 1);
+                terminal_reply(panel, cpr);
+            }
+            break;
+        }
+        case 'c': { // DA - Device Attributes
+            if (vte_params_get_single(params, 0, 0) != 0) {
+                break;
+            }
+            if (intermediate_len == 0) {
+                terminal_reply(panel, "\033[?1;2c"); // VT100 with advanced video
+            } else if (intermediates[0] == '>') {
+                terminal_reply(panel, "\033[>0;0;0c");
             }
             break;
         }
         case 'T': { // SD - Scroll Down
             uint16_t count = vte_params_get_single(params, 0, 1);
             for (uint16_t i = 0; i < count && i < panel->screen_height; i++) {
-                // Scroll down one line
-                for (int y = panel->screen_height - 1; y > 0; y--) {
-                    memcpy(panel->screen[y], panel->screen[y - 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear first line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[0][x].codepoint = ' ';
-                    panel->screen[0][x].fg_color = -1;
-                    panel->screen[0][x].bg_color = -1;
-                    panel->screen[0][x].attrs = A_NORMAL;
-                }
+                scroll_screen_down(panel);
             }
             break;
         }
@@ -348,18 +336,7 @@ static void terminal_esc_dispatch(terminal_panel_t *panel, const uint8_t *interm
         case 'D': // IND - Index (move cursor down, scroll if at bottom)
             panel->cursor_y++;
             if (panel->cursor_y >= panel->screen_height) {
-                // Scroll up
-                for (int y = 0; y < panel->screen_height - 1; y++) {
-                    memcpy(panel->screen[y], panel->screen[y + 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear last line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[panel->screen_height - 1][x].codepoint = ' ';
-                    panel->screen[panel->screen_height - 1][x].fg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].bg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].attrs = A_NORMAL;
-                }
+                scroll_screen_up(panel);
                 panel->cursor_y = panel->screen_height - 1;
             }
             break;
@@ -367,36 +344,14 @@ static void terminal_esc_dispatch(terminal_panel_t *panel, const uint8_t *interm
             if (panel->cursor_y > 0) {
                 panel->cursor_y--;
             } else {
-                // Scroll down
-                for (int y = panel->screen_height - 1; y > 0; y--) {
-                    memcpy(panel->screen[y], panel->screen[y - 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear first line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[0][x].codepoint = ' ';
-                    panel->screen[0][x].fg_color = -1;
-                    panel->screen[0][x].bg_color = -1;
-                    panel->screen[0][x].attrs = A_NORMAL;
-                }
+                scroll_screen_down(panel);
             }
             break;
         case 'E': // NEL - Next Line
             panel->cursor_x = 0;
             panel->cursor_y++;
             if (panel->cursor_y >= panel->screen_height) {
-                // Scroll up
-                for (int y = 0; y < panel->screen_height - 1; y++) {
-                    memcpy(panel->screen[y], panel->screen[y + 1], 
-                           panel->screen_width * sizeof(terminal_cell_t));
-                }
-                // Clear last line
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[panel->screen_height - 1][x].codepoint = ' ';
-                    panel->screen[panel->screen_height - 1][x].fg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].bg_color = -1;
-                    panel->screen[panel->screen_height - 1][x].attrs = A_NORMAL;
-                }
+                scroll_screen_up(panel);
                 panel->cursor_y = panel->screen_height - 1;
             }
             break;
@@ -404,17 +359,13 @@ static void terminal_esc_dispatch(terminal_panel_t *panel, const uint8_t *interm
             // Reset terminal state
             panel->fg_color = -1;
             panel->bg_color = -1;
-            panel->attrs = A_NORMAL;
+            panel->attrs = VTE_ATTR_NORMAL;
             panel->cursor_x = 0;
             panel->cursor_y = 0;
             // Clear screen
+            panel->cells_damaged = true;
             for (int y = 0; y < panel->screen_height; y++) {
-                for (int x = 0; x < panel->screen_width; x++) {
-                    panel->screen[y][x].codepoint = ' ';
-                    panel->screen[y][x].fg_color = -1;
-                    panel->screen[y][x].bg_color = -1;
-                    panel->screen[y][x].attrs = A_NORMAL;
-                }
+                erase_cells(panel, y, 0, panel->screen_width);
             }
             break;
     }
@@ -0,0 +1,393 @@
+#define _DEFAULT_SOURCE  // sysconf(), fdopen() and friends under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "toad.h"
+
+// Golden-screen conformance tests. Every <name>.in file in the case directory
+// is a raw terminal stream (recorded from vim, less, top and a shell, or
+// written to mirror vttest sections and an htop screen). It is replayed
+// through the same backend toad uses, vte_parser_feed() on a panel set up by
+// init_panel_screen(), and the final grid, cursor and styles are compared with
+// <name>.golden.
+//
+// Each stream is replayed once per read size in chunk_sizes[], and every
+// replay must produce the golden dump, so parser state carried across read
+// boundaries is covered too. Cases are spread across one forked worker per
+// CPU.
+//
+// Usage: test_golden [--update] [-j jobs] [case-dir]
+//
+// --update rewrites the .golden files from the first read size instead of
+// comparing; review the diff before committing it.
+
+#define GOLDEN_DIR "tests/golden"
+#define GOLDEN_COLUMNS 80
+#define GOLDEN_ROWS 24
+#define MAX_CASES 4096
+#define MAX_DUMP (256 * 1024)
+
+// Read sizes: just under what a pty read delivers, a larger pipe-sized read,
+// one byte at a time, which splits every sequence and UTF-8 character, and
+// the whole stream at once (0)
+static const size_t chunk_sizes[] = { BUFFER_SIZE - 1, 4096, 1, 0 };
+#define CHUNK_VARIANTS (sizeof(chunk_sizes) / sizeof(chunk_sizes[0]))
+
+typedef struct {
+    char name[256];
+    unsigned char *data;
+    size_t len;
+} golden_case_t;
+
+static golden_case_t cases[MAX_CASES];
+static int case_count = 0;
+static const char *case_dir = GOLDEN_DIR;
+
+static unsigned char *read_file(const char *path, size_t *len_out) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    size_t capacity = 4096, len = 0;
+    unsigned char *data = malloc(capacity);
+    size_t n;
+    while (data && (n = fread(data + len, 1, capacity - len, file)) > 0) {
+        len += n;
+        if (len == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    fclose(file);
+
+    *len_out = len;
+    return data;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(((const golden_case_t *)a)->name, ((const golden_case_t *)b)->name);
+}
+
+static bool load_cases(void) {
+    DIR *dir = opendir(case_dir);
+    if (!dir) {
+        fprintf(stderr, "test_golden: cannot open %s\n", case_dir);
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && case_count < MAX_CASES) {
+        size_t len = strlen(entry->d_name);
+        if (len < 4 || len - 3 >= sizeof(cases[0].name) || strcmp(entry->d_name + len - 3, ".in") != 0) {
+            continue;
+        }
+        golden_case_t *golden = &cases[case_count];
+        memcpy(golden->name, entry->d_name, len - 3);
+        golden->name[len - 3] = '\0';
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", case_dir, entry->d_name);
+        golden->data = read_file(path, &golden->len);
+        if (!golden->data) {
+            fprintf(stderr, "test_golden: cannot read %s\n", path);
+            continue;
+        }
+        case_count++;
+    }
+    closedir(dir);
+
+    qsort(cases, case_count, sizeof(cases[0]), compare_names);
+    return true;
+}
+
+// Symbolic attribute names keep the dumps independent of how the backend
+// encodes attributes
+static void append_attrs(char *out, size_t size, int attrs) {
+    static const struct { int bit; const char *name; } names[] = {
+        { VTE_ATTR_BOLD, "bold" }, { VTE_ATTR_DIM, "dim" }, { VTE_ATTR_ITALIC, "italic" },
+        { VTE_ATTR_UNDERLINE, "underline" }, { VTE_ATTR_BLINK, "blink" },
+        { VTE_ATTR_REVERSE, "reverse" }, { VTE_ATTR_HIDDEN, "hidden" },
+        { VTE_ATTR_STRIKE, "strike" },
+    };
+
+    size_t len = strlen(out);
+    bool first = true;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (attrs & names[i].bit) {
+            len += snprintf(out + len, size - len, "%s%s", first ? " " : ",", names[i].name);
+            attrs &= ~names[i].bit;
+            first = false;
+        }
+    }
+    if (attrs) {
+        snprintf(out + len, size - len, "%s0x%x", first ? " " : ",", (unsigned)attrs);
+    }
+}
+
+static size_t encode_cell(uint32_t codepoint, char *out) {
+    if (codepoint < 0x20 || codepoint == 0x7F) {
+        out[0] = '?';
+        return 1;
+    }
+    return vte_utf8_encode(codepoint, out);
+}
+
+static bool default_style(const terminal_cell_t *cell) {
+    return cell->fg_color == -1 && cell->bg_color == -1 && cell->attrs == VTE_ATTR_NORMAL;
+}
+
+static bool same_style(const terminal_cell_t *a, const terminal_cell_t *b) {
+    return a->fg_color == b->fg_color && a->bg_color == b->bg_color && a->attrs == b->attrs;
+}
+
+// Dump format: size and cursor, one |row| line per screen row, then one line
+// per run of cells whose colors or attributes are not the defaults
+static size_t dump_panel(const terminal_panel_t *panel, char *out, size_t size) {
+    size_t len = 0;
+    len += snprintf(out + len, size - len, "size %dx%d\ncursor %d,%d\n",
+                    panel->screen_width, panel->screen_height, panel->cursor_x, panel->cursor_y);
+
+    for (int y = 0; y < panel->screen_height && len + 8 < size; y++) {
+        out[len++] = '|';
+        for (int x = 0; x < panel->screen_width && len + 8 < size; x++) {
+            len += encode_cell(panel->screen[y][x].codepoint, out + len);
+        }
+        out[len++] = '|';
+        out[len++] = '\n';
+    }
+
+    len += snprintf(out + len, size - len, "styles\n");
+    for (int y = 0; y < panel->screen_height; y++) {
+        const terminal_cell_t *row = panel->screen[y];
+        int x = 0;
+        while (x < panel->screen_width) {
+            if (default_style(&row[x])) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < panel->screen_width && same_style(&row[x], &row[start])) {
+                x++;
+            }
+            char line[160];
+            snprintf(line, sizeof(line), "%d:%d-%d fg=%d bg=%d", y, start, x - 1,
+                     row[start].fg_color, row[start].bg_color);
+            append_attrs(line, sizeof(line), row[start].attrs);
+            if (len + strlen(line) + 2 < size) {
+                len += snprintf(out + len, size - len, "%s\n", line);
+            }
+        }
+    }
+    return len;
+}
+
+static size_t replay_case(const golden_case_t *golden, size_t chunk, char *out, size_t size) {
+    terminal_panel_t panel;
+    memset(&panel, 0, sizeof(panel));
+    panel.master_fd = -1;
+    panel.width = GOLDEN_COLUMNS + 2;
+    panel.height = GOLDEN_ROWS + 2;
+    init_panel_screen(&panel);
+
+    if (chunk == 0) {
+        chunk = golden->len;
+    }
+    for (size_t off = 0; off < golden->len; off += chunk) {
+        size_t len = golden->len - off < chunk ? golden->len - off : chunk;
+        vte_parser_feed(&panel, (const char *)golden->data + off, len);
+    }
+
+    size_t len = dump_panel(&panel, out, size);
+    free_panel_screen(&panel);
+    return len;
+}
+
+// Report the first differing line so a failure is readable without a diff tool
+static void report_mismatch(const golden_case_t *golden, size_t chunk,
+                            const char *expected, size_t expected_len,
+                            const char *actual, size_t actual_len) {
+    int line = 1;
+    size_t e = 0, a = 0;
+    while (e < expected_len && a < actual_len) {
+        size_t e_end = e, a_end = a;
+        while (e_end < expected_len && expected[e_end] != '\n') e_end++;
+        while (a_end < actual_len && actual[a_end] != '\n') a_end++;
+        if (e_end - e != a_end - a || memcmp(expected + e, actual + a, e_end - e) != 0) {
+            break;
+        }
+        e = e_end + 1;
+        a = a_end + 1;
+        line++;
+    }
+
+    int e_len = 0, a_len = 0;
+    while (e + e_len < expected_len && expected[e + e_len] != '\n') e_len++;
+    while (a + a_len < actual_len && actual[a + a_len] != '\n') a_len++;
+    fprintf(stderr, "❌ %s (read size %zu): line %d differs\n  expected: %.*s\n  actual:   %.*s\n",
+            golden->name, chunk ? chunk : golden->len, line,
+            e < expected_len ? e_len : 0, e < expected_len ? expected + e : "",
+            a < actual_len ? a_len : 0, a < actual_len ? actual + a : "");
+}
+
+// Returns the number of failing replays of one case
+static int check_case(const golden_case_t *golden, char *buffer) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.golden", case_dir, golden->name);
+    size_t expected_len = 0;
+    char *expected = (char *)read_file(path, &expected_len);
+    if (!expected) {
+        fprintf(stderr, "❌ %s: missing %s (run with --update)\n", golden->name, path);
+        return CHUNK_VARIANTS;
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < CHUNK_VARIANTS; i++) {
+        size_t len = replay_case(golden, chunk_sizes[i], buffer, MAX_DUMP);
+        if (len != expected_len || memcmp(buffer, expected, len) != 0) {
+            report_mismatch(golden, chunk_sizes[i], expected, expected_len, buffer, len);
+            failures++;
+        }
+    }
+    free(expected);
+    return failures;
+}
+
+static bool update_case(const golden_case_t *golden, char *buffer) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.golden", case_dir, golden->name);
+    size_t len = replay_case(golden, chunk_sizes[0], buffer, MAX_DUMP);
+
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(buffer, 1, len, file) != len) {
+        fprintf(stderr, "test_golden: cannot write %s\n", path);
+        if (file) {
+            fclose(file);
+        }
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+// Worker: checks every jobs-th case starting at index and writes one status
+// byte per case (0 = pass) to the pipe
+static void run_worker(int index, int jobs, int fd) {
+    char *buffer = malloc(MAX_DUMP);
+    for (int i = index; i < case_count; i += jobs) {
+        unsigned char status = check_case(&cases[i], buffer) ? 1 : 0;
+        if (write(fd, &status, 1) != 1) {
+            break;
+        }
+    }
+    free(buffer);
+    close(fd);
+}
+
+int main(int argc, char **argv) {
+    bool update = false;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else {
+            case_dir = argv[i];
+        }
+    }
+
+    if (!load_cases()) {
+        return 1;
+    }
+    if (case_count == 0) {
+        fprintf(stderr, "test_golden: no .in cases in %s\n", case_dir);
+        return 1;
+    }
+
+    if (update) {
+        char *buffer = malloc(MAX_DUMP);
+        int written = 0;
+        for (int i = 0; i < case_count; i++) {
+            written += update_case(&cases[i], buffer);
+        }
+        free(buffer);
+        printf("Updated %d of %d golden dumps in %s\n", written, case_count, case_dir);
+        return written == case_count ? 0 : 1;
+    }
+
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    if (jobs > case_count) {
+        jobs = case_count;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int pipes[jobs];
+    pid_t pids[jobs];
+    fflush(stdout);
+    for (int w = 0; w < jobs; w++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+        pids[w] = fork();
+        if (pids[w] < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pids[w] == 0) {
+            close(fds[0]);
+            run_worker(w, jobs, fds[1]);
+            _exit(0);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+    }
+
+    // Collect statuses in case order so the report does not depend on timing
+    int passed = 0, failed = 0, lost = 0;
+    unsigned char status[MAX_CASES];
+    memset(status, 2, sizeof(status));
+    for (int w = 0; w < jobs; w++) {
+        for (int i = w; i < case_count; i += jobs) {
+            if (read(pipes[w], &status[i], 1) != 1) {
+                status[i] = 2;
+            }
+        }
+        close(pipes[w]);
+        waitpid(pids[w], NULL, 0);
+    }
+    for (int i = 0; i < case_count; i++) {
+        if (status[i] == 0) {
+            passed++;
+        } else if (status[i] == 1) {
+            failed++;
+        } else {
+            fprintf(stderr, "❌ %s: worker died\n", cases[i].name);
+            lost++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Golden screens: %d/%d cases passed (%zu read sizes each, %d workers, %.2fs)\n",
+           passed, case_count, CHUNK_VARIANTS, jobs, elapsed);
+
+    for (int i = 0; i < case_count; i++) {
+        free(cases[i].data);
+    }
+    return (failed || lost) ? 1 : 0;
+}
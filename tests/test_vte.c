@@ -3,6 +3,11 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "vte/vte_parser.h"
+#include "vte/vte_screen.h"
+#include "vte/vte_capture.h"
+#include "vte/vte_grid.h"
+#include "vte/vte_kernels.h"
+#include "toad.h"
 
 // Test counters
 static int tests_run = 0;
@@ -366,8 +371,10 @@ int test_line_operations() {
     // Go to line 2 and insert a line
     parse_input("\033[2H\033[1L");
     
-    // Line 2 should now be empty, Line 3 should have "Line2"
-    if (test_screen[1][0].codepoint != ' ' || test_screen[2][0].codepoint != 'L') {
+    // Line 2 should now be empty, Line 3 should have "Line2"; lines move by
+    // row pointer, so they are read through the panel
+    terminal_cell_t **screen = test_panel.screen;
+    if (screen[1][0].codepoint != ' ' || screen[2][0].codepoint != 'L') {
         cleanup_test();
         return 0;
     }
@@ -376,7 +383,7 @@ int test_line_operations() {
     parse_input("\033[1M");
     
     // Line 2 should now have "Line2" again
-    if (test_screen[1][0].codepoint != 'L' || test_screen[1][4].codepoint != '2') {
+    if (screen[1][0].codepoint != 'L' || screen[1][4].codepoint != '2') {
         cleanup_test();
         return 0;
     }
@@ -585,10 +592,868 @@ int test_extended_colors() {
     return 1;
 }
 
+int test_screen_api() {
+    vte_screen_t *screen = vte_screen_new(20, 4);
+    if (!screen) {
+        return 0;
+    }
+    
+    const char *input = "plain \033[1;31mred\033[0m tail\r\n\xe2\x94\x80x";
+    vte_screen_feed(screen, input, strlen(input));
+    
+    char text[64];
+    vte_screen_row_text(screen, 0, text, sizeof(text));
+    int ok = strcmp(text, "plain red tail") == 0;
+    
+    // Row 0: default "plain ", bold red "red", default rest of the row
+    vte_style_run_t runs[8];
+    size_t count = vte_screen_row_runs(screen, 0, runs, 8);
+    ok = ok && count == 3;
+    ok = ok && runs[1].start == 6 && runs[1].end == 9;
+    ok = ok && runs[1].fg_color == VTE_COLOR_RED && runs[1].attrs == VTE_ATTR_BOLD;
+    ok = ok && runs[2].end == 20 && runs[2].fg_color == VTE_COLOR_DEFAULT;
+    
+    vte_screen_row_text(screen, 1, text, sizeof(text));
+    ok = ok && strcmp(text, "\xe2\x94\x80x") == 0;
+    
+    int x, y;
+    vte_screen_cursor(screen, &x, &y);
+    ok = ok && x == 2 && y == 1 && vte_screen_row(screen, 4) == NULL;
+    
+    vte_screen_reset(screen);
+    vte_screen_row_text(screen, 0, text, sizeof(text));
+    ok = ok && text[0] == '\0';
+    
+    vte_screen_free(screen);
+    return ok;
+}
+
+int test_scrollback_capture() {
+    vte_screen_t *screen = vte_screen_new(10, 2);
+    if (!screen || !vte_screen_set_scrollback(screen, 3)) {
+        vte_screen_free(screen);
+        return 0;
+    }
+    
+    // Five lines through a two row screen: "one" and "two" are pushed out of
+    // the three line history by the time the last line is printed
+    const char *input = "one\r\ntwo\r\n\033[1;31mred\033[0m\r\n<a&b>\r\nfive\r\nsix";
+    vte_screen_feed(screen, input, strlen(input));
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    int ok = vte_scrollback_count(&panel->scrollback) == 3;
+    
+    size_t len;
+    char *text = vte_capture_string(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, VTE_CAPTURE_TEXT, &len);
+    ok = ok && text && strcmp(text, "two\nred\n<a&b>\nfive\nsix\n") == 0 && len == strlen(text);
+    free(text);
+    
+    // Negative lines count back from the screen: -2 is "red", -1 is "<a&b>"
+    char *ansi = vte_capture_string(panel, -2, -2, VTE_CAPTURE_ANSI, NULL);
+    ok = ok && ansi && strcmp(ansi, "\033[0;1;31mred\033[0m\n") == 0;
+    free(ansi);
+    
+    char *html = vte_capture_string(panel, -1, 0, VTE_CAPTURE_HTML, NULL);
+    ok = ok && html && strstr(html, "&lt;a&amp;b&gt;\nfive\n</pre>") != NULL;
+    free(html);
+    
+    // Popping takes the newest line back out, padded to the row width
+    terminal_cell_t row[8];
+    ok = ok && vte_scrollback_pop(&panel->scrollback, row, 8) &&
+         row[0].codepoint == '<' && row[4].codepoint == '>' && row[7].codepoint == ' ' &&
+         vte_scrollback_count(&panel->scrollback) == 2;
+    
+    // ED 3 clears the history along with the screen
+    vte_screen_feed(screen, "\033[3J", 4);
+    ok = ok && vte_scrollback_count(&panel->scrollback) == 0;
+    
+    vte_screen_free(screen);
+    return ok;
+}
+
+int test_cell_damage() {
+    vte_screen_t *screen = vte_screen_new(20, 5);
+    if (!screen) {
+        return 0;
+    }
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    
+    // Printing damages cells
+    vte_screen_feed(screen, "hi", 2);
+    int ok = panel->cells_damaged;
+    
+    // Cursor movement, SGR and carriage return leave the cells alone
+    panel->cells_damaged = false;
+    const char *moves = "\033[3;4H\033[A\033[2C\033[1;31m\r\b";
+    vte_screen_feed(screen, moves, strlen(moves));
+    ok = ok && !panel->cells_damaged;
+    
+    // Erasing does damage them, and so does a line feed that scrolls
+    vte_screen_feed(screen, "\033[K", 3);
+    ok = ok && panel->cells_damaged;
+    panel->cells_damaged = false;
+    vte_screen_feed(screen, "\033[5;1H\n", 7);
+    ok = ok && panel->cells_damaged;
+    
+    vte_screen_free(screen);
+    return ok;
+}
+
+int test_packed_history() {
+    vte_screen_t *screen = vte_screen_new(12, 2);
+    if (!screen || !vte_screen_set_scrollback(screen, 4)) {
+        vte_screen_free(screen);
+        return 0;
+    }
+    
+    // Wrap the ring so the oldest line is not in slot 0, with styles, wide
+    // codepoints and an empty line in the history
+    const char *input = "a\r\nb\r\n\033[1;38;5;200;44mstyled\033[0m x\r\n\r\n"
+                        "\xe6\xbc\xa2\xe5\xad\x97 ok\r\nlast\r\nscreen";
+    vte_screen_feed(screen, input, strlen(input));
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    char *before = vte_capture_string(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, VTE_CAPTURE_ANSI, NULL);
+    
+    int ok = vte_scrollback_pack(&panel->scrollback) && vte_scrollback_is_packed(&panel->scrollback);
+    ok = ok && vte_scrollback_count(&panel->scrollback) == 4 && panel->scrollback.packed_size < 64;
+    ok = ok && vte_scrollback_unpack(&panel->scrollback) && !vte_scrollback_is_packed(&panel->scrollback);
+    char *after = vte_capture_string(panel, VTE_CAPTURE_FIRST, VTE_CAPTURE_LAST, VTE_CAPTURE_ANSI, NULL);
+    ok = ok && before && after && strcmp(before, after) == 0;
+    free(before);
+    free(after);
+    
+    // Scrolling into a packed history unpacks it first
+    ok = ok && vte_scrollback_pack(&panel->scrollback);
+    vte_screen_feed(screen, "\r\nmore", 6);
+    terminal_cell_t newest[12];
+    int len = vte_scrollback_line(&panel->scrollback, 3, newest, 12);
+    ok = ok && !vte_scrollback_is_packed(&panel->scrollback) && len == 4 &&
+         newest[0].codepoint == 'l';
+    
+    // Screen rows round-trip through vte_pack_rows(), blanks restored
+    terminal_cell_t saved[2][12];
+    terminal_cell_t *rows[2] = { saved[0], saved[1] };
+    size_t size;
+    uint8_t *data = vte_pack_rows(panel->screen, 2, 12, &size);
+    ok = ok && data && vte_unpack_rows(data, size, rows, 2, 12);
+    for (int y = 0; ok && y < 2; y++) {
+        ok = memcmp(saved[y], panel->screen[y], sizeof(saved[y])) == 0;
+    }
+    free(data);
+    
+    vte_screen_free(screen);
+    return ok;
+}
+
+static char query_replies[128];
+
+static void collect_reply(terminal_panel_t *panel, const char *data, size_t len) {
+    (void)panel;
+    size_t used = strlen(query_replies);
+    if (used + len < sizeof(query_replies)) {
+        memcpy(query_replies + used, data, len);
+        query_replies[used + len] = '\0';
+    }
+}
+
+int test_query_replies() {
+    vte_screen_t *screen = vte_screen_new(20, 5);
+    if (!screen) {
+        return 0;
+    }
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    
+    // Without a reply hook queries are ignored
+    vte_screen_feed(screen, "\033[6n", 4);
+    
+    // Status, cursor position, primary and secondary device attributes;
+    // DECXCPR (CSI ? 6 n) is not answered
+    panel->reply = collect_reply;
+    query_replies[0] = '\0';
+    const char *queries = "\033[3;7H\033[5n\033[6n\033[?6n\033[c\033[>c";
+    vte_screen_feed(screen, queries, strlen(queries));
+    int ok = strcmp(query_replies, "\033[0n\033[3;7R\033[?1;2c\033[>0;0;0c") == 0;
+    ok = ok && !panel->cells_damaged;
+    
+    vte_screen_free(screen);
+    return ok;
+}
+
+// Copy data into the free space of an input ring
+static void fill_input(vte_input_t *input, const char *data, size_t len) {
+    struct iovec iov[2];
+    int count = vte_input_space(input, len, iov);
+    size_t off = 0;
+    for (int i = 0; i < count; i++) {
+        memcpy(iov[i].iov_base, data + off, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    vte_input_commit(input, off);
+}
+
+int test_input_ring() {
+    vte_screen_t *screen = vte_screen_new(20, 5);
+    vte_input_t input;
+    if (!screen || !vte_input_init(&input, 10)) {
+        vte_screen_free(screen);
+        return 0;
+    }
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    
+    // Rounded up to a power of two, and never more than that is pending
+    int ok = input.size == 16;
+    fill_input(&input, "0123456789abc", 13);
+    ok = ok && vte_input_parse(&input, panel) == 13 && vte_input_pending(&input) == 0;
+    struct iovec iov[2];
+    ok = ok && vte_input_space(&input, 64, iov) == 2 && iov[0].iov_len + iov[1].iov_len == 16;
+    
+    // A euro sign and a CJK character across the wrap point
+    fill_input(&input, "\xe2\x82\xac\xe6\xbc\xa2", 6);
+    ok = ok && vte_input_parse(&input, panel) == 6;
+    ok = ok && panel->screen[0][13].codepoint == 0x20AC && panel->screen[0][14].codepoint == 0x6F22;
+    
+    // A character split between two reads waits for its last byte
+    fill_input(&input, "\xe2\x82", 2);
+    vte_input_parse(&input, panel);
+    ok = ok && panel->cursor_x == 15;
+    fill_input(&input, "\xac!", 2);
+    vte_input_parse(&input, panel);
+    ok = ok && panel->screen[0][15].codepoint == 0x20AC && panel->screen[0][16].codepoint == '!';
+    
+    // Discarded output is never parsed
+    fill_input(&input, "zz", 2);
+    vte_input_discard(&input);
+    ok = ok && vte_input_parse(&input, panel) == 0 && panel->cursor_x == 17;
+    
+    vte_input_free(&input);
+    vte_screen_free(screen);
+    return ok;
+}
+
+// A focused panel's reads wait in its ring until the frame; a flush
+// reported before then (TIOCPKT_FLUSHWRITE) drops all of them
+int test_flush_write() {
+    vte_screen_t *screen = vte_screen_new(20, 5);
+    vte_input_t input;
+    if (!screen || !vte_input_init(&input, 64)) {
+        vte_screen_free(screen);
+        return 0;
+    }
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    
+    fill_input(&input, "$ ", 2);
+    int ok = vte_input_parse(&input, panel) == 2;
+    
+    // Two reads of a flood, then ^C flushes the output
+    fill_input(&input, "flood\r\n", 7);
+    fill_input(&input, "flood\r\n", 7);
+    ok = ok && vte_input_pending(&input) == 14;
+    vte_input_discard(&input);
+    fill_input(&input, "^C", 2);
+    ok = ok && vte_input_parse(&input, panel) == 2;
+    ok = ok && panel->cursor_y == 0 && panel->cursor_x == 4;
+    ok = ok && panel->screen[0][2].codepoint == '^' && panel->screen[1][0].codepoint == ' ';
+    
+    vte_input_free(&input);
+    vte_screen_free(screen);
+    return ok;
+}
+
+int test_parser_iov() {
+    vte_screen_t *whole = vte_screen_new(20, 5);
+    vte_screen_t *split = vte_screen_new(20, 5);
+    if (!whole || !split) {
+        vte_screen_free(whole);
+        vte_screen_free(split);
+        return 0;
+    }
+    
+    // A CSI, a UTF-8 character and an OSC each split over segments, with an
+    // empty segment among them
+    const char *input = "\033[1;31mred\xe2\x82\xac\033]0;title\007\033[2;5Hx";
+    vte_screen_feed(whole, input, strlen(input));
+    struct iovec iov[] = {
+        { (void *)input, 1 }, { (void *)(input + 1), 3 }, { (void *)(input + 4), 0 },
+        { (void *)(input + 4), 5 }, { (void *)(input + 9), 1 }, { (void *)(input + 10), 1 },
+        { (void *)(input + 11), 6 }, { (void *)(input + 17), strlen(input) - 17 },
+    };
+    vte_screen_feed_iov(split, iov, sizeof(iov) / sizeof(iov[0]));
+    
+    terminal_panel_t *a = vte_screen_panel(whole);
+    terminal_panel_t *b = vte_screen_panel(split);
+    int ok = a->screen[0][3].codepoint == 0x20AC && a->cursor_x == 5 && a->cursor_y == 1;
+    ok = ok && b->cursor_x == a->cursor_x && b->cursor_y == a->cursor_y;
+    for (int y = 0; ok && y < 5; y++) {
+        ok = memcmp(a->screen[y], b->screen[y], sizeof(terminal_cell_t) * 20) == 0;
+    }
+    
+    vte_screen_free(whole);
+    vte_screen_free(split);
+    return ok;
+}
+
+int test_grid_layouts() {
+    vte_grid_t grids[3];
+    for (int i = 0; i < 3; i++) {
+        if (!vte_grid_init(&grids[i], (vte_grid_layout_t)i, 8, 4)) {
+            while (i-- > 0) {
+                vte_grid_free(&grids[i]);
+            }
+            return 0;
+        }
+    }
+    
+    terminal_cell_t row[8];
+    for (int x = 0; x < 8; x++) {
+        row[x] = (terminal_cell_t){ "grep foo"[x], VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+    }
+    row[5] = (terminal_cell_t){ 'f', 196, VTE_COLOR_BLUE, VTE_ATTR_BOLD | VTE_ATTR_UNDERLINE };
+    static const uint32_t needle[] = { 'f', 'o', 'o' };
+    
+    int ok = 1;
+    for (int i = 0; i < 3 && ok; i++) {
+        vte_grid_t *grid = &grids[i];
+        vte_grid_store_row(grid, 1, row);
+        terminal_cell_t back[8];
+        vte_grid_load_row(grid, 1, back);
+        ok = memcmp(back, row, sizeof(row)) == 0;
+        ok = ok && vte_grid_row_blank(grid, 0) && !vte_grid_row_blank(grid, 1);
+        ok = ok && vte_grid_find(grid, 1, 0, needle, 3) == 5 && vte_grid_find(grid, 1, 6, needle, 3) == -1;
+        
+        // Scrolling rotates rows and blanks what comes in
+        vte_grid_scroll(grid, 0, 3, 1);
+        ok = ok && vte_grid_find(grid, 0, 0, needle, 3) == 5 && vte_grid_row_blank(grid, 3);
+        vte_grid_scroll(grid, 0, 3, -2);
+        ok = ok && vte_grid_row_blank(grid, 0) && vte_grid_row_blank(grid, 1);
+        ok = ok && vte_grid_find(grid, 2, 0, needle, 3) == 5;
+    }
+    
+    // Rows compare across layouts; one changed style is a difference
+    ok = ok && vte_grid_rows_equal(&grids[0], 2, &grids[1], 2) &&
+         vte_grid_rows_equal(&grids[1], 2, &grids[2], 2);
+    terminal_cell_t cell = row[5];
+    cell.attrs = VTE_ATTR_BOLD;
+    vte_grid_set(&grids[1], 5, 2, &cell);
+    ok = ok && !vte_grid_rows_equal(&grids[0], 2, &grids[1], 2) &&
+         !vte_grid_rows_equal(&grids[1], 2, &grids[2], 2);
+    
+    for (int i = 0; i < 3; i++) {
+        vte_grid_free(&grids[i]);
+    }
+    return ok;
+}
+
+int test_grid_adaptive() {
+    vte_grid_t grid, reference;
+    if (!vte_grid_init(&grid, VTE_GRID_ADAPTIVE, 8, 2)) {
+        return 0;
+    }
+    if (!vte_grid_init(&reference, VTE_GRID_AOS, 8, 2)) {
+        vte_grid_free(&grid);
+        return 0;
+    }
+    size_t compact = vte_grid_memory(&grid);
+    
+    // ASCII stays compact up to VTE_GRID_RUNS style runs; one more upgrades
+    terminal_cell_t cell = { 'x', VTE_COLOR_RED, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+    int ok = 1;
+    for (int x = 0; x < 6; x += 2) {
+        ok = ok && vte_grid_row_compact(&grid, 0);
+        vte_grid_set(&grid, x, 0, &cell);
+        vte_grid_set(&reference, x, 0, &cell);
+    }
+    ok = ok && !vte_grid_row_compact(&grid, 0) && vte_grid_rows_equal(&grid, 0, &reference, 0);
+    
+    // Filling the whole row makes it compact again, and writing a style back
+    // merges its runs
+    vte_grid_fill(&grid, 0, 0, 8, '-', vte_grid_style(VTE_COLOR_RED, VTE_COLOR_DEFAULT, 0));
+    vte_grid_fill(&grid, 0, 2, 4, '=', 0);
+    vte_grid_fill(&grid, 0, 2, 4, '-', vte_grid_style(VTE_COLOR_RED, VTE_COLOR_DEFAULT, 0));
+    ok = ok && vte_grid_row_compact(&grid, 0) && grid.lines[0]->run_count == 1 &&
+         vte_grid_memory(&grid) == compact;
+    
+    // A non-ASCII codepoint upgrades the row, and clearing it downgrades it
+    cell = (terminal_cell_t){ 0x6F22, VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+    vte_grid_set(&grid, 3, 1, &cell);
+    vte_grid_set(&reference, 3, 1, &cell);
+    ok = ok && !vte_grid_row_compact(&grid, 1) && vte_grid_row_compact(&grid, 0) &&
+         vte_grid_rows_equal(&grid, 1, &reference, 1) && vte_grid_memory(&grid) > compact;
+    vte_grid_scroll(&grid, 0, 1, -1);
+    ok = ok && vte_grid_row_compact(&grid, 0) && vte_grid_row_blank(&grid, 0) &&
+         vte_grid_memory(&grid) == compact;
+    
+    // Storing a row picks the form that fits
+    terminal_cell_t row[8];
+    vte_grid_load_row(&reference, 1, row);
+    vte_grid_store_row(&grid, 0, row);
+    ok = ok && !vte_grid_row_compact(&grid, 0) && vte_grid_rows_equal(&grid, 0, &reference, 1);
+    row[3].codepoint = 'k';
+    vte_grid_store_row(&grid, 0, row);
+    ok = ok && vte_grid_row_compact(&grid, 0) && vte_grid_memory(&grid) == compact;
+    
+    // Rows compare with terminal cells in either form, styles included, and
+    // give the span of columns that differ
+    int x0 = -1, x1 = -1;
+    ok = ok && !vte_grid_row_diff(&grid, 0, row, &x0, &x1) && x0 == -1;
+    row[5].attrs = VTE_ATTR_BOLD;
+    ok = ok && vte_grid_row_diff(&grid, 0, row, &x0, &x1) && x0 == 5 && x1 == 6;
+    row[1].codepoint = 'q';
+    ok = ok && vte_grid_row_diff(&grid, 0, row, &x0, &x1) && x0 == 1 && x1 == 6;
+    vte_grid_load_row(&reference, 1, row);
+    ok = ok && !vte_grid_row_diff(&reference, 1, row, &x0, &x1);
+    ok = ok && vte_grid_row_diff(&grid, 0, row, &x0, &x1) && x0 == 3 && x1 == 4;
+    row[7].fg_color = VTE_COLOR_RED;
+    ok = ok && vte_grid_row_diff(&reference, 1, row, &x0, &x1) && x0 == 7 && x1 == 8;
+    
+    vte_grid_free(&grid);
+    vte_grid_free(&reference);
+    return ok;
+}
+
+int test_cell_kernels() {
+    // Every implementation against scalar over lengths around the vector
+    // widths, with the odd cell at each position
+    terminal_cell_t cells[40], other[40], filled[40], wide[40];
+    uint32_t values[40], changed[40];
+    size_t expect_nonblank[41], expect_trim[41], expect_diff[41], expect_find[41];
+    
+    int ok = vte_kernels_select("scalar");
+    for (int pass = 0; pass < 2 && ok; pass++) {
+        const char *const *names = vte_kernels_available();
+        for (int n = 0; names[n] && ok; n++) {
+            if (pass == 1) {
+                ok = vte_kernels_select(names[n]);
+            }
+            for (size_t odd = 0; odd < 40 && ok; odd++) {
+                for (size_t i = 0; i < 40; i++) {
+                    cells[i] = VTE_BLANK_CELL;
+                    values[i] = i;
+                }
+                cells[odd].attrs = VTE_ATTR_BOLD;
+                memcpy(other, cells, sizeof(cells));
+                other[odd].attrs = VTE_ATTR_NORMAL;
+                memcpy(changed, values, sizeof(values));
+                changed[odd] = 1000;
+                
+                size_t count = odd + 1;
+                size_t nonblank = vte_kernel->find_nonblank_cells(cells, count);
+                size_t trim = vte_kernel->trim_blank_cells(cells, 40 - odd);
+                size_t diff = vte_kernel->first_diff_cells(cells, other, count) +
+                              vte_kernel->first_diff_u32(values, changed, 40 - odd);
+                size_t find = vte_kernel->find_u32(values, count, odd / 2);
+                if (pass == 0) {
+                    expect_nonblank[odd] = nonblank;
+                    expect_trim[odd] = trim;
+                    expect_diff[odd] = diff;
+                    expect_find[odd] = find;
+                } else {
+                    ok = nonblank == expect_nonblank[odd] && trim == expect_trim[odd] &&
+                         diff == expect_diff[odd] && find == expect_find[odd];
+                }
+                
+                // Non-ASCII found wherever it is, and only within count
+                memcpy(wide, cells, sizeof(cells));
+                wide[odd].codepoint = odd % 2 ? 0x80 : 0x10FFFF;
+                ok = ok && !vte_kernel->ascii_only(wide, count) && vte_kernel->ascii_only(wide, odd);
+                
+                // Fills stop exactly at count
+                memcpy(filled, other, sizeof(other));
+                vte_kernel->fill_cells(filled, count, cells[odd]);
+                vte_kernel->fill_u32(changed, count, 0xFFFFFFFF);
+                ok = ok && memcmp(&filled[count - 1], &cells[odd], sizeof(cells[odd])) == 0 &&
+                     (count == 40 || memcmp(&filled[count], &other[count], sizeof(other[count])) == 0) &&
+                     changed[count - 1] == 0xFFFFFFFF && (count == 40 || changed[count] != 0xFFFFFFFF);
+            }
+            if (pass == 0) {
+                break;
+            }
+        }
+    }
+    // Back to the best one
+    const char *const *names = vte_kernels_available();
+    int best = 0;
+    while (names[best + 1]) {
+        best++;
+    }
+    vte_kernels_select(names[best]);
+    return ok;
+}
+
+int test_row_hash() {
+    terminal_cell_t a[12], b[12];
+    for (int x = 0; x < 12; x++) {
+        a[x] = (terminal_cell_t){ "top - 10:00 "[x], VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+    }
+    memcpy(b, a, sizeof(a));
+    
+    // Same cells hash the same; any text, color or attribute change differs
+    int ok = vte_hash_cells(a, 12) == vte_hash_cells(b, 12);
+    ok = ok && vte_hash_cells(a, 12) != vte_hash_cells(a, 11);
+    b[10].codepoint = '1';
+    ok = ok && vte_hash_cells(a, 12) != vte_hash_cells(b, 12);
+    b[10] = a[10];
+    b[3].fg_color = VTE_COLOR_RED;
+    ok = ok && vte_hash_cells(a, 12) != vte_hash_cells(b, 12);
+    b[3] = a[3];
+    b[3].attrs = VTE_ATTR_REVERSE;
+    ok = ok && vte_hash_cells(a, 12) != vte_hash_cells(b, 12);
+    
+    // Whichever kernels are selected
+    uint64_t hash = vte_hash_cells(a, 12);
+    const char *const *names = vte_kernels_available();
+    for (int n = 0; names[n] && ok; n++) {
+        ok = vte_kernels_select(names[n]) && vte_hash_cells(a, 12) == hash;
+    }
+    return ok;
+}
+
+int test_scrollback_dedup() {
+    vte_scrollback_t history;
+    if (!vte_scrollback_init(&history, 4)) {
+        return 0;
+    }
+    terminal_cell_t plain[8], bold[8], row[8];
+    for (int x = 0; x < 8; x++) {
+        plain[x] = (terminal_cell_t){ "$ make  "[x], VTE_COLOR_DEFAULT, VTE_COLOR_DEFAULT, VTE_ATTR_NORMAL };
+    }
+    memcpy(bold, plain, sizeof(plain));
+    bold[2].attrs = VTE_ATTR_BOLD;
+    
+    // The same text in another style is another line; both are ASCII in a
+    // few style runs, so they are stored compact
+    size_t plain_bytes = sizeof(vte_grid_run_t) + 6;
+    size_t bold_bytes = 3 * sizeof(vte_grid_run_t) + 6;
+    vte_scrollback_push(&history, plain, 8);
+    vte_scrollback_push(&history, bold, 8);
+    vte_scrollback_push(&history, plain, 8);
+    size_t referenced, stored;
+    vte_scrollback_memory(&history, &referenced, &stored);
+    int ok = history.unique == 2 && referenced == 18 * sizeof(terminal_cell_t) &&
+             stored == plain_bytes + bold_bytes;
+    
+    // Evicting one copy keeps the line for the others
+    vte_scrollback_push(&history, plain, 8);
+    vte_scrollback_push(&history, plain, 8);
+    terminal_cell_t line[8];
+    int len = vte_scrollback_line(&history, 0, line, 8);
+    ok = ok && vte_scrollback_count(&history) == 4 && history.unique == 2 &&
+         len == 6 && memcmp(line, bold, 6 * sizeof(terminal_cell_t)) == 0;
+    vte_scrollback_push(&history, plain, 8);
+    len = vte_scrollback_line(&history, 0, line, 8);
+    ok = ok && history.unique == 1 && len == 6 && memcmp(line, plain, 6 * sizeof(terminal_cell_t)) == 0;
+    
+    // A line longer than the caller's buffer is cut but its length reported
+    ok = ok && vte_scrollback_line(&history, 0, line, 3) == 6 && line[2].codepoint == 'm';
+    
+    // Popping drops a reference, and the last one the line
+    ok = ok && vte_scrollback_pop(&history, row, 8) && memcmp(row, plain, sizeof(row)) == 0;
+    ok = ok && history.unique == 1 && vte_scrollback_count(&history) == 3;
+    
+    // Packing forgets the sharing and unpacking finds it again
+    vte_scrollback_push(&history, bold, 8);
+    ok = ok && vte_scrollback_pack(&history) && vte_scrollback_unpack(&history);
+    vte_scrollback_memory(&history, &referenced, &stored);
+    ok = ok && history.unique == 2 && vte_scrollback_count(&history) == 4 &&
+         referenced == 24 * sizeof(terminal_cell_t) && stored == plain_bytes + bold_bytes;
+    len = vte_scrollback_line(&history, 3, line, 8);
+    ok = ok && len == 6 && memcmp(line, bold, 6 * sizeof(terminal_cell_t)) == 0;
+    
+    // Lines with non-ASCII text, or more styles than runs fit, keep their
+    // cells and come back unchanged
+    terminal_cell_t accented[8], striped[8];
+    memcpy(accented, plain, sizeof(plain));
+    accented[3].codepoint = 0xE9;
+    for (int x = 0; x < 8; x++) {
+        striped[x] = plain[x];
+        striped[x].fg_color = x;
+    }
+    vte_scrollback_push(&history, accented, 8);
+    vte_scrollback_push(&history, striped, 8);
+    vte_scrollback_memory(&history, &referenced, &stored);
+    ok = ok && history.unique == 4 &&
+         stored == plain_bytes + bold_bytes + 14 * sizeof(terminal_cell_t);
+    ok = ok && vte_scrollback_line(&history, 2, line, 8) == 6 &&
+         memcmp(line, accented, 6 * sizeof(terminal_cell_t)) == 0;
+    ok = ok && vte_scrollback_pop(&history, row, 8) && memcmp(row, striped, sizeof(row)) == 0;
+    ok = ok && vte_scrollback_pop(&history, row, 8) && memcmp(row, accented, sizeof(row)) == 0;
+    
+    vte_scrollback_clear(&history);
+    vte_scrollback_memory(&history, &referenced, &stored);
+    ok = ok && history.unique == 0 && referenced == 0 && stored == 0;
+    vte_scrollback_push(&history, plain, 8);
+    ok = ok && history.unique == 1 && vte_scrollback_count(&history) == 1;
+    
+    vte_scrollback_free(&history);
+    return ok;
+}
+
+int test_screen_snapshot() {
+    vte_screen_t *screen = vte_screen_new(10, 4);
+    if (!screen) {
+        return 0;
+    }
+    vte_screen_feed(screen, "one\r\ntwo\r\nthree", 15);
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    vte_snapshot_t snapshot;
+    int ok = vte_snapshot_take(&snapshot, panel) && snapshot.height == 4 &&
+             snapshot.cursor_x == 5 && snapshot.cursor_y == 2;
+    ok = ok && snapshot.rows[1] == panel->screen[1];
+    
+    // Writing a row gives the panel its own copy; rows it only moves, or
+    // never touches, stay shared
+    vte_screen_feed(screen, "\rTHREE\r\nfour\r\nfive", 20);
+    ok = ok && snapshot.rows[2][0].codepoint == 't' && panel->screen[1][0].codepoint == 'T';
+    ok = ok && snapshot.rows[1] == panel->screen[0] && snapshot.rows[1][0].codepoint == 't';
+    
+    // The snapshot outlives the screen
+    vte_screen_free(screen);
+    ok = ok && snapshot.rows[0][0].codepoint == 'o' && snapshot.rows[3][0].codepoint == ' ';
+    vte_snapshot_free(&snapshot);
+    return ok;
+}
+
+int test_snapshot_scroll_region() {
+    // Scroll regions, IL and DL are the enhanced perform's, over counted rows
+    terminal_panel_t panel;
+    memset(&panel, 0, sizeof(panel));
+    panel.screen = malloc(6 * sizeof(terminal_cell_t *));
+    for (int y = 0; panel.screen && y < 6; y++) {
+        panel.screen[y] = vte_row_new(10);
+        vte_kernel->fill_cells(panel.screen[y], 10, VTE_BLANK_CELL);
+    }
+    terminal_panel_init(&panel, 10, 6);
+    vte_parser_init(&panel.parser);
+    panel.perform = enhanced_perform;
+    const char *rows_text = "r0\r\nr1\r\nr2\r\nr3\r\nr4\r\nr5\x1b[2;5r";
+    vte_parser_advance(&panel.parser, &panel, (const uint8_t *)rows_text, strlen(rows_text));
+    vte_snapshot_t snapshot;
+    int ok = vte_snapshot_take(&snapshot, &panel);
+    terminal_cell_t **rows = snapshot.rows;
+    terminal_cell_t **screen = panel.screen;
+    
+    // Scrolling the region moves its rows by pointer: they stay shared, and
+    // only the row that comes in is copied to be blanked
+    vte_parser_advance(&panel.parser, &panel, (const uint8_t *)"\x1b[1S", 4);
+    ok = ok && screen[0] == rows[0] && screen[5] == rows[5];
+    ok = ok && screen[1] == rows[2] && screen[2] == rows[3] && screen[3] == rows[4];
+    ok = ok && screen[4] != rows[1] && screen[4][0].codepoint == ' ' && rows[1][1].codepoint == '1';
+    vte_parser_advance(&panel.parser, &panel, (const uint8_t *)"\x1b[1T", 4);
+    ok = ok && screen[2] == rows[2] && screen[3] == rows[3] && screen[4] == rows[4];
+    
+    // Inserting and deleting lines in it does the same
+    vte_parser_advance(&panel.parser, &panel, (const uint8_t *)"\x1b[3;1H\x1b[1L", 10);
+    ok = ok && screen[3] == rows[2] && screen[4] == rows[3] && screen[2] != rows[4] &&
+         screen[2][0].codepoint == ' ' && rows[4][1].codepoint == '4';
+    vte_parser_advance(&panel.parser, &panel, (const uint8_t *)"\x1b[1M", 4);
+    ok = ok && screen[2] == rows[2] && screen[3] == rows[3];
+    ok = ok && screen[0] == rows[0] && screen[5] == rows[5];
+    
+    for (int y = 0; y < 6; y++) {
+        vte_row_unref(screen[y]);
+    }
+    free(screen);
+    vte_snapshot_free(&snapshot);
+    return ok;
+}
+
+static int screens_equal(const terminal_panel_t *a, const terminal_panel_t *b) {
+    if (a->screen_width != b->screen_width || a->screen_height != b->screen_height ||
+        a->cursor_x != b->cursor_x || a->cursor_y != b->cursor_y) {
+        return 0;
+    }
+    for (int y = 0; y < a->screen_height; y++) {
+        if (memcmp(a->screen[y], b->screen[y], a->screen_width * sizeof(terminal_cell_t)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_rewind() {
+    char stream[512];
+    size_t len = 0;
+    for (int n = 0; n < 20; n++) {
+        len += sprintf(stream + len, "\x1b[3%dmrow %d\x1b[m\r\n", n % 8, n);
+    }
+    
+    vte_screen_t *screen = vte_screen_new(12, 4);
+    vte_input_t input;
+    if (!screen || !vte_input_init(&input, 16)) {
+        vte_screen_free(screen);
+        return 0;
+    }
+    terminal_panel_t *panel = vte_screen_panel(screen);
+    int ok = vte_recording_init(&panel->recording, 100, 32) && panel->recording.size == 128;
+    
+    // Parsed 7 bytes at a time, so sequences are split between frames
+    size_t chunk = 7;
+    for (size_t start = 0; start < len; start += chunk) {
+        size_t n = len - start < chunk ? len - start : chunk;
+        fill_input(&input, stream + start, n);
+        vte_input_parse(&input, panel);
+    }
+    const vte_recording_t *recording = &panel->recording;
+    uint64_t first = vte_recording_first_frame(recording);
+    ok = ok && recording->frame_end == (len + chunk - 1) / chunk && first > 0;
+    
+    // Every frame still recorded looks as it did after its parse
+    terminal_panel_t view;
+    memset(&view, 0, sizeof(view));
+    for (uint64_t frame = first; ok && frame < recording->frame_end; frame++) {
+        size_t end = (size_t)(frame + 1) * chunk < len ? (size_t)(frame + 1) * chunk : len;
+        vte_screen_t *expected = vte_screen_new(12, 4);
+        vte_screen_feed(expected, stream, end);
+        ok = vte_recording_seek(recording, frame, &view) &&
+             screens_equal(&view, vte_screen_panel(expected));
+        vte_screen_free(expected);
+    }
+    
+    // The last frame is the screen as it is; seeking leaves that alone
+    ok = ok && screens_equal(&view, panel) && !vte_recording_seek(recording, first - 1, &view) &&
+         !vte_recording_seek(recording, recording->frame_end, &view);
+    
+    // A resize forgets everything
+    vte_recording_clear(&panel->recording);
+    ok = ok && vte_recording_first_frame(recording) == recording->frame_end;
+    
+    vte_recording_view_free(&view);
+    vte_recording_free(&panel->recording);
+    vte_input_free(&input);
+    vte_screen_free(screen);
+    return ok;
+}
+
+// A hibernated panel keeps no recording, so no keyframe holds on to its
+// rows; its next output is recorded again
+int test_hibernate_recording() {
+    terminal_panel_t panel;
+    memset(&panel, 0, sizeof(panel));
+    panel.master_fd = -1;
+    panel.width = 22;
+    panel.height = 6;
+    init_panel_screen(&panel);
+    
+    fill_input(&panel.input, "one\r\ntwo\r\n", 10);
+    vte_input_parse(&panel.input, &panel);
+    int ok = panel.recording.keyframe_count == 1 && panel.recording.frame_count == 1;
+    
+    ok = ok && hibernate_panel(&panel, false);
+    ok = ok && !panel.recording.data && !panel.recording.keyframes && panel.recording.keyframe_count == 0;
+    for (int y = 0; ok && y < panel.screen_height; y++) {
+        terminal_cell_t *row = panel.screen[y];
+        ok = vte_row_writable(&panel, y) == row;  // Not copied: nothing else holds it
+    }
+    
+    ok = ok && wake_panel_recording(&panel);
+    fill_input(&panel.input, "three", 5);
+    vte_input_parse(&panel.input, &panel);
+    ok = ok && panel.recording.keyframe_count == 1 && panel.recording.frame_count == 1;
+    
+    free_panel_screen(&panel);
+    return ok;
+}
+
+// Control string payloads seen by test_string_payloads()
+static size_t string_osc_lens[4];
+static size_t string_osc_count;
+static size_t string_puts;
+static size_t string_unhooks;
+
+static void string_osc_dispatch(terminal_panel_t *panel, const uint8_t *const *params,
+                                const size_t *param_lens, size_t num_params, bool bell_terminated) {
+    (void)panel;
+    (void)params;
+    (void)bell_terminated;
+    for (size_t i = 0; i < num_params && i < 4; i++) {
+        string_osc_lens[i] = param_lens[i];
+    }
+    string_osc_count = num_params;
+}
+
+static void string_put(terminal_panel_t *panel, uint8_t byte) {
+    (void)panel;
+    (void)byte;
+    string_puts++;
+}
+
+static void string_unhook(terminal_panel_t *panel) {
+    (void)panel;
+    string_unhooks++;
+}
+
+int test_string_payloads() {
+    // Every implementation finds each byte that can end or split a string,
+    // wherever it is, past bytes that cannot
+    uint8_t bytes[100];
+    static const uint8_t stops[] = { 0x00, 0x07, 0x18, 0x1A, 0x1B, 0x1F, ';', 0x7F, 0x9C };
+    int ok = 1;
+    const char *const *names = vte_kernels_available();
+    for (int n = 0; names[n] && ok; n++) {
+        ok = vte_kernels_select(names[n]);
+        for (size_t i = 0; i < sizeof(bytes); i++) {
+            bytes[i] = (uint8_t)" A+/z\x80\x9B\x9D\xFF"[i % 9];
+        }
+        ok = ok && vte_kernel->find_string_stop(bytes, sizeof(bytes)) == sizeof(bytes);
+        for (size_t stop = 0; stop < sizeof(stops) && ok; stop++) {
+            for (size_t at = 0; at < sizeof(bytes) && ok; at++) {
+                uint8_t saved = bytes[at];
+                bytes[at] = stops[stop];
+                ok = vte_kernel->find_string_stop(bytes, sizeof(bytes)) == at &&
+                     vte_kernel->find_string_stop(bytes, at) == at;
+                bytes[at] = saved;
+            }
+        }
+    }
+    
+    // A clipboard payload longer than the OSC buffer, an ignored APC image
+    // and a DCS passed through, in reads of every size
+    char stream[4096];
+    size_t len = 0;
+    len += sprintf(stream + len, "\033]52;c;");
+    for (int i = 0; i < 1500; i++) {
+        stream[len++] = "QUJD"[i % 4];
+    }
+    len += sprintf(stream + len, "\007\033_Ga=T;");
+    for (int i = 0; i < 700; i++) {
+        stream[len++] = "\xC3\xA9Zm"[i % 4];
+    }
+    len += sprintf(stream + len, "\033\\\033Pq#0;2;0;0;0");
+    for (int i = 0; i < 300; i++) {
+        stream[len++] = "~@v-"[i % 4];
+    }
+    len += sprintf(stream + len, "\033\\ok");
+    
+    size_t reads[] = { 1, 3, 16, 33, 100, len };
+    for (size_t r = 0; r < sizeof(reads) / sizeof(reads[0]) && ok; r++) {
+        setup_test();
+        test_panel.perform.osc_dispatch = string_osc_dispatch;
+        test_panel.perform.put = string_put;
+        test_panel.perform.unhook = string_unhook;
+        string_osc_count = string_puts = string_unhooks = 0;
+        for (size_t off = 0; off < len; off += reads[r]) {
+            size_t n = len - off < reads[r] ? len - off : reads[r];
+            vte_parser_advance(&test_panel.parser, &test_panel, (const uint8_t *)stream + off, n);
+        }
+        ok = string_osc_count == 3 && string_osc_lens[0] == 2 && string_osc_lens[1] == 1 &&
+             string_osc_lens[2] == VTE_MAX_OSC_RAW - 3 && string_puts == 10 + 300 &&
+             string_unhooks == 1 && strcmp(output_buffer, "ok") == 0;
+        cleanup_test();
+    }
+    
+    // Back to the best one
+    int best = 0;
+    while (names[best + 1]) {
+        best++;
+    }
+    vte_kernels_select(names[best]);
+    return ok;
+}
+
 int main() {
     printf("🧪 Running VTE Parser Test Suite\n");
     printf("================================\n\n");
     
+    vte_kernels_init();
+    
     // Run all tests
     TEST(basic_text);
     TEST(control_characters);
@@ -610,6 +1475,24 @@ int main() {
     TEST(save_restore_cursor);
     TEST(terminal_modes);
     TEST(extended_colors);
+    TEST(screen_api);
+    TEST(scrollback_capture);
+    TEST(cell_damage);
+    TEST(packed_history);
+    TEST(query_replies);
+    TEST(input_ring);
+    TEST(flush_write);
+    TEST(parser_iov);
+    TEST(grid_layouts);
+    TEST(grid_adaptive);
+    TEST(cell_kernels);
+    TEST(row_hash);
+    TEST(scrollback_dedup);
+    TEST(screen_snapshot);
+    TEST(snapshot_scroll_region);
+    TEST(rewind);
+    TEST(hibernate_recording);
+    TEST(string_payloads);
     
     // Print results
     printf("\n📊 Test Results\n");